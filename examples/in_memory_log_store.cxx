@@ -19,21 +19,28 @@ limitations under the License.
 
 #include "nuraft.hxx"
 
+#include <algorithm>
 #include <cassert>
 
 namespace nuraft {
 
+namespace {
+
+// Initial number of slots in the ring buffer, should be a power of 2.
+const size_t INITIAL_CAPACITY = 1024;
+
+} // namespace
+
 inmem_log_store::inmem_log_store()
-    : start_idx_(1)
+    : logs_(INITIAL_CAPACITY)
+    , dummy_entry_(std::make_shared<log_entry>(0, buffer::alloc(sz_uint64_t)))
+    , start_idx_(1)
+    , next_idx_(1)
     , raft_server_bwd_pointer_(nullptr)
     , disk_emul_delay(0)
     , disk_emul_thread_(nullptr)
     , disk_emul_thread_stop_signal_(false)
-    , disk_emul_last_durable_index_(0) {
-    // Dummy entry for index 0.
-    std::shared_ptr<buffer> buf = buffer::alloc(sz_uint64_t);
-    logs_[0] = std::make_shared<log_entry>(0, buf);
-}
+    , disk_emul_last_durable_index_(0) {}
 
 inmem_log_store::~inmem_log_store() {
     if (disk_emul_thread_) {
@@ -45,44 +52,50 @@ inmem_log_store::~inmem_log_store() {
     }
 }
 
-std::shared_ptr<log_entry>
-inmem_log_store::make_clone(const std::shared_ptr<log_entry>& entry) {
-    // NOTE:
-    //   Timestamp is used only when `replicate_log_timestamp_` option is on.
-    //   Otherwise, log store does not need to store or load it.
-    std::shared_ptr<log_entry> clone =
-        std::make_shared<log_entry>(entry->get_term(),
-                                    buffer::clone(entry->get_buf()),
-                                    entry->get_val_type(),
-                                    entry->get_timestamp());
-    return clone;
+const std::shared_ptr<log_entry>& inmem_log_store::entry_locked(ulong index) const {
+    if (index < start_idx_ || index >= next_idx_) {
+        return dummy_entry_;
+    }
+    return slot(index);
+}
+
+void inmem_log_store::reserve(ulong num_logs) {
+    if (num_logs <= logs_.size()) return;
+
+    size_t new_size = logs_.size();
+    while (new_size < num_logs) {
+        new_size *= 2;
+    }
+    std::vector<std::shared_ptr<log_entry>> new_logs(new_size);
+    for (ulong ii = start_idx_; ii < next_idx_; ++ii) {
+        new_logs[ii & (new_size - 1)] = std::move(slot(ii));
+    }
+    logs_.swap(new_logs);
 }
 
-ulong inmem_log_store::next_slot() const {
-    std::lock_guard<std::mutex> l(logs_lock_);
-    // Exclude the dummy entry.
-    return start_idx_ + logs_.size() - 1;
+void inmem_log_store::reset(ulong start_idx) {
+    for (ulong ii = start_idx_; ii < next_idx_; ++ii) {
+        slot(ii).reset();
+    }
+    start_idx_ = start_idx;
+    next_idx_ = start_idx;
 }
 
+ulong inmem_log_store::next_slot() const { return next_idx_; }
+
 ulong inmem_log_store::start_index() const { return start_idx_; }
 
 std::shared_ptr<log_entry> inmem_log_store::last_entry() const {
-    ulong next_idx = next_slot();
-    std::lock_guard<std::mutex> l(logs_lock_);
-    auto entry = logs_.find(next_idx - 1);
-    if (entry == logs_.end()) {
-        entry = logs_.find(0);
-    }
-
-    return make_clone(entry->second);
+    std::shared_lock<std::shared_mutex> l(logs_lock_);
+    return entry_locked(next_idx_ - 1);
 }
 
 ulong inmem_log_store::append(std::shared_ptr<log_entry>& entry) {
-    std::shared_ptr<log_entry> clone = make_clone(entry);
-
-    std::lock_guard<std::mutex> l(logs_lock_);
-    size_t idx = start_idx_ + logs_.size() - 1;
-    logs_[idx] = clone;
+    std::lock_guard<std::shared_mutex> l(logs_lock_);
+    ulong idx = next_idx_;
+    reserve(idx - start_idx_ + 1);
+    slot(idx) = entry;
+    next_idx_ = idx + 1;
 
     if (disk_emul_delay) {
         uint64_t cur_time = timer_helper::get_timeofday_us();
@@ -94,15 +107,19 @@ ulong inmem_log_store::append(std::shared_ptr<log_entry>& entry) {
 }
 
 void inmem_log_store::write_at(ulong index, std::shared_ptr<log_entry>& entry) {
-    std::shared_ptr<log_entry> clone = make_clone(entry);
+    std::lock_guard<std::shared_mutex> l(logs_lock_);
+    if (index < start_idx_ || index > next_idx_) {
+        // Not contiguous to the existing logs, start over from `index`.
+        reset(index);
+    }
 
     // Discard all logs equal to or greater than `index.
-    std::lock_guard<std::mutex> l(logs_lock_);
-    auto itr = logs_.lower_bound(index);
-    while (itr != logs_.end()) {
-        itr = logs_.erase(itr);
+    for (ulong ii = index; ii < next_idx_; ++ii) {
+        slot(ii).reset();
     }
-    logs_[index] = clone;
+    reserve(index - start_idx_ + 1);
+    slot(index) = entry;
+    next_idx_ = index + 1;
 
     if (disk_emul_delay) {
         uint64_t cur_time = timer_helper::get_timeofday_us();
@@ -125,21 +142,14 @@ std::shared_ptr<std::vector<std::shared_ptr<log_entry>>>
 inmem_log_store::log_entries(ulong start, ulong end) {
     std::shared_ptr<std::vector<std::shared_ptr<log_entry>>> ret =
         std::make_shared<std::vector<std::shared_ptr<log_entry>>>();
+    if (end <= start) return ret;
 
-    ret->resize(end - start);
-    ulong cc = 0;
+    ret->reserve(end - start);
+    std::shared_lock<std::shared_mutex> l(logs_lock_);
     for (ulong ii = start; ii < end; ++ii) {
-        std::shared_ptr<log_entry> src = nullptr;
-        {
-            std::lock_guard<std::mutex> l(logs_lock_);
-            auto entry = logs_.find(ii);
-            if (entry == logs_.end()) {
-                entry = logs_.find(0);
-                assert(0);
-            }
-            src = entry->second;
-        }
-        (*ret)[cc++] = make_clone(src);
+        const std::shared_ptr<log_entry>& src = entry_locked(ii);
+        assert(src != dummy_entry_);
+        ret->push_back(src);
     }
     return ret;
 }
@@ -154,18 +164,11 @@ std::shared_ptr<std::vector<std::shared_ptr<log_entry>>> inmem_log_store::log_en
     }
 
     size_t accum_size = 0;
+    std::shared_lock<std::shared_mutex> l(logs_lock_);
     for (ulong ii = start; ii < end; ++ii) {
-        std::shared_ptr<log_entry> src = nullptr;
-        {
-            std::lock_guard<std::mutex> l(logs_lock_);
-            auto entry = logs_.find(ii);
-            if (entry == logs_.end()) {
-                entry = logs_.find(0);
-                assert(0);
-            }
-            src = entry->second;
-        }
-        ret->push_back(make_clone(src));
+        const std::shared_ptr<log_entry>& src = entry_locked(ii);
+        assert(src != dummy_entry_);
+        ret->push_back(src);
         accum_size += src->get_buf().size();
         if (batch_size_hint_in_bytes && accum_size >= (ulong)batch_size_hint_in_bytes)
             break;
@@ -174,56 +177,60 @@ std::shared_ptr<std::vector<std::shared_ptr<log_entry>>> inmem_log_store::log_en
 }
 
 std::shared_ptr<log_entry> inmem_log_store::entry_at(ulong index) {
-    std::shared_ptr<log_entry> src = nullptr;
-    {
-        std::lock_guard<std::mutex> l(logs_lock_);
-        auto entry = logs_.find(index);
-        if (entry == logs_.end()) {
-            entry = logs_.find(0);
-        }
-        src = entry->second;
-    }
-    return make_clone(src);
+    std::shared_lock<std::shared_mutex> l(logs_lock_);
+    return entry_locked(index);
 }
 
 ulong inmem_log_store::term_at(ulong index) {
-    ulong term = 0;
-    {
-        std::lock_guard<std::mutex> l(logs_lock_);
-        auto entry = logs_.find(index);
-        if (entry == logs_.end()) {
-            entry = logs_.find(0);
-        }
-        term = entry->second->get_term();
+    std::shared_lock<std::shared_mutex> l(logs_lock_);
+    return entry_locked(index)->get_term();
+}
+
+bool inmem_log_store::terms_in_range(ulong start,
+                                     ulong end,
+                                     std::vector<ulong>& terms_out) {
+    terms_out.clear();
+    std::shared_lock<std::shared_mutex> l(logs_lock_);
+    if (start < start_idx_ || end > next_idx_ || start > end) return false;
+
+    terms_out.reserve(end - start);
+    for (ulong ii = start; ii < end; ++ii) {
+        terms_out.push_back(slot(ii)->get_term());
     }
-    return term;
+    return true;
 }
 
 std::shared_ptr<buffer> inmem_log_store::pack(ulong index, int32_t cnt) {
-    std::vector<std::shared_ptr<buffer>> logs;
+    std::vector<std::shared_ptr<log_entry>> logs;
+    logs.reserve(cnt);
+    {
+        std::shared_lock<std::shared_mutex> l(logs_lock_);
+        for (ulong ii = index; ii < index + cnt; ++ii) {
+            const std::shared_ptr<log_entry>& le = entry_locked(ii);
+            assert(le != dummy_entry_);
+            logs.push_back(le);
+        }
+    }
 
+    // Same format as `log_entry::serialize()`, but written from the
+    // beginning of the data, as the position of a shared buffer
+    // should not be touched.
     size_t size_total = 0;
-    for (ulong ii = index; ii < index + cnt; ++ii) {
-        std::shared_ptr<log_entry> le = nullptr;
-        {
-            std::lock_guard<std::mutex> l(logs_lock_);
-            le = logs_[ii];
-        }
-        assert(le.get());
-        std::shared_ptr<buffer> buf = le->serialize();
-        size_total += buf->size();
-        logs.push_back(buf);
+    for (auto& entry: logs) {
+        size_total += sizeof(int32_t) + sz_uint64_t + sizeof(std::byte)
+                      + entry->get_buf().size();
     }
 
-    std::shared_ptr<buffer> buf_out =
-        buffer::alloc(sizeof(int32_t) + cnt * sizeof(int32_t) + size_total);
+    std::shared_ptr<buffer> buf_out = buffer::alloc(sizeof(int32_t) + size_total);
     buf_out->pos(0);
     buf_out->put((int32_t)cnt);
 
     for (auto& entry: logs) {
-        std::shared_ptr<buffer>& bb = entry;
-        buf_out->put((int32_t)bb->size());
-        buf_out->put(*bb);
+        buffer& data = entry->get_buf();
+        buf_out->put((int32_t)(sz_uint64_t + sizeof(std::byte) + data.size()));
+        buf_out->put(entry->get_term());
+        buf_out->put(static_cast<std::byte>(entry->get_val_type()));
+        buf_out->put_raw(data.data_begin(), data.size());
     }
     return buf_out;
 }
@@ -232,46 +239,49 @@ void inmem_log_store::apply_pack(ulong index, buffer& pack) {
     pack.pos(0);
     auto num_logs = pack.get_int();
 
+    std::vector<std::shared_ptr<log_entry>> logs;
+    logs.reserve(num_logs);
     for (auto ii = 0l; ii < num_logs; ++ii) {
-        ulong cur_idx = index + ii;
         auto buf_size = pack.get_int();
 
         std::shared_ptr<buffer> buf_local = buffer::alloc(buf_size);
         pack.get(buf_local);
 
-        std::shared_ptr<log_entry> le = log_entry::deserialize(*buf_local);
-        {
-            std::lock_guard<std::mutex> l(logs_lock_);
-            logs_[cur_idx] = le;
-        }
+        logs.push_back(log_entry::deserialize(*buf_local));
     }
 
-    {
-        std::lock_guard<std::mutex> l(logs_lock_);
-        auto entry = logs_.upper_bound(0);
-        if (entry != logs_.end()) {
-            start_idx_ = entry->first;
-        } else {
-            start_idx_ = 1;
-        }
+    std::lock_guard<std::shared_mutex> l(logs_lock_);
+    if (index < start_idx_ || index > next_idx_) {
+        reset(index);
     }
+
+    ulong end_idx = std::max((ulong)next_idx_, index + logs.size());
+    reserve(end_idx - start_idx_);
+    for (size_t ii = 0; ii < logs.size(); ++ii) {
+        slot(index + ii) = logs[ii];
+    }
+    next_idx_ = end_idx;
 }
 
 bool inmem_log_store::compact(ulong last_log_index) {
-    std::lock_guard<std::mutex> l(logs_lock_);
-    for (ulong ii = start_idx_; ii <= last_log_index; ++ii) {
-        auto entry = logs_.find(ii);
-        if (entry != logs_.end()) {
-            logs_.erase(entry);
-        }
+    std::lock_guard<std::shared_mutex> l(logs_lock_);
+    if (last_log_index < start_idx_) {
+        return true;
     }
 
     // WARNING:
     //   Even though nothing has been erased,
     //   we should set `start_idx_` to new index.
-    if (start_idx_ <= last_log_index) {
-        start_idx_ = last_log_index + 1;
+    ulong new_start = last_log_index + 1;
+    if (new_start >= next_idx_) {
+        reset(new_start);
+        return true;
+    }
+
+    for (ulong ii = start_idx_; ii < new_start; ++ii) {
+        slot(ii).reset();
     }
+    start_idx_ = new_start;
     return true;
 }
 
@@ -315,7 +325,7 @@ void inmem_log_store::disk_emul_loop() {
 
         bool call_notification = false;
         {
-            std::lock_guard<std::mutex> l(logs_lock_);
+            std::lock_guard<std::shared_mutex> l(logs_lock_);
             // Remove all timestamps equal to or smaller than `cur_time`,
             // and pick the greatest one among them.
             auto entry = disk_emul_logs_being_written_.begin();
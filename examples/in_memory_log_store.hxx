@@ -24,11 +24,20 @@ limitations under the License.
 #include <atomic>
 #include <map>
 #include <mutex>
+#include <shared_mutex>
+#include <vector>
 
 namespace nuraft {
 
 class raft_server;
 
+/**
+ * In-memory log store, keeping logs in a ring buffer indexed by log index.
+ *
+ * Log entries are shared with callers instead of being copied,
+ * hence neither the store nor its callers should modify them
+ * once they are appended.
+ */
 class inmem_log_store : public log_store {
 public:
     inmem_log_store();
@@ -58,6 +67,8 @@ public:
 
     ulong term_at(ulong index);
 
+    bool terms_in_range(ulong start, ulong end, std::vector<ulong>& terms_out);
+
     std::shared_ptr<buffer> pack(ulong index, int32_t cnt) override;
 
     void apply_pack(ulong index, buffer& pack);
@@ -73,25 +84,48 @@ public:
     void set_disk_delay(raft_server* raft, size_t delay_ms);
 
 private:
-    static std::shared_ptr<log_entry> make_clone(const std::shared_ptr<log_entry>& entry);
+    std::shared_ptr<log_entry>& slot(ulong index) {
+        return logs_[index & (logs_.size() - 1)];
+    }
+
+    const std::shared_ptr<log_entry>& slot(ulong index) const {
+        return logs_[index & (logs_.size() - 1)];
+    }
+
+    const std::shared_ptr<log_entry>& entry_locked(ulong index) const;
+
+    void reserve(ulong num_logs);
+
+    void reset(ulong start_idx);
 
     void disk_emul_loop();
 
     /**
-     * Map of <log index, log data>.
+     * Ring buffer of log entries, whose size is a power of 2.
+     * Log `idx` is at `logs_[idx & (logs_.size() - 1)]`.
      */
-    std::map<ulong, std::shared_ptr<log_entry>> logs_;
+    std::vector<std::shared_ptr<log_entry>> logs_;
 
     /**
-     * Lock for `logs_`.
+     * Dummy entry for index 0, returned when the given log does not exist.
      */
-    mutable std::mutex logs_lock_;
+    std::shared_ptr<log_entry> dummy_entry_;
+
+    /**
+     * Lock for `logs_`. Logs are read under the shared lock.
+     */
+    mutable std::shared_mutex logs_lock_;
 
     /**
      * The index of the first log.
      */
     std::atomic<ulong> start_idx_;
 
+    /**
+     * The index of the next log to be appended.
+     */
+    std::atomic<ulong> next_idx_;
+
     /**
      * Backward pointer to Raft server.
      */
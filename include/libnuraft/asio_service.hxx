@@ -53,6 +53,21 @@ public:
     std::shared_ptr<rpc_listener> create_rpc_listener(uint16_t listening_port,
                                                       std::shared_ptr<logger>& l);
 
+    /**
+     * Create a listener on Unix domain socket, for the replicas running
+     * on the same host. Other servers should use `unix://<path>` as
+     * the endpoint of this server. If `path` starts with `@`, it is
+     * an abstract socket (Linux only) which does not create a file.
+     *
+     * SSL is not used for Unix domain socket, regardless of options.
+     *
+     * @param path Socket path, with or without `unix://` prefix.
+     * @param l Logger.
+     * @return Listener, or `nullptr` if failed.
+     */
+    std::shared_ptr<rpc_listener> create_unix_rpc_listener(const std::string& path,
+                                                           std::shared_ptr<logger>& l);
+
     void stop();
 
     uint32_t get_active_workers();
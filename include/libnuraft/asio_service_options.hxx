@@ -78,6 +78,7 @@ using asio_service_custom_resolver_response =
 struct asio_service_options {
     asio_service_options()
         : thread_pool_size_(0)
+        , sharded_io_context_(false)
         , worker_start_(nullptr)
         , worker_stop_(nullptr)
         , enable_ssl_(false)
@@ -90,7 +91,12 @@ struct asio_service_options {
         , invoke_resp_cb_on_empty_meta_(true)
         , verify_sn_(nullptr)
         , custom_resolver_(nullptr)
-        , replicate_log_timestamp_(false) {}
+        , replicate_log_timestamp_(false)
+        , multiplexed_rpc_(false)
+        , read_buffer_size_(64 * 1024)
+        , max_coalesced_msgs_(64)
+        , resolver_cache_ttl_ms_(0)
+        , resolver_negative_ttl_ms_(1000) {}
 
     /**
      * Number of ASIO worker threads.
@@ -98,6 +104,22 @@ struct asio_service_options {
      */
     size_t thread_pool_size_;
 
+    /**
+     * If `true`, each worker thread runs its own `io_context` (shard),
+     * instead of all worker threads sharing a single one. This reduces
+     * the contention on the internal locks of `io_context`, when a large
+     * number of connections (e.g., many Raft groups) share this service.
+     *
+     * Clients are assigned to shards by their endpoint, so that all
+     * connections to the same peer are handled by the same thread.
+     * Incoming sessions and timers are spread over shards.
+     *
+     * Worker threads are not pinned to CPU cores automatically.
+     * `worker_start_` callback can be used for that, with the worker
+     * ID which is also the shard index.
+     */
+    bool sharded_io_context_;
+
     /**
      * Lifecycle callback function on worker thread start.
      */
@@ -213,6 +235,64 @@ struct asio_service_options {
      * this flag.
      */
     bool replicate_log_timestamp_;
+
+    /**
+     * If `true`, each request will carry a request ID, and the server
+     * will write the response as soon as it is ready, instead of waiting
+     * for the responses of the previous requests on the same connection.
+     * The client matches responses to requests by the ID, so that a slow
+     * request (e.g., snapshot chunk or auto-forwarded client request)
+     * does not block the others.
+     *
+     * Responses to `append_entries` requests are still returned in the
+     * order of requests, as the leader pipelines them.
+     *
+     * This feature is not backward compatible. To enable this feature, there
+     * should not be any member running with old version before supprting
+     * this flag.
+     */
+    bool multiplexed_rpc_;
+
+    /**
+     * Size of the per-connection buffer for reading messages, in bytes.
+     * Each read from the socket fetches as many bytes as available up to
+     * this size, so that multiple small messages can be parsed without
+     * a separate read for each header and payload. A message whose
+     * payload does not fit in this buffer is read directly into its own
+     * memory.
+     *
+     * If smaller than 1KB, 1KB will be used.
+     */
+    size_t read_buffer_size_;
+
+    /**
+     * The maximum number of messages (requests or responses) that are
+     * queued on a connection and written to the socket by a single
+     * gather write. If zero or one, each message is written separately.
+     */
+    size_t max_coalesced_msgs_;
+
+    /**
+     * If non-zero, resolved addresses of each `host:port` (including the
+     * result of `custom_resolver_`) are cached for the given time, and
+     * shared by all clients of this service. Concurrent lookups of the
+     * same endpoint are merged into one.
+     *
+     * Once expired, or once a connection to the cached address fails,
+     * the next lookup returns the cached address immediately while
+     * refreshing it in background, so that reconnections do not wait for
+     * name resolution.
+     *
+     * If zero, every connection attempt resolves the endpoint.
+     */
+    uint64_t resolver_cache_ttl_ms_;
+
+    /**
+     * Time to cache a failed resolution, so that repeated reconnections
+     * fail fast instead of waiting for the resolver every time.
+     * Effective only when `resolver_cache_ttl_ms_` is non-zero.
+     */
+    uint64_t resolver_negative_ttl_ms_;
 };
 
 } // namespace nuraft
@@ -28,6 +28,36 @@ limitations under the License.
 
 namespace nuraft {
 
+/**
+ * Options for the per-thread buffer pool used by `buffer::alloc`.
+ */
+struct buffer_pool_options {
+    buffer_pool_options()
+        : enabled_(true)
+        , max_cached_bytes_per_thread_(4 * 1024 * 1024)
+        , stats_enabled_(true) {}
+
+    /**
+     * If `true`, buffers smaller than 64 KB (including the meta section)
+     * are allocated in power-of-two size classes, and recycled through
+     * the cache of the thread that releases them.
+     */
+    bool enabled_;
+
+    /**
+     * Maximum amount of memory that each thread keeps in its cache.
+     * Released buffers beyond this limit are returned to the system.
+     */
+    size_t max_cached_bytes_per_thread_;
+
+    /**
+     * If `true`, global buffer stat counters (`num_buffer_allocs`,
+     * `num_active_buffers`, and so on) are updated on every allocation
+     * and release. Disabling it avoids contention on the shared counters.
+     */
+    bool stats_enabled_;
+};
+
 class buffer {
     buffer() = delete;
     __nocopy__(buffer);
@@ -77,6 +107,53 @@ public:
      */
     static std::shared_ptr<buffer> expand(const buffer& buf, uint32_t new_size);
 
+    /**
+     * Make a buffer referring to a sub-range of the given buffer,
+     * without allocating a new memory or copying the data.
+     * The returned buffer shares the ownership of `src`, so that
+     * `src` will not be freed until all its slices are released.
+     *
+     * WARNING: The meta section of the returned buffer is written in-place,
+     * right before `offset` of `src`. Hence, `offset` should be equal to
+     * or greater than `slice_meta_size(len)`, and the data in that area
+     * will be overwritten.
+     *
+     * @param src Source buffer.
+     * @param offset Offset of the sub-range, from the beginning of `src`.
+     * @param len Length of the sub-range.
+     * @return buffer instance.
+     */
+    static std::shared_ptr<buffer>
+    slice(const std::shared_ptr<buffer>& src, size_t offset, size_t len);
+
+    /**
+     * Get the size of the meta section that `slice` will overwrite.
+     *
+     * @param len Length of the sub-range.
+     * @return Size of meta section.
+     */
+    static size_t slice_meta_size(size_t len);
+
+    /**
+     * Set the options of buffer pool. Buffers allocated before this call
+     * are released according to the options at the time of allocation.
+     *
+     * @param opt Buffer pool options.
+     */
+    static void set_pool_options(const buffer_pool_options& opt);
+
+    /**
+     * Get the current options of buffer pool.
+     *
+     * @return Buffer pool options.
+     */
+    static buffer_pool_options get_pool_options();
+
+    /**
+     * Return all buffers cached by the calling thread to the system.
+     */
+    static void purge_pool_cache();
+
     /**
      * Get total size of entire buffer container, including meta section.
      *
@@ -0,0 +1,289 @@
+/************************************************************************
+Copyright 2017-2019 eBay Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include "event_awaiter.hxx"
+#include "log_store.hxx"
+#include "pp_util.hxx"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nuraft {
+
+class logger;
+class raft_server;
+
+struct file_log_store_options {
+    file_log_store_options()
+        : segment_size_(64 * 1024 * 1024)
+        , max_entries_per_segment_(1024 * 1024)
+        , preallocate_(true)
+        , sync_on_append_batch_(true) {}
+
+    /**
+     * Size of each segment file in bytes. Once a segment reaches
+     * this size, a new segment is created for the next log.
+     */
+    size_t segment_size_;
+
+    /**
+     * Max number of logs in each segment,
+     * which decides the size of the index file of the segment.
+     */
+    size_t max_entries_per_segment_;
+
+    /**
+     * If `true`, each segment file is preallocated to `segment_size_`
+     * when it is created, so that appending logs does not need to
+     * update the file metadata.
+     */
+    bool preallocate_;
+
+    /**
+     * If `true`, `end_of_append_batch` syncs the logs to the disk
+     * (`fdatasync`) before returning, so that every batch of logs
+     * is durable once Raft handles it.
+     *
+     * It is ignored if `start_async_flush` is called.
+     */
+    bool sync_on_append_batch_;
+};
+
+/**
+ * Persistent log store, based on append-only segment files.
+ *
+ * Each segment consists of two files in the given directory:
+ *   - `<first log index>.log`: log entries, each with its length and CRC32C.
+ *   - `<first log index>.idx`: fixed-size array of {end offset, term}
+ *                              of each log, accessed through `mmap`.
+ *
+ * `term_at` and `terms_in_range` are served by the index without
+ * reading the data file,
+ * and consecutive logs in the same segment are read by a single `pread`.
+ *
+ * When the store is opened, the last segment is scanned to rebuild its
+ * index, and the logs after the first torn or corrupted entry are
+ * discarded. Other segments are synced when the next segment is created,
+ * hence they are trusted.
+ *
+ * `compact` removes the segments whose logs are all compacted, and
+ * the start index is kept in a separate file.
+ *
+ * This store is available only on POSIX systems.
+ */
+class file_log_store : public log_store {
+public:
+    /**
+     * Open the log store in the given directory. The directory
+     * is created if it does not exist. Throws `std::runtime_error`
+     * if it cannot open the files.
+     *
+     * @param path Path to the directory.
+     * @param opt Options.
+     * @param l Logger.
+     */
+    file_log_store(const std::string& path,
+                   const file_log_store_options& opt = file_log_store_options(),
+                   const std::shared_ptr<logger>& l = nullptr);
+
+    ~file_log_store();
+
+    __nocopy__(file_log_store);
+
+public:
+    uint64_t next_slot() const override;
+
+    uint64_t start_index() const override;
+
+    std::shared_ptr<log_entry> last_entry() const override;
+
+    uint64_t append(std::shared_ptr<log_entry>& entry) override;
+
+    void write_at(uint64_t index, std::shared_ptr<log_entry>& entry) override;
+
+    void end_of_append_batch(uint64_t start, uint64_t cnt) override;
+
+    std::shared_ptr<std::vector<std::shared_ptr<log_entry>>>
+    log_entries(uint64_t start, uint64_t end) override;
+
+    std::shared_ptr<std::vector<std::shared_ptr<log_entry>>>
+    log_entries_ext(uint64_t start,
+                    uint64_t end,
+                    int64_t batch_size_hint_in_bytes = 0) override;
+
+    std::shared_ptr<log_entry> entry_at(uint64_t index) override;
+
+    uint64_t term_at(uint64_t index) override;
+
+    bool terms_in_range(uint64_t start,
+                        uint64_t end,
+                        std::vector<uint64_t>& terms_out) override;
+
+    std::shared_ptr<buffer> pack(uint64_t index, int32_t cnt) override;
+
+    void apply_pack(uint64_t index, buffer& pack) override;
+
+    bool compact(uint64_t last_log_index) override;
+
+    bool flush() override;
+
+    uint64_t last_durable_index() override;
+
+    /**
+     * Sync the logs by a background thread, instead of the thread calling
+     * `end_of_append_batch`, and notify the given Raft server through
+     * `notify_log_append_completion` once they become durable.
+     * It should be used with `raft_params::parallel_log_appending_`.
+     *
+     * @param raft Raft server using this log store.
+     */
+    void start_async_flush(raft_server* raft);
+
+    /**
+     * Stop the background thread, and close all files.
+     */
+    void close();
+
+    /**
+     * Get the number of segments.
+     *
+     * @return Number of segments.
+     */
+    size_t num_segments() const;
+
+private:
+    struct segment;
+    struct read_chunk;
+
+    void recover();
+
+    uint64_t load_start_index();
+
+    void save_start_index(uint64_t start_idx);
+
+    std::shared_ptr<segment> open_segment(uint64_t first_idx, bool create);
+
+    void scan_segment(segment& seg);
+
+    void remove_segment(uint64_t first_idx);
+
+    void remove_all_segments(uint64_t new_start);
+
+    void roll_segment();
+
+    uint64_t append_locked(std::shared_ptr<log_entry>& entry);
+
+    void truncate_from(uint64_t index);
+
+    bool collect_chunks(uint64_t start,
+                        uint64_t end,
+                        int64_t batch_size_hint_in_bytes,
+                        std::vector<read_chunk>& chunks_out) const;
+
+    std::shared_ptr<std::vector<std::shared_ptr<log_entry>>>
+    read_chunks(const std::vector<read_chunk>& chunks);
+
+    bool sync_active_segment();
+
+    void flush_loop();
+
+    /**
+     * Path to the directory.
+     */
+    std::string path_;
+
+    /**
+     * Options.
+     */
+    file_log_store_options opt_;
+
+    /**
+     * Logger.
+     */
+    std::shared_ptr<logger> l_;
+
+    /**
+     * Map of {first log index, segment}.
+     * The last one is the active segment that logs are appended to.
+     */
+    std::map<uint64_t, std::shared_ptr<segment>> segments_;
+
+    /**
+     * Lock for segments, and the last entry.
+     */
+    mutable std::mutex lock_;
+
+    /**
+     * The index of the first log.
+     */
+    std::atomic<uint64_t> start_idx_;
+
+    /**
+     * The index of the next log to be appended.
+     */
+    std::atomic<uint64_t> next_idx_;
+
+    /**
+     * The index of the last log synced to the disk.
+     */
+    std::atomic<uint64_t> durable_idx_;
+
+    /**
+     * The index of the last log requested to be synced
+     * by `end_of_append_batch`, used by the background thread.
+     */
+    std::atomic<uint64_t> flush_target_;
+
+    /**
+     * Increased whenever logs are truncated, so that an ongoing sync
+     * does not report the truncated logs as durable.
+     */
+    uint64_t truncate_gen_;
+
+    /**
+     * The last log entry.
+     */
+    std::shared_ptr<log_entry> last_entry_;
+
+    /**
+     * Raft server to notify, if the background sync is enabled.
+     */
+    raft_server* raft_server_;
+
+    /**
+     * Background thread syncing logs.
+     */
+    std::unique_ptr<std::thread> flush_thread_;
+
+    /**
+     * Flag to terminate the background thread.
+     */
+    std::atomic<bool> flush_thread_stop_;
+
+    /**
+     * Invoked when logs need to be synced.
+     */
+    EventAwaiter flush_ea_;
+};
+
+} // namespace nuraft
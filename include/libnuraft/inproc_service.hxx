@@ -0,0 +1,99 @@
+/************************************************************************
+Copyright 2017-2019 eBay Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include "pp_util.hxx"
+#include "rpc_cli_factory.hxx"
+
+#include <memory>
+#include <string>
+
+namespace nuraft {
+
+/**
+ * Declaring this to hide the implementation details
+ * from root header file.
+ */
+class inproc_service_impl;
+class logger;
+class rpc_listener;
+
+/**
+ * RPC client factory and listener for Raft servers running in the same
+ * process (e.g., multiple Raft groups in one process, with some of their
+ * replicas co-located).
+ *
+ * Requests and responses are passed to the destination `raft_server`
+ * as objects, skipping serialization, CRC, and socket I/O. Log payloads
+ * are copied so that the servers do not share the same buffers.
+ *
+ * Requests to the same listener are processed in order by one of the
+ * worker threads of this service, and responses are returned to each
+ * client in the order of its requests, the same as `asio_service`.
+ *
+ * Timer (`delayed_task_scheduler`) is not provided by this service.
+ * `asio_service` or any other scheduler should be used together.
+ *
+ * For replicas in different processes on the same host, use Unix domain
+ * socket of `asio_service` (`unix://<path>` endpoint) instead.
+ */
+class inproc_service : public rpc_client_factory {
+public:
+    /**
+     * @param num_threads Number of worker threads processing requests.
+     *                    If zero, it will be set to 1.
+     * @param l Logger.
+     */
+    inproc_service(size_t num_threads = 1, std::shared_ptr<logger> l = nullptr);
+
+    ~inproc_service();
+
+    __nocopy__(inproc_service);
+
+public:
+    /**
+     * Create a client to the given endpoint. The endpoint does not need
+     * to be listening yet, it is looked up on every request.
+     *
+     * @param endpoint Endpoint given to `create_rpc_listener`.
+     * @return Client, or `nullptr` if this service is stopped.
+     */
+    std::shared_ptr<rpc_client> create_client(const std::string& endpoint) override;
+
+    /**
+     * Create a listener on the given endpoint. It should be unique
+     * within this service. The endpoint is registered when `listen`
+     * is called, and unregistered when `stop` is called.
+     *
+     * @param endpoint Endpoint of the Raft server.
+     * @return Listener.
+     */
+    std::shared_ptr<rpc_listener> create_rpc_listener(const std::string& endpoint);
+
+    /**
+     * Stop all worker threads. Requests not processed yet
+     * will fail with `rpc_exception`.
+     */
+    void stop();
+
+private:
+    inproc_service_impl* impl_;
+
+    std::shared_ptr<logger> l_;
+};
+
+} // namespace nuraft
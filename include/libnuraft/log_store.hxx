@@ -140,6 +140,31 @@ public:
      */
     virtual uint64_t term_at(uint64_t index) = 0;
 
+    /**
+     * (Optional)
+     * Get the terms of log entries with index [start, end).
+     *
+     * The default implementation calls `term_at` for each log. Override it
+     * if the log store can read the terms of a range at once.
+     *
+     * @param start The start log index number (inclusive).
+     * @param end The end log index number (exclusive).
+     * @param[out] terms_out The terms of the log entries between [start, end).
+     * @return `false` if any log entry within the range is not available.
+     */
+    virtual bool terms_in_range(uint64_t start,
+                                uint64_t end,
+                                std::vector<uint64_t>& terms_out) {
+        terms_out.clear();
+        if (start < start_index() || end > next_slot() || start > end) return false;
+
+        terms_out.reserve(end - start);
+        for (uint64_t ii = start; ii < end; ++ii) {
+            terms_out.push_back(term_at(ii));
+        }
+        return true;
+    }
+
     /**
      * Pack the given number of log items starting from the given index.
      *
@@ -57,6 +57,8 @@ enum msg_type {
     reconnect_response = 27,
     custom_notification_request = 28,
     custom_notification_response = 29,
+    client_batch_request = 30,
+    client_batch_response = 31,
 };
 
 inline bool is_valid_msg(msg_type type) {
@@ -127,6 +129,10 @@ inline std::string msg_type_to_string(msg_type type) {
         return "custom_notification_request";
     case custom_notification_response:
         return "custom_notification_response";
+    case client_batch_request:
+        return "client_batch_request";
+    case client_batch_response:
+        return "client_batch_response";
     default:
         return "unknown (" + std::to_string(static_cast<int>(type)) + ")";
     }
@@ -30,7 +30,9 @@ limitations under the License.
 #include "delayed_task.hxx"
 #include "delayed_task_scheduler.hxx"
 #include "error_code.hxx"
+#include "file_log_store.hxx"
 #include "global_mgr.hxx"
+#include "inproc_service.hxx"
 #include "log_entry.hxx"
 #include "log_store.hxx"
 #include "logger.hxx"
@@ -29,6 +29,7 @@ limitations under the License.
 #include "timer_task.hxx"
 
 #include <atomic>
+#include <deque>
 
 namespace nuraft {
 
@@ -41,7 +42,11 @@ public:
          std::shared_ptr<logger>& logger)
         : config_(config)
         , scheduler_(ctx.scheduler_)
-        , rpc_(ctx.rpc_cli_factory_->create_client(config->get_endpoint()))
+        , rpc_(create_data_client(*ctx.rpc_cli_factory_,
+                                  config->get_endpoint(),
+                                  ctx.get_params()->data_connections_per_peer_))
+        , ctrl_rpc_(nullptr)
+        , ctrl_busy_flag_(false)
         , current_hb_interval_(ctx.get_params()->heart_beat_interval_)
         , hb_interval_(ctx.get_params()->heart_beat_interval_)
         , rpc_backoff_(ctx.get_params()->rpc_failure_backoff_)
@@ -74,6 +79,8 @@ public:
         , abandoned_(false)
         , rsv_msg_(nullptr)
         , rsv_msg_handler_(nullptr)
+        , inflight_bytes_(0)
+        , pipeline_ready_(false)
         , l_(logger) {
         reset_ls_timer();
         reset_resp_timer();
@@ -170,6 +177,19 @@ public:
 
     void set_hb_interval(uint32_t new_interval) { hb_interval_ = new_interval; }
 
+    /**
+     * Send a request through the control connection, which is
+     * separate from the one used by `send_req`. Only one request
+     * can be in flight at a time.
+     *
+     * @return `false` if the request cannot be sent, as the previous
+     *         control request is still in flight, or there is no client.
+     */
+    bool send_ctrl_req(std::shared_ptr<peer> myself,
+                       context& ctx,
+                       std::shared_ptr<req_msg>& req,
+                       rpc_handler& handler);
+
     void send_req(std::shared_ptr<peer> myself,
                   std::shared_ptr<req_msg>& req,
                   rpc_handler& handler);
@@ -202,6 +222,15 @@ public:
 
     bool recreate_rpc(std::shared_ptr<srv_config>& config, context& ctx);
 
+    /**
+     * Create an RPC client for replication. If `num_conns` is greater
+     * than 1, the returned client stripes append entries requests
+     * across that many connections.
+     */
+    static std::shared_ptr<rpc_client> create_data_client(rpc_client_factory& factory,
+                                                          const std::string& endpoint,
+                                                          int32_t num_conns);
+
     void reset_rpc_errs() { rpc_errs_ = 0; }
     void inc_rpc_errs() { rpc_errs_.fetch_add(1); }
     auto get_rpc_errs() { return rpc_errs_.load(); }
@@ -260,6 +289,57 @@ public:
     std::shared_ptr<req_msg> get_rsv_msg() const { return rsv_msg_; }
     rpc_handler get_rsv_msg_handler() const { return rsv_msg_handler_; }
 
+    // --- For pipelined replication, should be called under `lock_`. ---
+
+    void add_inflight_append(uint64_t start_idx, uint64_t bytes) {
+        inflight_appends_.push_back({start_idx, bytes, false});
+        inflight_bytes_ += bytes;
+    }
+
+    /**
+     * Remove the oldest in-flight append entries request,
+     * as its response has arrived.
+     *
+     * @param[out] start_idx_out Start log index of the request.
+     * @param[out] stale_out `true` if the request was sent before
+     *                       the window was invalidated.
+     * @return `false` if there is no in-flight request.
+     */
+    bool pop_inflight_append(uint64_t& start_idx_out, bool& stale_out) {
+        if (inflight_appends_.empty()) return false;
+        inflight_append& ia = inflight_appends_.front();
+        start_idx_out = ia.start_idx_;
+        stale_out = ia.stale_;
+        inflight_bytes_ -= ia.bytes_;
+        inflight_appends_.pop_front();
+        return true;
+    }
+
+    /**
+     * Mark all in-flight requests as stale, so that their responses
+     * will not move the next log index again.
+     */
+    void invalidate_inflight_appends() {
+        for (auto& entry: inflight_appends_) entry.stale_ = true;
+        pipeline_ready_ = false;
+    }
+
+    /**
+     * Forget all in-flight requests, should be called when the
+     * responses will never arrive (e.g., new connection).
+     */
+    void clear_inflight_appends() {
+        inflight_appends_.clear();
+        inflight_bytes_ = 0;
+        pipeline_ready_ = false;
+    }
+
+    size_t get_num_inflight_appends() const { return inflight_appends_.size(); }
+    uint64_t get_inflight_append_bytes() const { return inflight_bytes_; }
+
+    void set_pipeline_ready(bool to) { pipeline_ready_ = to; }
+    bool is_pipeline_ready() const { return pipeline_ready_; }
+
 private:
     void handle_rpc_result(std::shared_ptr<peer> myself,
                            std::shared_ptr<rpc_client> my_rpc_client,
@@ -268,6 +348,12 @@ private:
                            std::shared_ptr<resp_msg>& resp,
                            std::shared_ptr<rpc_exception>& err);
 
+    void handle_ctrl_rpc_result(std::shared_ptr<peer> myself,
+                                std::shared_ptr<rpc_client> my_rpc_client,
+                                rpc_handler& handler,
+                                std::shared_ptr<resp_msg>& resp,
+                                std::shared_ptr<rpc_exception>& err);
+
     /**
      * Information (config) of this server.
      */
@@ -284,7 +370,18 @@ private:
     std::shared_ptr<rpc_client> rpc_;
 
     /**
-     * Guard of `rpc_`.
+     * RPC client for control messages to this server,
+     * created on the first use. Guarded by `rpc_protector_`.
+     */
+    std::shared_ptr<rpc_client> ctrl_rpc_;
+
+    /**
+     * `true` if a control message is in flight.
+     */
+    std::atomic<bool> ctrl_busy_flag_;
+
+    /**
+     * Guard of `rpc_` and `ctrl_rpc_`.
      */
     std::mutex rpc_protector_;
 
@@ -466,6 +563,33 @@ private:
      */
     rpc_handler rsv_msg_handler_;
 
+    /**
+     * Append entries request sent to this peer whose response
+     * has not arrived yet, used by pipelined replication.
+     */
+    struct inflight_append {
+        uint64_t start_idx_;
+        uint64_t bytes_;
+        bool stale_;
+    };
+
+    /**
+     * In-flight append entries requests, in the order they were sent.
+     */
+    std::deque<inflight_append> inflight_appends_;
+
+    /**
+     * Total size of log entries in `inflight_appends_`.
+     */
+    uint64_t inflight_bytes_;
+
+    /**
+     * `true` if the last append entries request to this peer was accepted,
+     * so that the leader can send the next one without waiting for
+     * the response.
+     */
+    bool pipeline_ready_;
+
     /**
      * Logger instance.
      */
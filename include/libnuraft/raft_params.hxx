@@ -92,10 +92,20 @@ struct raft_params {
         , locking_method_type_(dual_mutex)
         , return_method_(blocking)
         , auto_forwarding_req_timeout_(0)
+        , auto_forwarding_batch_size_(0)
+        , auto_forwarding_max_batches_in_flight_(4)
         , grace_period_of_lagging_state_machine_(0)
         , use_bg_thread_for_snapshot_io_(false)
         , use_full_consensus_among_healthy_members_(false)
-        , parallel_log_appending_(false) {}
+        , parallel_log_appending_(false)
+        , max_append_reqs_in_flight_(0)
+        , max_append_bytes_in_flight_(0)
+        , max_commit_batch_size_(0)
+        , group_commit_window_us_(0)
+        , group_commit_max_bytes_(0)
+        , use_control_connection_(false)
+        , data_connections_per_peer_(1)
+        , log_tail_cache_size_(0) {}
 
     /**
      * Election timeout upper bound in milliseconds
@@ -338,6 +348,80 @@ struct raft_params {
         return *this;
     }
 
+    /**
+     * Enable batched auto-forwarding.
+     *
+     * @param batch_size Max number of client requests forwarded together.
+     * @param max_in_flight Max number of batches in flight to the leader.
+     * @return self
+     */
+    raft_params& with_auto_forwarding_batching(int32_t batch_size,
+                                               int32_t max_in_flight = 4) {
+        auto_forwarding_batch_size_ = batch_size;
+        auto_forwarding_max_batches_in_flight_ = max_in_flight;
+        return *this;
+    }
+
+    /**
+     * Enable pipelined replication, by setting the per-peer window.
+     *
+     * @param max_reqs Max number of in-flight append entries requests per peer.
+     * @param max_bytes Max total size of log entries in flight per peer,
+     *                  0 for unlimited.
+     * @return self
+     */
+    raft_params& with_append_pipelining(int32_t max_reqs, int64_t max_bytes = 0) {
+        max_append_reqs_in_flight_ = max_reqs;
+        max_append_bytes_in_flight_ = max_bytes;
+        return *this;
+    }
+
+    /**
+     * Check if pipelined replication is enabled.
+     *
+     * @return `true` if more than one append entries request can be
+     *         in flight per peer.
+     */
+    bool append_pipelining_enabled() const { return max_append_reqs_in_flight_ > 1; }
+
+    /**
+     * Enable batched commit, by setting the max number of logs
+     * that the state machine commits at once.
+     *
+     * @param max_logs Max number of logs passed to
+     *                 `state_machine::commit_batch_ext`.
+     * @return self
+     */
+    raft_params& with_commit_batch_size(int32_t max_logs) {
+        max_commit_batch_size_ = max_logs;
+        return *this;
+    }
+
+    /**
+     * Enable leader-side group commit of client requests.
+     *
+     * @param window_us Max time to gather concurrent requests, in microseconds.
+     * @param max_bytes Max total size of log entries in a group,
+     *                  0 for unlimited.
+     * @return self
+     */
+    raft_params& with_group_commit(int32_t window_us, int64_t max_bytes = 0) {
+        group_commit_window_us_ = window_us;
+        group_commit_max_bytes_ = max_bytes;
+        return *this;
+    }
+
+    /**
+     * Number of recent logs cached by Raft server.
+     *
+     * @param num_logs Number of logs, 0 to disable.
+     * @return self
+     */
+    raft_params& with_log_tail_cache(int32_t num_logs) {
+        log_tail_cache_size_ = num_logs;
+        return *this;
+    }
+
     /**
      * Return heartbeat interval.
      * If given heartbeat interval is smaller than a specific value
@@ -537,6 +621,29 @@ public:
      */
     int32_t auto_forwarding_req_timeout_;
 
+    /**
+     * (Experimental)
+     * If greater than 1, client requests forwarded by a follower
+     * (auto-forwarding) are gathered into batches of up to the given
+     * number of requests, and each batch is sent to the leader as a
+     * single message. Batches are pipelined over the auto-forwarding
+     * connections, and the result of each request is returned from
+     * the batched response. Requests are batched only when the previous
+     * batches are still in flight, so that a request does not wait
+     * under light load.
+     *
+     * Only `append_entries` requests are batched. The leader should be
+     * able to handle `client_batch_request`, hence all members should
+     * be upgraded first.
+     */
+    int32_t auto_forwarding_batch_size_;
+
+    /**
+     * Max number of forwarded batches in flight to the leader,
+     * effective only when `auto_forwarding_batch_size_` is enabled.
+     */
+    int32_t auto_forwarding_max_batches_in_flight_;
+
     /**
      * If non-zero, any server whose state machine's commit index is
      * lagging behind the last committed log index will not
@@ -597,9 +704,116 @@ public:
      *
      * Note that parallel log appending is available for the leader only,
      * and followers will wait for `notify_log_append_completion` call
-     * before returning the response.
+     * before returning the response. The response is deferred by
+     * `resp_msg::set_async_cb` instead of blocking the thread, so that
+     * the RPC listener should support it.
      */
     bool parallel_log_appending_;
+
+    /**
+     * (Experimental)
+     * Max number of append entries requests that can be in flight
+     * to each peer at the same time. If it is greater than 1, the leader
+     * does not wait for the response of the previous request, but
+     * optimistically advances the peer's next log index and keeps sending
+     * the following logs (i.e., pipelined replication). On rejection,
+     * the leader drops the window and rewinds the peer's log index
+     * the same way as non-pipelined mode.
+     *
+     * The RPC client should be able to handle multiple requests at the same
+     * time and return their responses in the same order as requests.
+     *
+     * If 0 or 1, only one request will be in flight at a time.
+     */
+    int32_t max_append_reqs_in_flight_;
+
+    /**
+     * (Experimental)
+     * Max total size of log entries (in bytes) that can be in flight
+     * to each peer in pipelined replication mode. The first request
+     * is always allowed regardless of its size.
+     *
+     * If 0, there is no limit on the size.
+     */
+    int64_t max_append_bytes_in_flight_;
+
+    /**
+     * (Experimental)
+     * Max number of contiguous application logs that are committed
+     * at once. If it is greater than 1, Raft reads the logs to commit
+     * in a range and passes them to `state_machine::commit_batch_ext`
+     * instead of calling `commit_ext` for each log. Config logs are not
+     * batched. In that case, `StateMachineExecution` callback is invoked
+     * once per batch, with the last log index in the batch.
+     *
+     * If 0 or 1, logs are committed one by one.
+     */
+    int32_t max_commit_batch_size_;
+
+    /**
+     * (Experimental)
+     * If positive, client requests (`append_entries`) coming to the leader
+     * at the same time are handled as a group: the first request waits
+     * up to this time (in microseconds) for other requests being handled
+     * to join, and then appends the logs of all requests in a single log
+     * store batch, followed by a single replication trigger. A request
+     * coming alone does not wait. Each request still gets
+     * its own result.
+     *
+     * If 0, each request is handled separately.
+     */
+    int32_t group_commit_window_us_;
+
+    /**
+     * (Experimental)
+     * If positive, a group of client requests is handled immediately
+     * without waiting for `group_commit_window_us_`, once the total size
+     * of log entries in the group reaches this value (in bytes).
+     */
+    int64_t group_commit_max_bytes_;
+
+    /**
+     * (Experimental)
+     * If `true`, the leader keeps a separate connection to each peer
+     * for control messages, in addition to the one for replication.
+     * If nothing has been sent to a peer during the last heartbeat
+     * interval because a large append entries or snapshot request
+     * is still in progress, the heartbeat is sent through the control
+     * connection so that the peer does not start a false election.
+     * Vote requests are also sent through it. Responses through the
+     * control connection count toward the health of the peer.
+     *
+     * The receiver should be able to handle `custom_notification_request`
+     * of heartbeat type, hence all members should be upgraded first.
+     */
+    bool use_control_connection_;
+
+    /**
+     * (Experimental)
+     * Number of connections to each peer for replication. If it is
+     * greater than 1, append entries requests are striped across
+     * the connections, so that a single connection (e.g., its
+     * congestion window or TLS encryption) does not limit the
+     * replication throughput. It is effective only when pipelined
+     * replication is enabled (`max_append_reqs_in_flight_`).
+     *
+     * As requests may arrive out of order, a follower holds a request
+     * that does not follow its last log, until the preceding requests
+     * arrive. Hence, all members should have the same value.
+     */
+    int32_t data_connections_per_peer_;
+
+    /**
+     * (Experimental)
+     * If positive, Raft server keeps the given number of the most recent
+     * logs in memory, and reads them from there instead of the log store,
+     * so that replication and commit of recent logs do not call the log
+     * store. Cached logs are not copied, but they are kept alive until
+     * they are evicted.
+     *
+     * This option is applied only at initialization.
+     */
+    int32_t log_tail_cache_size_;
 };
 
 } // namespace nuraft
@@ -31,6 +31,7 @@ limitations under the License.
 #include "srv_state.hxx"
 #include "timer_task.hxx"
 
+#include <condition_variable>
 #include <list>
 #include <map>
 #include <mutex>
@@ -46,6 +47,7 @@ class cluster_config;
 class custom_notification_msg;
 class delayed_task_scheduler;
 class EventAwaiter;
+class log_tail_cache;
 class logger;
 class peer;
 class rpc_client;
@@ -706,6 +708,9 @@ public:
      * Note that calling this API once for multiple logs is acceptable
      * and recommended.
      *
+     * On followers, this API sends the deferred responses of
+     * append_entries requests whose logs have become durable.
+     *
      * @param ok `true` if appending succeeded.
      */
     void notify_log_append_completion(bool ok);
@@ -731,6 +736,10 @@ protected:
 
     struct commit_ret_elem;
 
+    struct commit_ret_table;
+
+    struct cli_req_elem;
+
     struct pre_vote_status_t {
         pre_vote_status_t()
             : quorum_reject_count_(0)
@@ -763,6 +772,43 @@ protected:
      * A set of components required for auto-forwarding.
      */
     struct auto_fwd_pkg;
+    struct auto_fwd_req_resp;
+
+    /**
+     * Log entries read for replication.
+     */
+    struct repl_cache_elem {
+        uint64_t term_;
+        uint64_t start_idx_;
+        uint64_t end_idx_;
+        int64_t batch_size_hint_;
+        std::shared_ptr<std::vector<std::shared_ptr<log_entry>>> entries_;
+    };
+
+    /**
+     * Response of append_entries request, deferred until
+     * the appended logs become durable.
+     */
+    struct pending_append_resp {
+        uint64_t term_;
+        uint64_t target_idx_;
+        // Log index to commit up to once the logs become durable.
+        uint64_t commit_idx_;
+        uint64_t deferred_at_us_;
+        std::shared_ptr<resp_msg> resp_;
+        std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> result_;
+    };
+
+    /**
+     * Append_entries request that arrived earlier than its preceding
+     * requests, through one of the striped connections.
+     */
+    struct parked_append_req {
+        std::shared_ptr<req_msg> req_;
+        std::shared_ptr<resp_msg> resp_;
+        std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> result_;
+        uint64_t parked_at_us_;
+    };
 
 protected:
     /**
@@ -787,6 +833,7 @@ protected:
     uint32_t get_num_voting_members();
     int32_t get_quorum_for_election();
     uint32_t get_quorum_for_commit();
+    uint32_t get_quorum_for_commit(uint32_t num_voting_members);
     int32_t get_leadership_expiry();
     size_t get_not_responding_peers();
     size_t get_num_stale_peers();
@@ -798,11 +845,15 @@ protected:
                                                      const req_ext_params& ext_params);
     std::shared_ptr<resp_msg>
     handle_cli_req(req_msg& req, const req_ext_params& ext_params, uint64_t timestamp_us);
+    void handle_cli_reqs_prelock(std::vector<cli_req_elem*>& elems);
+    void handle_cli_reqs(std::vector<cli_req_elem*>& elems);
+    bool handle_cli_req_group(cli_req_elem& elem);
     std::shared_ptr<resp_msg>
     handle_cli_req_callback(std::shared_ptr<commit_ret_elem> elem,
                             std::shared_ptr<resp_msg> resp);
     result_ptr<buffer_ptr>
     handle_cli_req_callback_async(result_ptr<buffer_ptr> async_res);
+    std::shared_ptr<resp_msg> handle_cli_batch_req(req_msg& req);
 
     void drop_all_pending_commit_elems();
 
@@ -829,6 +880,7 @@ protected:
     void request_vote(bool force_vote);
     void request_append_entries();
     bool request_append_entries(std::shared_ptr<peer> p);
+    bool request_pipelined_append_entries(std::shared_ptr<peer>& p);
     void handle_peer_resp(std::shared_ptr<resp_msg>& resp,
                           std::shared_ptr<rpc_exception>& err);
     void handle_append_entries_resp(resp_msg& resp);
@@ -839,6 +891,9 @@ protected:
     void handle_priority_change_resp(resp_msg& resp);
     void handle_reconnect_resp(resp_msg& resp);
     void handle_custom_notification_resp(resp_msg& resp);
+    bool send_ctrl_heartbeat(std::shared_ptr<peer>& p);
+    void handle_ctrl_peer_resp(std::shared_ptr<resp_msg>& resp,
+                               std::shared_ptr<rpc_exception>& err);
 
     bool try_update_precommit_index(uint64_t desired, const size_t MAX_ATTEMPTS = 10);
 
@@ -849,6 +904,11 @@ protected:
     void reset_srv_to_join();
     void reset_srv_to_leave();
     std::shared_ptr<req_msg> create_append_entries_req(std::shared_ptr<peer>& pp);
+    std::shared_ptr<std::vector<std::shared_ptr<log_entry>>>
+    get_log_entries_for_replication(uint64_t term,
+                                    uint64_t start_idx,
+                                    uint64_t end_idx,
+                                    int64_t batch_size_hint);
     std::shared_ptr<req_msg> create_sync_snapshot_req(std::shared_ptr<peer>& pp,
                                                       uint64_t last_log_idx,
                                                       uint64_t term,
@@ -881,6 +941,17 @@ protected:
                                std::shared_ptr<std::exception>& err);
     void on_retryable_req_err(std::shared_ptr<peer>& p, std::shared_ptr<req_msg>& req);
     uint64_t term_for_log(uint64_t log_idx);
+    uint64_t cached_term_at(uint64_t log_idx);
+    void cached_terms_in_range(uint64_t start,
+                               uint64_t end,
+                               std::vector<uint64_t>& terms_out);
+    std::shared_ptr<log_entry> cached_entry_at(uint64_t log_idx);
+    uint64_t first_log_idx_of_term(uint64_t log_idx);
+    uint64_t last_log_idx_of_term(uint64_t term, uint64_t max_idx);
+    std::shared_ptr<std::vector<std::shared_ptr<log_entry>>>
+    cached_log_entries(uint64_t start,
+                       uint64_t end,
+                       int64_t batch_size_hint_in_bytes = 0);
     void on_log_compacted(uint64_t log_idx,
                           bool result,
                           std::shard_ptr<std::exception>& err);
@@ -894,6 +965,15 @@ protected:
     void commit_app_log(uint64_t idx_to_commit,
                         std::shared_ptr<log_entry>& le,
                         bool need_to_handle_commit_elem);
+    uint64_t commit_app_logs_in_batch(uint64_t start_idx,
+                                      uint64_t last_idx,
+                                      bool need_to_handle_commit_elem);
+    void set_commit_ret_elem(uint64_t sm_idx,
+                             uint64_t pc_idx,
+                             std::shared_ptr<buffer>& ret_value,
+                             std::list<std::shared_ptr<commit_ret_elem>>& async_elems);
+    void invoke_async_commit_results(
+        std::list<std::shared_ptr<commit_ret_elem>>& async_elems);
     void commit_conf(uint64_t idx_to_commit, std::shared_ptr<log_entry>& le);
 
     result_ptr<buffer_ptr>
@@ -908,6 +988,13 @@ protected:
                                std::shared_ptr<rpc_client> rpc_cli,
                                std::shared_ptr<resp_msg>& resp,
                                std::shared_ptr<rpc_exception>& err);
+    void auto_fwd_send_batches(std::shared_ptr<auto_fwd_pkg> cur_pkg,
+                               int32_t leader_id);
+    void auto_fwd_batch_resp_handler(std::shared_ptr<std::list<auto_fwd_req_resp>> batch,
+                                     std::shared_ptr<auto_fwd_pkg> cur_pkg,
+                                     int32_t leader_id,
+                                     std::shared_ptr<resp_msg>& resp,
+                                     std::shared_ptr<rpc_exception>& err);
     void cleanup_auto_fwd_pkgs();
 
     void set_config(const std::shared_ptr<cluster_config>& new_config);
@@ -931,6 +1018,11 @@ protected:
                                std::shared_ptr<custom_notification_msg> msg,
                                std::shared_ptr<resp_msg> resp);
 
+    std::shared_ptr<resp_msg>
+    handle_ctrl_heartbeat(req_msg& req,
+                          std::shared_ptr<custom_notification_msg> msg,
+                          std::shared_ptr<resp_msg> resp);
+
     void remove_peer_from_peers(const std::shared_ptr<peer>& pp);
 
     void check_overall_status();
@@ -939,6 +1031,18 @@ protected:
 
     uint64_t get_current_leader_index();
 
+    void defer_append_entries_resp(std::shared_ptr<resp_msg>& resp,
+                                   uint64_t target_idx,
+                                   uint64_t commit_idx);
+    void flush_pending_append_resps(bool abandon);
+    bool park_append_entries_req(req_msg& req, std::shared_ptr<resp_msg>& resp);
+    void process_parked_append_reqs(bool abandon);
+    void finish_parked_append_req(parked_append_req& elem, std::shared_ptr<resp_msg> resp);
+
+    void invalidate_voter_matched_idxs();
+    void rebuild_voter_matched_idxs();
+    void update_voter_matched_idx(const std::shared_ptr<peer>& p);
+
 protected:
     static const int default_snapshot_sync_block_size;
 
@@ -1247,6 +1351,12 @@ protected:
      */
     std::shared_ptr<log_store> log_store_;
 
+    /**
+     * Cache of recent logs in `log_store_`, and its next log index.
+     * Every change of `log_store_` should be reflected to it.
+     */
+    std::unique_ptr<log_tail_cache> log_tail_;
+
     /**
      * (Read-only)
      * State machine instance.
@@ -1329,6 +1439,27 @@ protected:
      */
     uint64_t srv_to_leave_target_idx_;
 
+    /**
+     * Matched log indexes of voting members except for this server,
+     * in descending order. It is updated incrementally whenever
+     * a peer's matched log index changes, so that the quorum commit
+     * index can be found without sorting. Protected by `lock_`.
+     */
+    std::vector<uint64_t> voter_matched_idxs_;
+
+    /**
+     * Map of <peer ID, matched log index in `voter_matched_idxs_`>,
+     * protected by `lock_`.
+     */
+    std::unordered_map<int32_t, uint64_t> voter_matched_map_;
+
+    /**
+     * If `true`, `voter_matched_idxs_` should be rebuilt from `peers_`,
+     * as the set of voting members may have changed.
+     * Protected by `lock_`.
+     */
+    bool voter_matched_dirty_;
+
     /**
      * Config of the server preparing to join,
      * protected by `lock_`.
@@ -1345,6 +1476,40 @@ protected:
      */
     std::mutex cli_lock_;
 
+    /**
+     * Client requests waiting to be handled as a group,
+     * protected by `group_commit_lock_`.
+     */
+    std::vector<cli_req_elem*> group_commit_queue_;
+
+    /**
+     * Total size of log entries in `group_commit_queue_`.
+     */
+    size_t group_commit_bytes_;
+
+    /**
+     * `true` if a thread is gathering requests in `group_commit_queue_`.
+     */
+    bool group_commit_active_;
+
+    /**
+     * Number of client requests being handled through group commit,
+     * including the ones waiting in `group_commit_queue_`,
+     * protected by `group_commit_lock_`.
+     */
+    size_t group_commit_callers_;
+
+    /**
+     * Lock for group commit.
+     */
+    std::mutex group_commit_lock_;
+
+    /**
+     * Condition variable to wake up the thread gathering requests,
+     * once `group_commit_bytes_` reaches the limit.
+     */
+    std::condition_variable group_commit_cv_;
+
     /**
      * Condition variable to invoke BG commit thread.
      */
@@ -1367,14 +1532,8 @@ protected:
 
     /**
      * Client requests waiting for replication.
-     * Only used in blocking mode.
      */
-    std::map<uint64_t, std::shared_ptr<commit_ret_elem>> commit_ret_elems_;
-
-    /**
-     * Lock for `commit_ret_elems_`.
-     */
-    std::mutex commit_ret_elems_lock_;
+    std::unique_ptr<commit_ret_table> commit_ret_elems_;
 
     /**
      * Condition variable to invoke Raft server for
@@ -1399,6 +1558,12 @@ protected:
      */
     rpc_handler ex_resp_handler_;
 
+    /**
+     * (Read-only)
+     * Response handler for heartbeats sent through control connection.
+     */
+    rpc_handler ctrl_resp_handler_;
+
     /**
      * Last snapshot instance.
      */
@@ -1409,6 +1574,18 @@ protected:
      */
     mutable std::mutex last_snapshot_lock_;
 
+    /**
+     * Log entries recently read for replication, most recent first.
+     * Peers at the same log index reuse them, instead of reading
+     * and decoding the same log entries from the log store again.
+     */
+    std::list<repl_cache_elem> repl_cache_;
+
+    /**
+     * Lock for `repl_cache_`.
+     */
+    std::mutex repl_cache_lock_;
+
     /**
      * Timer that will be reset on becoming a leader.
      */
@@ -1434,13 +1611,24 @@ protected:
     /**
      * (Experimental)
      * Used when `raft_params::parallel_log_appending_` is set.
-     * Follower will wait for the asynchronous log appending using
-     * this event awaiter.
+     * Responses of append_entries requests whose logs are not durable yet.
+     * They are sent by `notify_log_append_completion`, instead of
+     * blocking the thread handling the request.
+     *
+     * Guarded by `lock_`.
+     */
+    std::list<pending_append_resp> pending_append_resps_;
+
+    /**
+     * (Experimental)
+     * Used when `raft_params::data_connections_per_peer_` is greater than 1.
+     * Append_entries requests that do not follow the last log yet,
+     * keyed by their last log index. They are processed once their
+     * preceding requests arrive through the other connections.
      *
-     * WARNING: We are assuming that only one thraed is using this
-     *          awaiter at a time, by the help of `lock_`.
+     * Guarded by `lock_`.
      */
-    std::unique_ptr<EventAwaiter> ea_follower_log_append_;
+    std::map<uint64_t, parked_append_req> parked_append_reqs_;
 
     /**
      * If `true`, test mode is enabled.
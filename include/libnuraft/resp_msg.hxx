@@ -71,6 +71,8 @@ public:
         accepted_ = true;
     }
 
+    void set_next_idx(uint64_t next_idx) { next_idx_ = next_idx; }
+
     void set_ctx(std::shared_ptr<buffer> src) { ctx_ = src; }
 
     std::shared_ptr<buffer> get_ctx() const { return ctx_; }
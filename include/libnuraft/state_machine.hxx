@@ -25,6 +25,7 @@ limitations under the License.
 #include "pp_util.hxx"
 
 #include <unordered_map>
+#include <vector>
 
 namespace nuraft {
 
@@ -72,6 +73,29 @@ public:
         return commit(params.log_idx, *params.data);
     }
 
+    /**
+     * (Optional)
+     * Commit the given contiguous Raft logs at once. It will be called
+     * instead of `commit_ext` only if `raft_params::max_commit_batch_size_`
+     * is greater than 1. The default implementation calls `commit_ext`
+     * for each log.
+     *
+     * Same as `commit()`, memory buffers are owned by caller.
+     *
+     * @param start_log_idx Raft log number of the first log.
+     * @param data_list Payloads of the Raft logs, starting from `start_log_idx`.
+     * @param[out] ret_values Result value of each log, in the same order
+     *                        as `data_list`.
+     */
+    virtual void commit_batch_ext(uint64_t start_log_idx,
+                                  std::vector<std::shared_ptr<buffer>>& data_list,
+                                  std::vector<std::shared_ptr<buffer>>& ret_values) {
+        ret_values.resize(data_list.size());
+        for (size_t ii = 0; ii < data_list.size(); ++ii) {
+            ret_values[ii] = commit_ext(ext_op_params(start_log_idx + ii, data_list[ii]));
+        }
+    }
+
     /**
      * (Optional)
      * Handler on the commit of a configuration change.
@@ -346,6 +370,17 @@ public:
         std::unordered_map<int, uint64_t> peer_index_map_;
     };
 
+    /**
+     * (Optional)
+     * If this function returns `false`, Raft does not call `adjust_commit_index`
+     * and skips building `peer_index_map_` for it, which saves some CPU on
+     * every commit decision. A state machine not overriding
+     * `adjust_commit_index` can override this function to opt out.
+     *
+     * @return `true` if `adjust_commit_index` should be called.
+     */
+    virtual bool uses_adjust_commit_index() const { return true; }
+
     /**
      * This function will be called when Raft succeeds in replicating logs
      * to an arbitrary follower and attempts to commit logs. Users can manually
@@ -353,6 +388,9 @@ public:
      * or greater than the given `current_commit_index`. Otherwise, no log
      * will be committed.
      *
+     * This function is not called if `uses_adjust_commit_index`
+     * returns `false`.
+     *
      * @param params Parameters.
      * @return Adjusted commit index.
      */
@@ -6,6 +6,8 @@ set -e
 ./tests/timer_test --abort-on-failure
 ./tests/strfmt_test --abort-on-failure
 ./tests/stat_mgr_test --abort-on-failure
+./tests/crc32_test --abort-on-failure
+./tests/file_log_store_test --abort-on-failure
 ./tests/raft_server_test --abort-on-failure
 ./tests/failure_test --abort-on-failure
 ./tests/asio_service_test --abort-on-failure
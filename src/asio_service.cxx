@@ -44,7 +44,9 @@ limitations under the License.
 #include <asio.hpp>
 #endif
 
+#include <algorithm>
 #include <atomic>
+#include <cstring>
 #include <ctime>
 #include <exception>
 #include <fstream>
@@ -52,6 +54,8 @@ limitations under the License.
 #include <queue>
 #include <regex>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 #ifdef USE_BOOST_ASIO
 using namespace boost;
@@ -60,6 +64,15 @@ using namespace boost;
 #define ERROR_CODE asio::error_code
 #endif
 
+#if defined(ASIO_HAS_LOCAL_SOCKETS) || defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#define LOCAL_SOCKET_SUPPORTED (1)
+#include <unistd.h>
+#endif
+
+// Either TCP or Unix domain socket.
+using stream_socket = asio::generic::stream_protocol::socket;
+using stream_endpoint = asio::generic::stream_protocol::endpoint;
+
 // #define SSL_LIBRARY_NOT_FOUND (1)
 #ifdef SSL_LIBRARY_NOT_FOUND
 #include "mock_ssl.hxx"
@@ -71,7 +84,7 @@ using ssl_context = mock_ssl_context;
 #else
 #include <asio/ssl.hpp>
 #endif
-using ssl_socket = asio::ssl::stream<asio::ip::tcp::socket&>;
+using ssl_socket = asio::ssl::stream<stream_socket&>;
 using ssl_context = asio::ssl::context;
 #endif
 
@@ -121,6 +134,10 @@ using ssl_context = asio::ssl::context;
 // If set, each log entry will contain timestamp.
 #define INCLUDE_LOG_TIMESTAMP (0x4)
 
+// If set, RPC message includes 8-byte request ID at the beginning of
+// carried data, and the response of the request can be returned out of order.
+#define INCLUDE_REQ_ID (0x8)
+
 // =======================
 
 namespace nuraft {
@@ -146,7 +163,7 @@ public:
     template <typename BB, typename FF>
     static void write(bool is_ssl,
                       ssl_socket& _ssl_socket,
-                      asio::ip::tcp::socket& tcp_socket,
+                      stream_socket& tcp_socket,
                       const BB& buffer,
                       FF func) {
         if (is_ssl)
@@ -158,7 +175,7 @@ public:
     template <typename BB, typename FF>
     static void read(bool is_ssl,
                      ssl_socket& _ssl_socket,
-                     asio::ip::tcp::socket& tcp_socket,
+                     stream_socket& tcp_socket,
                      const BB& buffer,
                      FF func) {
         if (is_ssl)
@@ -166,6 +183,423 @@ public:
         else
             asio::async_read(tcp_socket, buffer, func);
     }
+
+    template <typename BB, typename FF>
+    static void read_some(bool is_ssl,
+                          ssl_socket& _ssl_socket,
+                          stream_socket& tcp_socket,
+                          const BB& buffer,
+                          FF func) {
+        if (is_ssl)
+            _ssl_socket.async_read_some(buffer, func);
+        else
+            tcp_socket.async_read_some(buffer, func);
+    }
+};
+
+static const size_t MIN_READ_BUFFER_SIZE = 1024;
+
+// Messages larger than this will not be merged into a single buffer
+// for SSL write.
+static const size_t MAX_SSL_MERGE_SIZE = 64 * 1024;
+
+// === Read buffer ===
+//     Keeps the bytes read from the socket beyond the current message,
+//     so that the following messages can be parsed without another read.
+class read_buffer {
+public:
+    read_buffer(size_t capacity)
+        : buf_(std::max(capacity, MIN_READ_BUFFER_SIZE))
+        , begin_(0)
+        , end_(0) {}
+
+    size_t capacity() const { return buf_.size(); }
+
+    size_t size() const { return end_ - begin_; }
+
+    const std::byte* data() const { return buf_.data() + begin_; }
+
+    void consume(size_t len) {
+        begin_ += len;
+        if (begin_ == end_) {
+            begin_ = end_ = 0;
+        }
+    }
+
+    /**
+     * Copy (and consume) up to `len` buffered bytes into `dst`.
+     *
+     * @return Number of bytes copied.
+     */
+    size_t take(std::byte* dst, size_t len) {
+        size_t to_copy = std::min(len, size());
+        if (to_copy) {
+            std::memcpy(dst, data(), to_copy);
+            consume(to_copy);
+        }
+        return to_copy;
+    }
+
+    /**
+     * Invoke `func(err)` once at least `need` bytes are buffered.
+     * Each read fetches as many bytes as available from the socket.
+     * `need` should not be greater than the capacity.
+     *
+     * If enough bytes are already buffered, `func` is invoked
+     * immediately by the caller thread.
+     */
+    template <typename FF>
+    void fill(bool is_ssl,
+              ssl_socket& _ssl_socket,
+              stream_socket& tcp_socket,
+              asio::io_service::strand& strand,
+              size_t need,
+              FF func) {
+        if (size() >= need) {
+            func(ERROR_CODE());
+            return;
+        }
+        if (begin_ + need > buf_.size()) {
+            // Not enough room at the tail, move the remaining bytes front.
+            std::memmove(buf_.data(), buf_.data() + begin_, size());
+            end_ -= begin_;
+            begin_ = 0;
+        }
+        aa::read_some(is_ssl,
+                      _ssl_socket,
+                      tcp_socket,
+                      asio::buffer(buf_.data() + end_, buf_.size() - end_),
+                      asio::bind_executor(strand,
+                                          [this, is_ssl, &_ssl_socket, &tcp_socket,
+                                           &strand, need, func](const ERROR_CODE& err,
+                                                                size_t len) mutable {
+                                              if (err) {
+                                                  func(err);
+                                                  return;
+                                              }
+                                              end_ += len;
+                                              fill(is_ssl,
+                                                   _ssl_socket,
+                                                   tcp_socket,
+                                                   strand,
+                                                   need,
+                                                   func);
+                                          }));
+    }
+
+    /**
+     * Read exactly `len` bytes into `dst`, starting from the buffered
+     * bytes, and then invoke `func(err)`. If the remaining part fits in
+     * this buffer, it is read through this buffer so that the following
+     * messages are read ahead together. Otherwise, it is read directly
+     * into `dst`.
+     */
+    template <typename FF>
+    void read(bool is_ssl,
+              ssl_socket& _ssl_socket,
+              stream_socket& tcp_socket,
+              asio::io_service::strand& strand,
+              std::byte* dst,
+              size_t len,
+              FF func) {
+        size_t copied = take(dst, len);
+        size_t rest = len - copied;
+        if (!rest) {
+            func(ERROR_CODE());
+            return;
+        }
+
+        if (rest <= capacity()) {
+            fill(is_ssl,
+                 _ssl_socket,
+                 tcp_socket,
+                 strand,
+                 rest,
+                 [this, dst, copied, rest, func](const ERROR_CODE& err) mutable {
+                     if (!err) {
+                         take(dst + copied, rest);
+                     }
+                     func(err);
+                 });
+        } else {
+            aa::read(is_ssl,
+                     _ssl_socket,
+                     tcp_socket,
+                     asio::buffer(dst + copied, rest),
+                     asio::bind_executor(strand,
+                                         [func](const ERROR_CODE& err, size_t) mutable {
+                                             func(err);
+                                         }));
+        }
+    }
+
+private:
+    std::vector<std::byte> buf_;
+    size_t begin_;
+    size_t end_;
+};
+
+// With SSL, each element of a buffer sequence is written (and encrypted)
+// separately. Merge small ones into `merged` so that they go in one record.
+static void merge_for_ssl(std::vector<asio::const_buffer>& bufs,
+                          std::shared_ptr<buffer>& merged) {
+    if (bufs.size() < 2) return;
+    size_t total = asio::buffer_size(bufs);
+    if (total > MAX_SSL_MERGE_SIZE) return;
+
+    merged = buffer::alloc(total);
+    asio::buffer_copy(asio::buffer(merged->data_begin(), total), bufs);
+    bufs.clear();
+    bufs.push_back(asio::buffer(merged->data_begin(), total));
+}
+
+// Prefix of Unix domain socket endpoint, e.g., `unix:///tmp/raft.sock`.
+// If the path starts with `@`, it is an abstract socket (Linux only).
+static const std::string UNIX_SOCKET_PREFIX = "unix://";
+
+static bool is_unix_endpoint(const std::string& endpoint) {
+    return endpoint.compare(0, UNIX_SOCKET_PREFIX.size(), UNIX_SOCKET_PREFIX) == 0;
+}
+
+#ifdef LOCAL_SOCKET_SUPPORTED
+static asio::local::stream_protocol::endpoint get_unix_endpoint(const std::string& path) {
+    if (!path.empty() && path[0] == '@') {
+        // Abstract namespace: leading null byte instead of `@`.
+        return asio::local::stream_protocol::endpoint(std::string(1, '\0')
+                                                      + path.substr(1));
+    }
+    return asio::local::stream_protocol::endpoint(path);
+}
+#endif
+
+static void get_endpoint_addr(const stream_endpoint& ep,
+                              std::string& addr_out,
+                              uint32_t& port_out) {
+    if (ep.protocol().family() == asio::ip::tcp::v4().family()
+        || ep.protocol().family() == asio::ip::tcp::v6().family()) {
+        asio::ip::tcp::endpoint tcp_ep;
+        std::memcpy(tcp_ep.data(), ep.data(), ep.size());
+        tcp_ep.resize(ep.size());
+        addr_out = tcp_ep.address().to_string();
+        port_out = tcp_ep.port();
+    } else {
+        // Unix domain socket, the client side is unnamed.
+        addr_out = "unix";
+        port_out = 0;
+    }
+}
+
+// === Resolver cache ===
+//     Resolves `host:port` into endpoints (through the custom resolver if
+//     given), and keeps the result so that reconnections do not wait for
+//     name resolution. Shared by all clients of an `asio_service`.
+class resolver_cache {
+public:
+    using resolve_cb =
+        std::function<void(const std::vector<stream_endpoint>&, std::error_code)>;
+
+    resolver_cache(asio::io_service& io,
+                   const asio_service::options& opt,
+                   std::shared_ptr<logger> l)
+        : io_svc_(io)
+        , ttl_ms_(opt.resolver_cache_ttl_ms_)
+        , negative_ttl_ms_(opt.resolver_negative_ttl_ms_)
+        , custom_resolver_(opt.custom_resolver_)
+        , l_(l) {}
+
+    __nocopy__(resolver_cache);
+
+public:
+    /**
+     * Resolve the given endpoint, and invoke `cb` with the result.
+     * If a valid (or stale) result is cached, `cb` is invoked
+     * immediately by the caller thread.
+     */
+    void resolve(const std::string& host, const std::string& port, resolve_cb cb) {
+        if (!ttl_ms_) {
+            lookup(host, port, cb);
+            return;
+        }
+
+        std::string key = host + ":" + port;
+        uint64_t now_ms = get_now_ms();
+        std::unique_lock<std::mutex> l(lock_);
+        entry& ee = entries_[key];
+        if (ee.resolved_ && (now_ms < ee.expiry_ms_ || !ee.endpoints_.empty())) {
+            // Even though it is expired, the previous address is likely
+            // to be valid. Use it now, and refresh it in background.
+            std::vector<stream_endpoint> endpoints = ee.endpoints_;
+            std::error_code err = ee.err_;
+            bool refresh = (now_ms >= ee.expiry_ms_) && !ee.resolving_;
+            if (refresh) ee.resolving_ = true;
+            l.unlock();
+
+            if (refresh) {
+                p_db("refresh expired address of %s", key.c_str());
+                start_lookup(host, port);
+            }
+            cb(endpoints, err);
+            return;
+        }
+
+        // Nothing to use, wait for the lookup.
+        ee.waiters_.push_back(cb);
+        if (ee.resolving_) return;
+        ee.resolving_ = true;
+        l.unlock();
+        start_lookup(host, port);
+    }
+
+    /**
+     * Mark the cached address of the given endpoint as expired,
+     * e.g., when a connection to it fails.
+     */
+    void expire(const std::string& host, const std::string& port) {
+        if (!ttl_ms_) return;
+        std::lock_guard<std::mutex> l(lock_);
+        auto itr = entries_.find(host + ":" + port);
+        if (itr != entries_.end()) {
+            itr->second.expiry_ms_ = 0;
+        }
+    }
+
+private:
+    struct entry {
+        entry()
+            : resolved_(false)
+            , expiry_ms_(0)
+            , resolving_(false) {}
+        // `true` if the lookup has been done at least once.
+        bool resolved_;
+        // Result of the last successful lookup.
+        std::vector<stream_endpoint> endpoints_;
+        // Error of the last lookup, if it has never succeeded.
+        std::error_code err_;
+        // The time when the result expires.
+        uint64_t expiry_ms_;
+        // `true` if a lookup is in progress.
+        bool resolving_;
+        // Callbacks waiting for the lookup in progress.
+        std::list<resolve_cb> waiters_;
+    };
+
+    static uint64_t get_now_ms() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void start_lookup(const std::string& host, const std::string& port) {
+        // Do not block the caller, the custom resolver may be synchronous.
+        asio::post(io_svc_, [this, host, port]() {
+            lookup(host,
+                   port,
+                   [this, host, port](const std::vector<stream_endpoint>& endpoints,
+                                      std::error_code err) {
+                       lookup_done(host, port, endpoints, err);
+                   });
+        });
+    }
+
+    void lookup(const std::string& host, const std::string& port, resolve_cb cb) {
+        if (!custom_resolver_) {
+            execute_resolver(host, port, cb);
+            return;
+        }
+        custom_resolver_(host,
+                         port,
+                         [this, host, port, cb](const std::string& resolved_host,
+                                                const std::string& resolved_port,
+                                                std::error_code err) {
+                             if (err) {
+                                 p_wn("failed to resolve host %s by given custom "
+                                      "resolver due to error %d, %s",
+                                      host.c_str(),
+                                      err.value(),
+                                      err.message().c_str());
+                                 cb(std::vector<stream_endpoint>(), err);
+                                 return;
+                             }
+                             p_in("custom resolver: %s:%s to %s:%s",
+                                  host.c_str(),
+                                  port.c_str(),
+                                  resolved_host.c_str(),
+                                  resolved_port.c_str());
+                             execute_resolver(resolved_host, resolved_port, cb);
+                         });
+    }
+
+    void execute_resolver(const std::string& host, const std::string& port, resolve_cb cb) {
+        std::shared_ptr<asio::ip::tcp::resolver> resolver =
+            std::make_shared<asio::ip::tcp::resolver>(io_svc_);
+        asio::ip::tcp::resolver::query q(
+            host, port, asio::ip::tcp::resolver::query::all_matching);
+        resolver->async_resolve(
+            q,
+            [resolver, cb](std::error_code err, asio::ip::tcp::resolver::iterator itor) {
+                // Socket can be either TCP or Unix domain socket,
+                // convert resolved addresses into generic endpoints.
+                std::vector<stream_endpoint> endpoints;
+                if (!err) {
+                    for (asio::ip::tcp::resolver::iterator end; itor != end; ++itor) {
+                        endpoints.push_back(itor->endpoint());
+                    }
+                }
+                cb(endpoints, err);
+            });
+    }
+
+    void lookup_done(const std::string& host,
+                     const std::string& port,
+                     const std::vector<stream_endpoint>& endpoints,
+                     std::error_code err) {
+        std::string key = host + ":" + port;
+        uint64_t now_ms = get_now_ms();
+        std::list<resolve_cb> waiters;
+        std::vector<stream_endpoint> result;
+        std::error_code result_err;
+        {
+            std::lock_guard<std::mutex> l(lock_);
+            entry& ee = entries_[key];
+            ee.resolved_ = true;
+            ee.resolving_ = false;
+            if (!err) {
+                ee.endpoints_ = endpoints;
+                ee.err_ = std::error_code();
+                ee.expiry_ms_ = now_ms + ttl_ms_;
+            } else {
+                if (ee.endpoints_.empty()) {
+                    ee.err_ = err;
+                } else {
+                    // Keep using the previous address, and retry later.
+                    p_wn("failed to refresh address of %s, error %d, %s",
+                         key.c_str(),
+                         err.value(),
+                         err.message().c_str());
+                }
+                ee.expiry_ms_ = now_ms + negative_ttl_ms_;
+            }
+            result = ee.endpoints_;
+            result_err = ee.err_;
+            waiters.swap(ee.waiters_);
+        }
+
+        for (resolve_cb& cb: waiters) {
+            cb(result, result_err);
+        }
+    }
+
+    asio::io_service& io_svc_;
+    uint64_t ttl_ms_;
+    uint64_t negative_ttl_ms_;
+    std::function<void(const std::string&,
+                       const std::string&,
+                       asio_service_custom_resolver_response)>
+        custom_resolver_;
+    std::mutex lock_;
+    // Key: `host:port`.
+    std::unordered_map<std::string, entry> entries_;
+    std::shared_ptr<logger> l_;
 };
 
 // asio service implementation
@@ -177,7 +611,16 @@ public:
 
     const asio_service::options& get_options() const { return my_opt_; }
     asio::io_service& get_io_svc() { return io_svc_; }
+
+    /**
+     * Returns the `io_service` of the shard that the given key belongs to.
+     * If `sharded_io_context_` is disabled, it is always `io_svc_`.
+     */
+    asio::io_service& get_shard_io_svc(uint64_t key) {
+        return *shards_[key % shards_.size()];
+    }
     uint64_t assign_client_id() { return client_id_counter_.fetch_add(1); }
+    resolver_cache& get_resolver_cache() { return resolver_cache_; }
 
 private:
 #ifndef SSL_LIBRARY_NOT_FOUND
@@ -190,6 +633,12 @@ private:
 
 private:
     asio::io_service io_svc_;
+    // All shards, the first one is `io_svc_`.
+    std::vector<asio::io_service*> shards_;
+    // Shards other than `io_svc_`, and the work objects to keep them
+    // running while they have nothing to do.
+    std::list<std::unique_ptr<asio::io_service>> extra_shards_;
+    std::list<std::unique_ptr<asio::io_service::work>> extra_shard_works_;
     ssl_context ssl_server_ctx_;
     ssl_context ssl_client_ctx_;
     asio::steady_timer asio_timer_;
@@ -204,6 +653,7 @@ private:
     asio_service::options my_opt_;
     std::atomic<uint64_t> client_id_counter_;
     std::shared_ptr<logger> l_;
+    resolver_cache resolver_cache_;
     friend asio_service;
 };
 
@@ -213,6 +663,8 @@ typedef std::function<void(const std::shared_ptr<rpc_session>&)> session_closed_
 
 class rpc_session : public std::enable_shared_from_this<rpc_session>,
                     public raft_server_handler {
+    struct resp_slot;
+
 public:
     rpc_session(uint64_t id,
                 asio_service_impl* _impl,
@@ -224,6 +676,7 @@ public:
                 session_closed_callback& callback)
         : session_id_(id)
         , impl_(_impl)
+        , io_svc_(io)
         , handler_(handler)
         , socket_(io)
         , ssl_socket_(socket_, ssl_ctx)
@@ -235,7 +688,10 @@ public:
         , callback_(callback)
         , src_id_(-1)
         , is_leader_(false)
-        , cached_port_(0) {
+        , cached_port_(0)
+        , strand_(io)
+        , writing_(false)
+        , rbuf_(_impl->get_options().read_buffer_size_) {
         p_tr("asio rpc session created: %p", (void*)this);
     }
 
@@ -252,8 +708,7 @@ public:
         // this is safe since we only expose ctor to std::make_shared
         std::shared_ptr<rpc_session> self = this->shared_from_this();
 
-        cached_address_ = socket_.remote_endpoint().address().to_string();
-        cached_port_ = socket_.remote_endpoint().port();
+        get_endpoint_addr(socket_.remote_endpoint(), cached_address_, cached_port_);
         p_in("session %" PRIu64 " got connection from %s:%u (as a server)",
              session_id_,
              cached_address_.c_str(),
@@ -291,7 +746,7 @@ public:
 
             // Lazy stop.
             std::shared_ptr<asio::steady_timer> timer =
-                std::make_shared<asio::steady_timer>(impl_->get_io_svc());
+                std::make_shared<asio::steady_timer>(io_svc_);
             timer->expires_after(std::chrono::duration_cast<std::chrono::nanoseconds>(
                 std::chrono::milliseconds(SSL_GRACE_PERIOD_MS)));
             timer->async_wait([self, this, timer](const ERROR_CODE& err) -> void {
@@ -308,86 +763,19 @@ public:
     }
 
     void start(std::shared_ptr<rpc_session> self) {
-        header_->pos(0);
-        aa::read(ssl_enabled_,
-                 ssl_socket_,
-                 socket_,
-                 asio::buffer(header_->data(), RPC_REQ_HEADER_SIZE),
-                 [this, self](const ERROR_CODE& err, size_t) -> void {
-                     if (err) {
-                         p_er("session %" PRIu64
-                              " failed to read rpc header from socket %s:%u "
-                              "due to error %d, %s, ref count %ld",
-                              session_id_,
-                              cached_address_.c_str(),
-                              cached_port_,
-                              err.value(),
-                              err.message().c_str(),
-                              self.use_count());
-                         this->stop();
-                         return;
-                     }
-
-                     // NOTE:
-                     //  due to async_read() above, header_ size will be always
-                     //  equal to or greater than RPC_REQ_HEADER_SIZE.
-                     header_->pos(0);
-                     auto header_data = header_->data();
-                     uint32_t crc_local =
-                         crc32_8(header_data, RPC_REQ_HEADER_SIZE - CRC_FLAGS_LEN, 0);
-
-                     header_->pos(RPC_REQ_HEADER_SIZE - CRC_FLAGS_LEN);
-                     uint64_t flags_and_crc = header_->get_uint64();
-                     uint32_t crc_hdr = flags_and_crc & (uint32_t)0xffffffff;
-                     flags_ = (flags_and_crc >> 32);
-
-                     // Verify CRC.
-                     if (crc_local != crc_hdr) {
-                         p_er("CRC mismatch: local calculation %x, from header %x",
-                              crc_local,
-                              crc_hdr);
-                         this->stop();
-                         return;
-                     }
-
-                     header_->pos(0);
-                     if (header_->get_byte() == std::byte{0x1}) {
-                         // Means that this is RPC_RESP, shouldn't happen.
-                         p_er("Wrong packet: expected REQ, got RESP");
-                         this->stop();
-                         return;
-                     }
-
-                     header_->pos(RPC_REQ_HEADER_SIZE - CRC_FLAGS_LEN - DATA_SIZE_LEN);
-                     int32_t data_size = header_->get_int();
-                     // Up to 1GB.
-                     if (data_size < 0 || data_size > 0x40000000) {
-                         p_er("bad log data size in the header %d, stop "
-                              "this session to protect further corruption",
-                              data_size);
-                         this->stop();
-                         return;
-                     }
-
-                     if (data_size == 0) {
-                         // Don't carry data, immediately process request.
-                         this->read_complete(header_, nullptr);
-
-                     } else {
-                         // Carry some data, need to read further.
-                         std::shared_ptr<buffer> log_ctx =
-                             buffer::alloc((size_t)data_size);
-                         aa::read(ssl_enabled_,
-                                  ssl_socket_,
-                                  socket_,
-                                  asio::buffer(log_ctx->data(), (size_t)data_size),
-                                  std::bind(&rpc_session::read_log_data,
-                                            self,
-                                            log_ctx,
-                                            std::placeholders::_1,
-                                            std::placeholders::_2));
-                     }
-                 });
+        if (rbuf_.size() >= RPC_REQ_HEADER_SIZE) {
+            // The next request has been read ahead already. Process it
+            // by a separate handler, to avoid deep recursion when many
+            // requests are buffered.
+            asio::post(strand_, [this, self]() { header_read(self, ERROR_CODE()); });
+            return;
+        }
+        rbuf_.fill(ssl_enabled_,
+                   ssl_socket_,
+                   socket_,
+                   strand_,
+                   RPC_REQ_HEADER_SIZE,
+                   [this, self](const ERROR_CODE& err) { header_read(self, err); });
     }
 
     void stop() {
@@ -429,7 +817,77 @@ private:
 #endif
     }
 
-    void read_log_data(std::shared_ptr<buffer> log_ctx, const ERROR_CODE& err, size_t) {
+    void header_read(std::shared_ptr<rpc_session> self, const ERROR_CODE& err) {
+        if (err) {
+            p_er("session %" PRIu64 " failed to read rpc header from socket %s:%u "
+                 "due to error %d, %s, ref count %ld",
+                 session_id_,
+                 cached_address_.c_str(),
+                 cached_port_,
+                 err.value(),
+                 err.message().c_str(),
+                 self.use_count());
+            this->stop();
+            return;
+        }
+
+        header_->pos(0);
+        rbuf_.take(header_->data_begin(), RPC_REQ_HEADER_SIZE);
+        auto header_data = header_->data_begin();
+        uint32_t crc_local = crc32_8(header_data, RPC_REQ_HEADER_SIZE - CRC_FLAGS_LEN, 0);
+
+        header_->pos(RPC_REQ_HEADER_SIZE - CRC_FLAGS_LEN);
+        uint64_t flags_and_crc = header_->get_uint64();
+        uint32_t crc_hdr = flags_and_crc & (uint32_t)0xffffffff;
+        flags_ = (flags_and_crc >> 32);
+
+        // Verify CRC.
+        if (crc_local != crc_hdr) {
+            p_er("CRC mismatch: local calculation %x, from header %x", crc_local, crc_hdr);
+            this->stop();
+            return;
+        }
+
+        header_->pos(0);
+        if (header_->get_byte() == std::byte{0x1}) {
+            // Means that this is RPC_RESP, shouldn't happen.
+            p_er("Wrong packet: expected REQ, got RESP");
+            this->stop();
+            return;
+        }
+
+        header_->pos(RPC_REQ_HEADER_SIZE - CRC_FLAGS_LEN - DATA_SIZE_LEN);
+        int32_t data_size = header_->get_int();
+        // Up to 1GB.
+        if (data_size < 0 || data_size > 0x40000000) {
+            p_er("bad log data size in the header %d, stop "
+                 "this session to protect further corruption",
+                 data_size);
+            this->stop();
+            return;
+        }
+
+        if (data_size == 0) {
+            // Don't carry data, immediately process request.
+            this->read_complete(header_, nullptr);
+
+        } else {
+            // Carry some data, need to read further
+            // (part of it may have been read ahead already).
+            std::shared_ptr<buffer> log_ctx = buffer::alloc((size_t)data_size);
+            rbuf_.read(ssl_enabled_,
+                       ssl_socket_,
+                       socket_,
+                       strand_,
+                       log_ctx->data_begin(),
+                       (size_t)data_size,
+                       [this, self, log_ctx](const ERROR_CODE& err) {
+                           read_log_data(log_ctx, err);
+                       });
+        }
+    }
+
+    void read_log_data(std::shared_ptr<buffer> log_ctx, const ERROR_CODE& err) {
         if (!err) {
             this->read_complete(header_, log_ctx);
         } else {
@@ -489,11 +947,24 @@ private:
             std::string meta_str;
             std::shared_ptr<req_msg> req = std::make_shared<req_msg>(
                 term, t, src, dst, last_term, last_idx, commit_idx);
-            if (hdr->get_int() > 0 && log_ctx) {
+            int32_t data_size = hdr->get_int();
+            uint64_t req_id = 0;
+            bool has_req_id = (flags_ & INCLUDE_REQ_ID);
+            if (has_req_id && (data_size < (int32_t)sizeof(uint64_t) || !log_ctx)) {
+                p_wn("request ID flag is set without ID, stop this session");
+                this->stop();
+                return;
+            }
+            if (data_size > 0 && log_ctx) {
                 buffer_serializer ss(log_ctx);
                 size_t log_ctx_size = log_ctx->size();
 
-                // If flag is set, read meta first.
+                // If flag is set, read request ID first.
+                if (has_req_id) {
+                    req_id = ss.get_u64();
+                }
+
+                // If flag is set, read meta.
                 if (flags_ & INCLUDE_META) {
                     size_t meta_len = 0;
                     auto meta_raw =
@@ -534,8 +1005,12 @@ private:
                         return;
                     }
 
-                    std::shared_ptr<buffer> buf(buffer::alloc(val_size));
-                    ss.get_buffer(buf);
+                    // Refer to the payload in `log_ctx` without copying it.
+                    // Entry header right before the payload has been read
+                    // already, so that it can be used as the meta section
+                    // of the slice.
+                    std::shared_ptr<buffer> buf = buffer::slice(log_ctx, ss.pos(), val_size);
+                    ss.pos(ss.pos() + val_size);
                     std::shared_ptr<log_entry> entry(
                         std::make_shared<log_entry>(term, buf, val_type, timestamp));
                     req->log_entries().push_back(entry);
@@ -562,21 +1037,38 @@ private:
                 return;
             }
 
+            // If request ID is given, the response can be returned out of
+            // order, so read the next request without waiting for it.
+            // However, append_entries responses should still be returned
+            // in the order of requests, as the leader pipelines them.
+            bool read_ahead = has_req_id;
+            bool ordered = !has_req_id || (t == msg_type::append_entries_request);
+
             if (resp->has_async_cb()) {
                 // Response will be ready later, setup a callback function
-                // (only for auto-forwarding with `client_request` type
-                //  in async handling mode).
+                // (auto-forwarding with `client_request` type in async
+                //  handling mode, or append_entries deferred until the logs
+                //  become durable).
+                //
+                // For deferred append_entries, read the next request without
+                // waiting for the response, so that the follower can receive
+                // the next logs while the previous ones are being flushed.
+                read_ahead = read_ahead || (t == msg_type::append_entries_request);
+                std::shared_ptr<resp_slot> slot =
+                    std::make_shared<resp_slot>(!read_ahead, ordered, has_req_id, req_id);
+                resp_queue_.push_back(slot);
+
                 std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> ret =
                     resp->call_async_cb();
 
                 // WARNING: `self` should be captured to avoid releasing this
                 // `rpc_session`.
-                ret->when_ready([this, self, req, resp](
+                ret->when_ready([this, self, req, resp, slot](
                                     cmd_result<std::shared_ptr<buffer>,
                                                std::shared_ptr<std::exception>>& res,
                                     std::shared_ptr<std::exception>&) {
                     resp->set_ctx(res.get());
-                    on_resp_ready(req, resp);
+                    on_resp_ready(req, resp, slot);
                     // This is needed to avoid circular reference.
                     res.reset();
                 });
@@ -587,7 +1079,14 @@ private:
                     // If callback function exists, get new response message.
                     resp = resp->call_cb(resp);
                 }
-                on_resp_ready(req, resp);
+                std::shared_ptr<resp_slot> slot =
+                    std::make_shared<resp_slot>(!read_ahead, ordered, has_req_id, req_id);
+                resp_queue_.push_back(slot);
+                on_resp_ready(req, resp, slot);
+            }
+
+            if (read_ahead) {
+                this->start(self);
             }
 
         } catch (std::exception& ex) {
@@ -599,7 +1098,9 @@ private:
         }
     }
 
-    void on_resp_ready(std::shared_ptr<req_msg> req, std::shared_ptr<resp_msg> resp) {
+    void on_resp_ready(std::shared_ptr<req_msg> req,
+                       std::shared_ptr<resp_msg> resp,
+                       std::shared_ptr<resp_slot> slot) {
         std::shared_ptr<rpc_session> self = this->shared_from_this();
 
         try {
@@ -607,6 +1108,13 @@ private:
             int32_t resp_ctx_size = (resp_ctx) ? resp_ctx->size() : 0;
 
             uint32_t flags = 0x0;
+            size_t req_id_size = 0;
+            if (slot->has_req_id_) {
+                // Return the request ID so that the client can match them.
+                flags |= INCLUDE_REQ_ID;
+                req_id_size = sizeof(uint64_t);
+            }
+
             size_t resp_meta_size = 0;
             std::string resp_meta_str;
             if (impl_->get_options().write_resp_meta_) {
@@ -626,7 +1134,8 @@ private:
                 resp_hint_size += sizeof(uint16_t) * 2 + sizeof(int64_t);
             }
 
-            size_t carried_data_size = resp_meta_size + resp_hint_size + resp_ctx_size;
+            size_t carried_data_size =
+                req_id_size + resp_meta_size + resp_hint_size + resp_ctx_size;
 
             int buf_size = RPC_RESP_HEADER_SIZE + carried_data_size;
             std::shared_ptr<buffer> resp_buf = buffer::alloc(buf_size);
@@ -649,6 +1158,10 @@ private:
             uint64_t flags_crc = ((uint64_t)flags << 32) | crc_val;
             bs.put_u64(flags_crc);
 
+            // Put request ID first if the flag is set.
+            if (flags & INCLUDE_REQ_ID) {
+                bs.put_u64(slot->req_id_);
+            }
             // Handling meta if the flag is set.
             if (flags & INCLUDE_META) {
                 bs.put_str(resp_meta_str);
@@ -666,15 +1179,78 @@ private:
                 bs.put_buffer(*resp_ctx);
             }
 
-            aa::write(ssl_enabled_,
-                      ssl_socket_,
-                      socket_,
-                      asio::buffer(resp_buf->data_begin(), resp_buf->size()),
-                      [this, self, resp_buf](ERROR_CODE err_code, size_t) -> void {
-                          // To avoid releasing `resp_buf` before the write is done.
-                          (void)resp_buf;
+            // Response can be ready in any thread,
+            // the write should be done by `strand_`.
+            asio::post(strand_, [this, self, slot, resp_buf]() {
+                slot->buf_ = resp_buf;
+                write_next(self);
+            });
+
+        } catch (std::exception& ex) {
+            p_er("session %" PRIu64 " failed to process request message "
+                 "due to error: %s",
+                 this->session_id_,
+                 ex.what());
+            this->stop();
+        }
+    }
+
+    // Should be called by `strand_`.
+    void write_next(std::shared_ptr<rpc_session> self) {
+        if (writing_) {
+            // Previous responses are being written.
+            return;
+        }
+
+        // Collect the responses ready to be written, up to the limit, so
+        // that they are written by a single gather write. An ordered
+        // response cannot pass another ordered response not ready yet.
+        size_t max_msgs = std::max(impl_->get_options().max_coalesced_msgs_, (size_t)1);
+        std::shared_ptr<std::vector<std::shared_ptr<resp_slot>>> slots =
+            std::make_shared<std::vector<std::shared_ptr<resp_slot>>>();
+        std::vector<asio::const_buffer> bufs;
+        bool restart_read = false;
+        auto entry = resp_queue_.begin();
+        bool ordered_pending = false;
+        while (entry != resp_queue_.end() && slots->size() < max_msgs) {
+            resp_slot& cur = **entry;
+            if (cur.buf_ && !(cur.ordered_ && ordered_pending)) {
+                bufs.push_back(asio::buffer(cur.buf_->data_begin(), cur.buf_->size()));
+                restart_read = restart_read || cur.restart_read_;
+                slots->push_back(*entry);
+                entry = resp_queue_.erase(entry);
+                continue;
+            }
+            ordered_pending = ordered_pending || cur.ordered_;
+            ++entry;
+        }
+        if (slots->empty()) {
+            // Nothing is ready yet.
+            return;
+        }
+        writing_ = true;
+
+        std::shared_ptr<buffer> merged;
+        if (ssl_enabled_) {
+            merge_for_ssl(bufs, merged);
+        }
+        aa::write(ssl_enabled_,
+                  ssl_socket_,
+                  socket_,
+                  bufs,
+                  asio::bind_executor(
+                      strand_,
+                      [this, self, slots, merged, restart_read](ERROR_CODE err_code,
+                                                                size_t) -> void {
+                          // To avoid releasing buffers before the write is done.
+                          (void)slots;
+                          (void)merged;
+                          writing_ = false;
                           if (!err_code) {
-                              this->start(self);
+                              if (restart_read) {
+                                  this->start(self);
+                              }
+                              write_next(self);
                           } else {
                               p_er("session %" PRIu64
                                    " failed to send response to peer due "
@@ -683,22 +1259,15 @@ private:
                                    err_code.value());
                               this->stop();
                           }
-                      });
-
-        } catch (std::exception& ex) {
-            p_er("session %" PRIu64 " failed to process request message "
-                 "due to error: %s",
-                 this->session_id_,
-                 ex.what());
-            this->stop();
-        }
+                      }));
     }
 
 private:
     uint64_t session_id_;
     asio_service_impl* impl_;
+    asio::io_service& io_svc_;
     std::shared_ptr<raft_server> handler_;
-    asio::ip::tcp::socket socket_;
+    stream_socket socket_;
     ssl_socket ssl_socket_;
     bool ssl_enabled_;
     uint32_t flags_;
@@ -723,6 +1292,34 @@ private:
 
     std::string cached_address_;
     uint32_t cached_port_;
+
+    // Response to be written.
+    struct resp_slot {
+        resp_slot(bool restart_read, bool ordered, bool has_req_id, uint64_t req_id)
+            : restart_read_(restart_read)
+            , ordered_(ordered)
+            , has_req_id_(has_req_id)
+            , req_id_(req_id) {}
+        // Serialized response, `nullptr` if not ready yet.
+        std::shared_ptr<buffer> buf_;
+        // If `true`, read the next request after writing this response.
+        bool restart_read_;
+        // If `true`, should be written in the order of requests,
+        // with respect to the other ordered responses.
+        bool ordered_;
+        // If `true`, the request came with `INCLUDE_REQ_ID` flag.
+        bool has_req_id_;
+        // ID of the request, to be returned with the response.
+        uint64_t req_id_;
+    };
+    // Serializes all operations on the socket below.
+    asio::io_service::strand strand_;
+    // Responses to be written, in the order of requests.
+    std::list<std::shared_ptr<resp_slot>> resp_queue_;
+    // `true` if a write is in progress.
+    bool writing_;
+    // Requests read from the socket but not processed yet.
+    read_buffer rbuf_;
 };
 
 // rpc listener implementation
@@ -732,19 +1329,23 @@ public:
     asio_rpc_listener(asio_service_impl* _impl,
                       asio::io_service& io,
                       ssl_context& ssl_ctx,
-                      uint16_t port,
+                      const stream_endpoint& ep,
                       bool _enable_ssl,
-                      std::shared_ptr<logger>& l)
+                      std::shared_ptr<logger>& l,
+                      const std::string& unix_path = std::string())
         : impl_(_impl)
         , io_svc_(io)
         , ssl_ctx_(ssl_ctx)
         , handler_()
         , stopped_(false)
-        , acceptor_(io, asio::ip::tcp::endpoint(asio::ip::tcp::v4(), port))
+        , acceptor_(io, ep)
         , session_id_cnt_(1)
         , ssl_enabled_(_enable_ssl)
+        , unix_path_(unix_path)
         , l_(l) {
-        p_in("Raft ASIO listener initiated, %s",
+        p_in("Raft ASIO listener initiated%s%s, %s",
+             unix_path_.empty() ? "" : " on ",
+             unix_path_.c_str(),
              ssl_enabled_ ? "SSL ENABLED" : "UNSECURED");
     }
 
@@ -755,6 +1356,11 @@ public:
         auto guard = auto_lock(listener_lock_);
         stopped_ = true;
         acceptor_.close();
+#ifdef LOCAL_SOCKET_SUPPORTED
+        if (!unix_path_.empty() && unix_path_[0] != '@') {
+            ::unlink(unix_path_.c_str());
+        }
+#endif
     }
 
     void listen(std::shared_ptr<raft_server>& handler) override {
@@ -789,10 +1395,13 @@ private:
         session_closed_callback cb =
             std::bind(&asio_rpc_listener::remove_session, self, std::placeholders::_1);
 
+        // Peer of the session is not known until the first message,
+        // sessions are spread over shards by session ID.
+        uint64_t session_id = session_id_cnt_.fetch_add(1);
         std::shared_ptr<rpc_session> session =
-            std::make_shared<rpc_session>(session_id_cnt_.fetch_add(1),
+            std::make_shared<rpc_session>(session_id,
                                           impl_,
-                                          io_svc_,
+                                          impl_->get_shard_io_svc(session_id),
                                           ssl_ctx_,
                                           ssl_enabled_,
                                           handler_,
@@ -848,17 +1457,21 @@ private:
     std::mutex listener_lock_;
     std::shared_ptr<raft_server> handler_;
     bool stopped_;
-    asio::ip::tcp::acceptor acceptor_;
+    asio::basic_socket_acceptor<asio::generic::stream_protocol> acceptor_;
 
     std::vector<std::shared_ptr<rpc_session>> active_sessions_;
     std::atomic<uint64_t> session_id_cnt_;
     std::mutex session_lock_;
     bool ssl_enabled_;
+    // Path of Unix domain socket, empty if TCP.
+    std::string unix_path_;
     std::shared_ptr<logger> l_;
 };
 
 class asio_rpc_client : public rpc_client,
                         public std::enable_shared_from_this<asio_rpc_client> {
+    struct pending_req;
+
 public:
     asio_rpc_client(asio_service_impl* _impl,
                     asio::io_service& io_svc,
@@ -868,7 +1481,7 @@ public:
                     bool ssl_enabled,
                     std::shared_ptr<logger> l)
         : impl_(_impl)
-        , resolver_(io_svc)
+        , io_svc_(io_svc)
         , socket_(io_svc)
         , ssl_socket_(socket_, ssl_ctx)
         , attempting_conn_(false)
@@ -878,8 +1491,12 @@ public:
         , ssl_ready_(false)
         , num_send_fails_(0)
         , abandoned_(false)
-        , socket_busy_(false)
+        , strand_(io_svc)
+        , writing_(false)
+        , reading_(false)
+        , next_req_id_(1)
         , operation_timer_(io_svc)
+        , rbuf_(_impl->get_options().read_buffer_size_)
         , l_(l) {
         client_id_ = impl_->assign_client_id();
         if (ssl_enabled_) {
@@ -993,7 +1610,7 @@ public:
                 num_send_fails_.fetch_add(1);
 
                 std::shared_ptr<asio::steady_timer> timer =
-                    std::make_shared<asio::steady_timer>(impl_->get_io_svc());
+                    std::make_shared<asio::steady_timer>(io_svc_);
                 timer->expires_after(std::chrono::duration_cast<std::chrono::nanoseconds>(
                     std::chrono::milliseconds(SEND_RETRY_MS)));
                 timer->async_wait(std::bind(&asio_rpc_client::send_retry,
@@ -1015,32 +1632,34 @@ public:
                 break;
             }
 
-            if (impl_->get_options().custom_resolver_) {
-                impl_->get_options().custom_resolver_(
+            if (port_.empty()) {
+                // Unix domain socket, no need to resolve.
+                connect_unix(self, req, when_done, send_timeout_ms);
+
+            } else {
+                // Resolve the address (or use the cached one),
+                // custom resolver is applied if given.
+                impl_->get_resolver_cache().resolve(
                     host_,
                     port_,
                     [this, self, req, when_done, send_timeout_ms](
-                        const std::string& resolved_host,
-                        const std::string& resolved_port,
+                        const std::vector<stream_endpoint>& endpoints,
                         std::error_code err) {
                         if (!err) {
-                            p_in("custom resolver: %s:%s to %s:%s",
-                                 host_.c_str(),
-                                 port_.c_str(),
-                                 resolved_host.c_str(),
-                                 resolved_port.c_str());
-                            execute_resolver(self,
-                                             req,
-                                             resolved_host,
-                                             resolved_port,
-                                             when_done,
-                                             send_timeout_ms);
+                            asio::async_connect(socket(),
+                                                endpoints,
+                                                std::bind(&asio_rpc_client::connected,
+                                                          self,
+                                                          req,
+                                                          when_done,
+                                                          send_timeout_ms,
+                                                          std::placeholders::_1,
+                                                          std::placeholders::_2));
                         } else {
                             std::shared_ptr<resp_msg> rsp;
                             std::shared_ptr<rpc_exception> except(
                                 std::make_shared<rpc_exception>(
-                                    lstrfmt("failed to resolve host %s by given "
-                                            "custom resolver "
+                                    lstrfmt("failed to resolve host %s "
                                             "due to error %d, %s")
                                         .fmt(host_.c_str(),
                                              err.value(),
@@ -1049,8 +1668,6 @@ public:
                             when_done(rsp, except);
                         }
                     });
-            } else {
-                execute_resolver(self, req, host_, port_, when_done, send_timeout_ms);
             }
             return;
         }
@@ -1065,7 +1682,7 @@ public:
             num_send_fails_.fetch_add(1);
 
             std::shared_ptr<asio::steady_timer> timer =
-                std::make_shared<asio::steady_timer>(impl_->get_io_svc());
+                std::make_shared<asio::steady_timer>(io_svc_);
             timer->expires_after(std::chrono::duration_cast<std::chrono::nanoseconds>(
                 std::chrono::milliseconds(SEND_RETRY_MS)));
             timer->async_wait(std::bind(&asio_rpc_client::send_retry,
@@ -1079,15 +1696,16 @@ public:
             return;
         }
 
-        // Socket should be idle now. If not, it should be a bug.
-        set_busy_flag(true);
-
         // If we reach here, that means connection is valid.
         // Reset the counter.
         num_send_fails_ = 0;
 
         // serialize req, send and read response
-        std::vector<std::shared_ptr<buffer>> log_entry_bufs;
+        //
+        // Only headers are serialized into `req_buf`. Log payloads are
+        // not copied, but written directly from each `log_entry`'s buffer
+        // as a part of the gathered write. Log entries are kept alive by
+        // `req` until the write is done.
         int32_t log_data_size(0);
 
         uint32_t flags = 0x0;
@@ -1097,29 +1715,18 @@ public:
             flags |= INCLUDE_LOG_TIMESTAMP;
         }
 
-        for (auto& entry: req->log_entries()) {
-            std::shared_ptr<log_entry>& le = entry;
-            std::shared_ptr<buffer> entry_buf =
-                buffer::alloc(LOG_ENTRY_SIZE + le->get_buf().size());
-#if 0
-            entry_buf->put( le->get_term() );
-            entry_buf->put( (byte)le->get_val_type() );
-            entry_buf->put( (int32_t)le->get_buf().size() );
-            le->get_buf().pos(0);
-            entry_buf->put( le->get_buf() );
-            entry_buf->pos( 0 );
-#else
-            buffer_serializer ss(entry_buf);
-            ss.put_u64(le->get_term());
-            ss.put_u8(static_cast<uint8_t>(le->get_val_type()));
-            if (impl_->get_options().replicate_log_timestamp_) {
-                ss.put_u64(le->get_timestamp());
-            }
-            ss.put_i32(le->get_buf().size());
-            ss.put_raw(le->get_buf().data_begin(), le->get_buf().size());
-#endif
-            log_entry_bufs.push_back(entry_buf);
-            log_data_size += (int32_t)entry_buf->size();
+        std::vector<std::shared_ptr<log_entry>>& entries = req->log_entries();
+        for (auto& entry: entries) {
+            log_data_size += (int32_t)(LOG_ENTRY_SIZE + entry->get_buf().size());
+        }
+
+        uint64_t req_id = 0;
+        size_t req_id_size = 0;
+        if (impl_->get_options().multiplexed_rpc_) {
+            // Responses will be matched by this ID.
+            flags |= INCLUDE_REQ_ID;
+            req_id = next_req_id_.fetch_add(1);
+            req_id_size = sizeof(uint64_t);
         }
 
         size_t meta_size = 0;
@@ -1133,8 +1740,8 @@ public:
             }
         }
 
-        std::shared_ptr<buffer> req_buf =
-            buffer::alloc(RPC_REQ_HEADER_SIZE + meta_size + log_data_size);
+        std::shared_ptr<buffer> req_buf = buffer::alloc(
+            RPC_REQ_HEADER_SIZE + req_id_size + meta_size + LOG_ENTRY_SIZE * entries.size());
 
         req_buf->pos(0);
         auto req_buf_data = req_buf->data();
@@ -1148,7 +1755,7 @@ public:
         req_buf->put(req->get_last_log_term());
         req_buf->put(req->get_last_log_idx());
         req_buf->put(req->get_commit_idx());
-        req_buf->put((int32_t)meta_size + log_data_size);
+        req_buf->put((int32_t)(req_id_size + meta_size) + log_data_size);
 
         // Calculate CRC32 on header-only.
         uint32_t crc_val = crc32_8(req_buf_data, RPC_REQ_HEADER_SIZE - CRC_FLAGS_LEN, 0);
@@ -1156,95 +1763,216 @@ public:
         uint64_t flags_and_crc = ((uint64_t)flags << 32) | crc_val;
         req_buf->put((uint64_t)flags_and_crc);
 
+        // Put request ID first if the flag is set.
+        if (flags & INCLUDE_REQ_ID) {
+            req_buf->put(req_id);
+        }
         // Handling meta if the flag is set.
         if (flags & INCLUDE_META) {
             req_buf->put(reinterpret_cast<std::byte*>(meta_str.data()), meta_str.size());
         }
 
-        for (auto& it: log_entry_bufs) {
-            req_buf->put(*(it));
+        // Each log entry: header in `req_buf`, followed by its payload.
+        // Headers are contiguous in `req_buf`, so the first one is merged
+        // with the request header.
+        std::vector<asio::const_buffer> bufs;
+        bufs.reserve(1 + entries.size() * 2);
+        size_t hdr_begin = 0;
+        for (auto& entry: entries) {
+            std::shared_ptr<log_entry>& le = entry;
+            req_buf->put(le->get_term());
+            req_buf->put(static_cast<std::byte>(le->get_val_type()));
+            if (impl_->get_options().replicate_log_timestamp_) {
+                req_buf->put(le->get_timestamp());
+            }
+            req_buf->put((int32_t)le->get_buf().size());
+
+            bufs.push_back(
+                asio::buffer(req_buf->data_begin() + hdr_begin, req_buf->pos() - hdr_begin));
+            hdr_begin = req_buf->pos();
+            if (le->get_buf().size()) {
+                bufs.push_back(
+                    asio::buffer(le->get_buf().data_begin(), le->get_buf().size()));
+            }
+        }
+        if (hdr_begin < req_buf->pos()) {
+            // No log entry.
+            bufs.push_back(asio::buffer(req_buf->data_begin() + hdr_begin,
+                                        req_buf->pos() - hdr_begin));
         }
         req_buf->pos(0);
 
+        // Requests can be sent without waiting for the response of the
+        // previous one. All socket operations are serialized by `strand_`,
+        // and responses are returned in the same order as requests,
+        // or matched by request ID if `multiplexed_rpc_` is enabled.
+        pending_req pr{req, req_buf, std::move(bufs), when_done, send_timeout_ms, req_id};
+        asio::post(strand_, [this, self, pr]() {
+            write_queue_.push_back(pr);
+            if (!writing_) {
+                write_next(self);
+            }
+        });
+    }
+
+private:
+    void connect_unix(std::shared_ptr<asio_rpc_client> self,
+                      std::shared_ptr<req_msg> req,
+                      rpc_handler when_done,
+                      uint64_t send_timeout_ms) {
+#ifdef LOCAL_SOCKET_SUPPORTED
+        socket().async_connect(get_unix_endpoint(host_),
+                               std::bind(&asio_rpc_client::connected,
+                                         self,
+                                         req,
+                                         when_done,
+                                         send_timeout_ms,
+                                         std::placeholders::_1,
+                                         stream_endpoint()));
+#else
+        (void)self;
+        (void)send_timeout_ms;
+        std::shared_ptr<resp_msg> rsp;
+        std::shared_ptr<rpc_exception> except(std::make_shared<rpc_exception>(
+            lstrfmt("Unix domain socket is not supported: %s").fmt(host_.c_str()),
+            req));
+        when_done(rsp, except);
+#endif
+    }
+
+    // Should be called by `strand_`.
+    void write_next(std::shared_ptr<asio_rpc_client> self) {
+        if (write_queue_.empty()) {
+            writing_ = false;
+            return;
+        }
+        writing_ = true;
+
+        // Take the queued requests up to the limit,
+        // and write them by a single gather write.
+        size_t max_msgs = std::max(impl_->get_options().max_coalesced_msgs_, (size_t)1);
+        std::shared_ptr<std::list<pending_req>> batch =
+            std::make_shared<std::list<pending_req>>();
+        std::vector<asio::const_buffer> bufs;
+        uint64_t send_timeout_ms = 0;
+        while (!write_queue_.empty() && batch->size() < max_msgs) {
+            pending_req& pr = write_queue_.front();
+            bufs.insert(bufs.end(), pr.bufs_.begin(), pr.bufs_.end());
+            if (pr.send_timeout_ms_ != 0) {
+                send_timeout_ms = pr.send_timeout_ms_;
+            }
+
+            // Written request is waiting for the response from now on,
+            // as the response may arrive before the write completion handler.
+            read_queue_.push_back(pr);
+            batch->splice(batch->end(), write_queue_, write_queue_.begin());
+        }
+
         if (send_timeout_ms != 0) {
-            operation_timer_.expires_after(
-                std::chrono::duration_cast<std::chrono::nanoseconds>(
-                    std::chrono::milliseconds(send_timeout_ms)));
+            operation_timer_.expires_after(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::milliseconds(send_timeout_ms)));
             operation_timer_.async_wait(
                 std::bind(&asio_rpc_client::cancel_socket, this, std::placeholders::_1));
         }
 
-        // Note: without passing `req_buf` to callback function, it will be
-        //       unreachable before the write is done so that it is freed
-        //       and the memory corruption will occur.
+        std::shared_ptr<buffer> merged;
+        if (ssl_enabled_) {
+            merge_for_ssl(bufs, merged);
+        }
+
+        // Note: without passing `req_buf` and `req` (owning log payloads)
+        //       to callback function, they will be unreachable before the
+        //       write is done so that they are freed and the memory
+        //       corruption will occur.
         aa::write(ssl_enabled_,
                   ssl_socket_,
                   socket_,
-                  asio::buffer(req_buf->data(), req_buf->size()),
-                  std::bind(&asio_rpc_client::sent,
-                            self,
-                            req,
-                            req_buf,
-                            when_done,
-                            std::placeholders::_1,
-                            std::placeholders::_2));
+                  bufs,
+                  asio::bind_executor(strand_,
+                                      std::bind(&asio_rpc_client::sent,
+                                                self,
+                                                batch,
+                                                merged,
+                                                std::placeholders::_1,
+                                                std::placeholders::_2)));
     }
 
-private:
-    void execute_resolver(std::shared_ptr<asio_rpc_client> self,
-                          std::shared_ptr<req_msg> req,
-                          const std::string& host,
-                          const std::string& port,
-                          rpc_handler when_done,
-                          uint64_t send_timeout_ms) {
-        asio::ip::tcp::resolver::query q(
-            host, port, asio::ip::tcp::resolver::query::all_matching);
+    // Should be called by `strand_`.
+    void read_next(std::shared_ptr<asio_rpc_client> self) {
+        if (read_queue_.empty()) {
+            reading_ = false;
+            return;
+        }
+        reading_ = true;
+        std::shared_ptr<req_msg> req = read_queue_.front().req_;
+        if (rbuf_.size() >= RPC_RESP_HEADER_SIZE) {
+            // The next response has been read ahead already. Process it
+            // by a separate handler, to avoid deep recursion when many
+            // responses are buffered.
+            asio::post(strand_, [this, self, req]() { header_read(req, ERROR_CODE()); });
+            return;
+        }
+        rbuf_.fill(ssl_enabled_,
+                   ssl_socket_,
+                   socket_,
+                   strand_,
+                   RPC_RESP_HEADER_SIZE,
+                   [this, self, req](const ERROR_CODE& err) { header_read(req, err); });
+    }
 
-        resolver_.async_resolve(
-            q,
-            [self, this, req, when_done, host, port, send_timeout_ms](
-                std::error_code err, asio::ip::tcp::resolver::iterator itor) -> void {
-                if (!err) {
-                    asio::async_connect(socket(),
-                                        itor,
-                                        std::bind(&asio_rpc_client::connected,
-                                                  self,
-                                                  req,
-                                                  when_done,
-                                                  send_timeout_ms,
-                                                  std::placeholders::_1,
-                                                  std::placeholders::_2));
-                } else {
-                    std::shared_ptr<resp_msg> rsp;
-                    std::shared_ptr<rpc_exception> except(std::make_shared<rpc_exception>(
-                        lstrfmt("failed to resolve host %s "
-                                "due to error %d, %s")
-                            .fmt(host.c_str(), err.value(), err.message().c_str()),
-                        req));
-                    when_done(rsp, except);
-                }
-            });
+    // Should be called by `strand_`.
+    void header_read(std::shared_ptr<req_msg> req, const ERROR_CODE& err) {
+        std::shared_ptr<buffer> resp_buf(buffer::alloc(RPC_RESP_HEADER_SIZE));
+        if (!err) {
+            rbuf_.take(resp_buf->data_begin(), RPC_RESP_HEADER_SIZE);
+        }
+        response_read(req, resp_buf, err);
     }
 
-    void set_busy_flag(bool to) {
-        if (to == true) {
-            bool exp = false;
-            if (!socket_busy_.compare_exchange_strong(exp, true)) {
-                p_ft("socket %p is already in use, race happened on connection to %s:%s",
-                     (void*)this,
-                     host_.c_str(),
-                     port_.c_str());
-                assert(0);
-            }
-        } else {
-            bool exp = true;
-            if (!socket_busy_.compare_exchange_strong(exp, false)) {
-                p_ft("socket %p is already idle, race happened on connection to %s:%s",
-                     (void*)this,
-                     host_.c_str(),
-                     port_.c_str());
-                assert(0);
-            }
+    // Should be called by `strand_`.
+    std::list<pending_req>::iterator find_pending(uint64_t req_id) {
+        auto entry = read_queue_.begin();
+        while (entry != read_queue_.end() && entry->req_id_ != req_id) {
+            ++entry;
+        }
+        return entry;
+    }
+
+    // Should be called by `strand_`.
+    // Completes the request with the given ID, or the oldest one if 0.
+    void complete(std::shared_ptr<resp_msg>& rsp, uint64_t req_id) {
+        auto entry = req_id ? find_pending(req_id) : read_queue_.begin();
+        if (entry == read_queue_.end()) return;
+        std::shared_ptr<asio_rpc_client> self = this->shared_from_this();
+        rpc_handler when_done = entry->when_done_;
+        read_queue_.erase(entry);
+        if (read_queue_.empty()) {
+            operation_timer_.cancel();
+        }
+        read_next(self);
+
+        std::shared_ptr<rpc_exception> except;
+        when_done(rsp, except);
+    }
+
+    // Should be called by `strand_`.
+    void fail_all(const std::string& err_msg) {
+        abandoned_ = true;
+        operation_timer_.cancel();
+
+        // Once an error happens, the stream is no longer usable.
+        // Cancel the remaining operations and return error to all requests.
+        ERROR_CODE ec;
+        socket_.cancel(ec);
+
+        std::list<pending_req> reqs;
+        reqs.swap(read_queue_);
+        reqs.splice(reqs.end(), write_queue_);
+        for (pending_req& pr: reqs) {
+            std::shared_ptr<resp_msg> rsp;
+            std::shared_ptr<rpc_exception> except(
+                std::make_shared<rpc_exception>(err_msg, pr.req_));
+            pr.when_done_(rsp, except);
         }
     }
 
@@ -1284,7 +2012,7 @@ private:
                    rpc_handler& when_done,
                    uint64_t send_timeout_ms,
                    std::error_code err,
-                   asio::ip::tcp::resolver::iterator) {
+                   const stream_endpoint&) {
         if (!err) {
             p_in("%p connected to %s:%s (as a client)",
                  (void*)this,
@@ -1308,6 +2036,11 @@ private:
 
         } else {
             abandoned_ = true;
+            if (!port_.empty()) {
+                // The address may have been changed, refresh it
+                // for the next connection.
+                impl_->get_resolver_cache().expire(host_, port_);
+            }
             std::shared_ptr<resp_msg> rsp;
             std::shared_ptr<rpc_exception> except(std::make_shared<rpc_exception>(
                 sstrfmt("failed to connect to peer %d, %s:%s, error %d, %s")
@@ -1358,67 +2091,47 @@ private:
         }
     }
 
-    void sent(std::shared_ptr<req_msg>& req,
-              std::shared_ptr<buffer>& buf,
-              rpc_handler& when_done,
+    void sent(std::shared_ptr<std::list<pending_req>>& batch,
+              std::shared_ptr<buffer>& merged,
               std::error_code err,
               size_t) {
-        // Now we can safely free the `req_buf`.
-        (void)buf;
+        // Now we can safely free the `req_buf` and log payloads.
+        (void)merged;
+        std::shared_ptr<req_msg> req = batch->front().req_;
         std::shared_ptr<asio_rpc_client> self(this->shared_from_this());
         if (!err) {
-            // read a response
-            std::shared_ptr<buffer> resp_buf(buffer::alloc(RPC_RESP_HEADER_SIZE));
-            aa::read(ssl_enabled_,
-                     ssl_socket_,
-                     socket_,
-                     asio::buffer(resp_buf->data(), resp_buf->size()),
-                     std::bind(&asio_rpc_client::response_read,
-                               self,
-                               req,
-                               when_done,
-                               resp_buf,
-                               std::placeholders::_1,
-                               std::placeholders::_2));
+            // Read a response if not reading yet,
+            // and then send the next request.
+            if (!reading_) {
+                read_next(self);
+            }
+            write_next(self);
 
         } else {
-            operation_timer_.cancel();
-            abandoned_ = true;
-            std::shared_ptr<resp_msg> rsp;
-            std::shared_ptr<rpc_exception> except(std::make_shared<rpc_exception>(
-                sstrfmt("failed to send request to peer %d, %s:%s, "
-                        "error %d, %s")
-                    .fmt(req->get_dst(),
-                         host_.c_str(),
-                         port_.c_str(),
-                         err.value(),
-                         err.message().c_str()),
-                req));
             close_socket();
-            when_done(rsp, except);
+            fail_all(sstrfmt("failed to send request to peer %d, %s:%s, "
+                             "error %d, %s")
+                         .fmt(req->get_dst(),
+                              host_.c_str(),
+                              port_.c_str(),
+                              err.value(),
+                              err.message().c_str()));
         }
     }
 
     void response_read(std::shared_ptr<req_msg>& req,
-                       rpc_handler& when_done,
                        std::shared_ptr<buffer>& resp_buf,
-                       std::error_code err,
-                       size_t) {
+                       std::error_code err) {
         std::shared_ptr<asio_rpc_client> self(this->shared_from_this());
         if (err) {
-            abandoned_ = true;
-            std::shared_ptr<resp_msg> rsp;
-            std::shared_ptr<rpc_exception> except(std::make_shared<rpc_exception>(
-                sstrfmt("failed to read response to peer %d, %s:%s, "
-                        "error %d, %s")
-                    .fmt(req->get_dst(),
-                         host_.c_str(),
-                         port_.c_str(),
-                         err.value(),
-                         err.message().c_str()),
-                req));
             close_socket();
-            when_done(rsp, except);
+            fail_all(sstrfmt("failed to read response to peer %d, %s:%s, "
+                             "error %d, %s")
+                         .fmt(req->get_dst(),
+                              host_.c_str(),
+                              port_.c_str(),
+                              err.value(),
+                              err.message().c_str()));
             return;
         }
 
@@ -1431,15 +2144,14 @@ private:
         uint32_t flags = (flags_and_crc >> 32);
 
         if (crc_local != crc_buf) {
-            std::shared_ptr<resp_msg> rsp;
-            std::shared_ptr<rpc_exception> except(std::make_shared<rpc_exception>(
-                sstrfmt("CRC mismatch in response from peer %d, %s:%s, "
-                        "local calculation %x, from buffer %x")
-                    .fmt(
-                        req->get_dst(), host_.c_str(), port_.c_str(), crc_local, crc_buf),
-                req));
             close_socket();
-            when_done(rsp, except);
+            fail_all(sstrfmt("CRC mismatch in response from peer %d, %s:%s, "
+                             "local calculation %x, from buffer %x")
+                         .fmt(req->get_dst(),
+                              host_.c_str(),
+                              port_.c_str(),
+                              crc_local,
+                              crc_buf));
             return;
         }
 
@@ -1459,54 +2171,64 @@ private:
                                        nxt_idx,
                                        accepted_val == std::byte{1}));
 
-        if (!(flags & INCLUDE_META) && impl_->get_options().read_resp_meta_
-            && impl_->get_options().invoke_resp_cb_on_empty_meta_) {
+        if (flags & INCLUDE_REQ_ID) {
+            // Response can be out of order, the request will be
+            // identified by the ID in carried data.
+            if (carried_data_size < (int32_t)sizeof(uint64_t)) {
+                close_socket();
+                fail_all(sstrfmt("response from peer %d, %s:%s has no request ID")
+                             .fmt(req->get_dst(), host_.c_str(), port_.c_str()));
+                return;
+            }
+
+        } else if (!(flags & INCLUDE_META) && impl_->get_options().read_resp_meta_
+                   && impl_->get_options().invoke_resp_cb_on_empty_meta_) {
             // If callback is given, but meta is empty, and
             // the "always invoke" flag is set, invoke it.
-            bool meta_ok = handle_custom_resp_meta(req, rsp, when_done, std::string());
+            bool meta_ok = handle_custom_resp_meta(req, rsp, std::string());
             if (!meta_ok) return;
         }
 
         if (carried_data_size) {
             std::shared_ptr<buffer> ctx_buf = buffer::alloc(carried_data_size);
-            aa::read(ssl_enabled_,
-                     ssl_socket_,
-                     socket_,
-                     asio::buffer(ctx_buf->data(), carried_data_size),
-                     std::bind(&asio_rpc_client::ctx_read,
-                               self,
-                               req,
-                               rsp,
-                               when_done,
-                               ctx_buf,
-                               flags,
-                               std::placeholders::_1,
-                               std::placeholders::_2));
+            rbuf_.read(ssl_enabled_,
+                       ssl_socket_,
+                       socket_,
+                       strand_,
+                       ctx_buf->data_begin(),
+                       carried_data_size,
+                       [this, self, req, rsp, ctx_buf, flags](const ERROR_CODE& err) mutable {
+                           ctx_read(req, rsp, ctx_buf, flags, err);
+                       });
         } else {
-            operation_timer_.cancel();
-            set_busy_flag(false);
-            std::shared_ptr<rpc_exception> except;
-            when_done(rsp, except);
+            complete(rsp, 0);
         }
     }
 
     void ctx_read(std::shared_ptr<req_msg>& req,
                   std::shared_ptr<resp_msg>& rsp,
-                  rpc_handler& when_done,
                   std::shared_ptr<buffer>& ctx_buf,
                   uint32_t flags,
-                  std::error_code,
-                  size_t) {
-        if (!(flags & INCLUDE_META) && !(flags & INCLUDE_HINT)) {
+                  std::error_code err) {
+        if (err) {
+            close_socket();
+            fail_all(sstrfmt("failed to read response context from peer %d, %s:%s, "
+                             "error %d, %s")
+                         .fmt(req->get_dst(),
+                              host_.c_str(),
+                              port_.c_str(),
+                              err.value(),
+                              err.message().c_str()));
+            return;
+        }
+
+        if (!(flags & (INCLUDE_META | INCLUDE_HINT | INCLUDE_REQ_ID))) {
             // Neither meta nor hint exists,
             // just use the buffer as it is for ctx.
             ctx_buf->pos(0);
             rsp->set_ctx(ctx_buf);
 
-            operation_timer_.cancel();
-            set_busy_flag(false);
-            std::shared_ptr<rpc_exception> except;
-            when_done(rsp, except);
+            complete(rsp, 0);
             return;
         }
 
@@ -1514,6 +2236,30 @@ private:
         buffer_serializer bs(ctx_buf);
         int remaining_len = ctx_buf->size();
 
+        // 0) Request ID.
+        uint64_t req_id = 0;
+        if (flags & INCLUDE_REQ_ID) {
+            req_id = bs.get_u64();
+            remaining_len -= sizeof(uint64_t);
+
+            auto entry = find_pending(req_id);
+            if (entry == read_queue_.end()) {
+                close_socket();
+                fail_all(sstrfmt("unknown request ID %" PRIu64 " in response "
+                                 "from peer %d, %s:%s")
+                             .fmt(req_id, req->get_dst(), host_.c_str(), port_.c_str()));
+                return;
+            }
+            // `req` was the oldest one, replace it with the actual request.
+            req = entry->req_;
+
+            if (!(flags & INCLUDE_META) && impl_->get_options().read_resp_meta_
+                && impl_->get_options().invoke_resp_cb_on_empty_meta_) {
+                bool meta_ok = handle_custom_resp_meta(req, rsp, std::string());
+                if (!meta_ok) return;
+            }
+        }
+
         // 1) Custom meta.
         if (flags & INCLUDE_META) {
             size_t resp_meta_len = 0;
@@ -1528,7 +2274,6 @@ private:
                 bool meta_ok = handle_custom_resp_meta(
                     req,
                     rsp,
-                    when_done,
                     std::string((const char*)resp_meta_raw, resp_meta_len));
                 if (!meta_ok) return;
             }
@@ -1554,28 +2299,20 @@ private:
             rsp->set_ctx(actual_ctx);
         }
 
-        operation_timer_.cancel();
-        set_busy_flag(false);
-        std::shared_ptr<rpc_exception> except;
-        when_done(rsp, except);
+        complete(rsp, req_id);
     }
 
     bool handle_custom_resp_meta(std::shared_ptr<req_msg>& req,
                                  std::shared_ptr<resp_msg>&,
-                                 rpc_handler& when_done,
                                  const std::string& meta_str) {
         bool meta_ok = impl_->get_options().read_resp_meta_(req_to_params(req), meta_str);
 
         if (!meta_ok) {
             // Callback function returns false, should return failure.
-            std::shared_ptr<resp_msg> rsp;
-            std::shared_ptr<rpc_exception> except(std::make_shared<rpc_exception>(
-                sstrfmt("response meta verification failed: "
-                        "from peer %d, %s:%s")
-                    .fmt(req->get_dst(), host_.c_str(), port_.c_str()),
-                req));
             close_socket();
-            when_done(rsp, except);
+            fail_all(sstrfmt("response meta verification failed: "
+                             "from peer %d, %s:%s")
+                         .fmt(req->get_dst(), host_.c_str(), port_.c_str()));
             return false;
         }
         return true;
@@ -1583,8 +2320,8 @@ private:
 
 private:
     asio_service_impl* impl_;
-    asio::ip::tcp::resolver resolver_;
-    asio::ip::tcp::socket socket_;
+    asio::io_service& io_svc_;
+    stream_socket socket_;
     ssl_socket ssl_socket_;
     // `true` if attempting connection is in progress.
     // Other threads should not do anything.
@@ -1595,9 +2332,34 @@ private:
     std::atomic<bool> ssl_ready_;
     std::atomic<size_t> num_send_fails_;
     std::atomic<bool> abandoned_;
-    std::atomic<bool> socket_busy_;
+    // Request to be sent, or waiting for the response.
+    struct pending_req {
+        std::shared_ptr<req_msg> req_;
+        // Serialized headers.
+        std::shared_ptr<buffer> buf_;
+        // Headers and log payloads to be written in order.
+        std::vector<asio::const_buffer> bufs_;
+        rpc_handler when_done_;
+        uint64_t send_timeout_ms_;
+        // Request ID, 0 if `multiplexed_rpc_` is disabled.
+        uint64_t req_id_;
+    };
+    // Serializes all operations on the socket below.
+    asio::io_service::strand strand_;
+    // Requests not written to the socket yet.
+    std::list<pending_req> write_queue_;
+    // Requests written to the socket, in the order of writes.
+    std::list<pending_req> read_queue_;
+    // `true` if a write is in progress.
+    bool writing_;
+    // `true` if a read is in progress.
+    bool reading_;
+    // ID of the next request, if `multiplexed_rpc_` is enabled.
+    std::atomic<uint64_t> next_req_id_;
     uint64_t client_id_;
     asio::steady_timer operation_timer_;
+    // Responses read from the socket but not processed yet.
+    read_buffer rbuf_;
     std::shared_ptr<logger> l_;
 };
 
@@ -1666,7 +2428,8 @@ asio_service_impl::asio_service_impl(const asio_service::options& _opt,
     , worker_id_(0)
     , my_opt_(_opt)
     , client_id_counter_(1)
-    , l_(l) {
+    , l_(l)
+    , resolver_cache_(io_svc_, my_opt_, l) {
     if (my_opt_.enable_ssl_) {
 #ifdef SSL_LIBRARY_NOT_FOUND
         assert(0); // Should not reach here.
@@ -1727,6 +2490,17 @@ asio_service_impl::asio_service_impl(const asio_service::options& _opt,
         cpu_cnt = 1;
     }
 
+    shards_.push_back(&io_svc_);
+    if (my_opt_.sharded_io_context_) {
+        for (unsigned int i = 1; i < cpu_cnt; ++i) {
+            extra_shards_.emplace_back(new asio::io_service(1));
+            extra_shard_works_.emplace_back(
+                new asio::io_service::work(*extra_shards_.back()));
+            shards_.push_back(extra_shards_.back().get());
+        }
+        p_in("asio service is running with %zu io_context shards", shards_.size());
+    }
+
     for (unsigned int i = 0; i < cpu_cnt; ++i) {
         std::shared_ptr<std::thread> t = std::make_shared<std::thread>(
             std::bind(&asio_service_impl::worker_entry, this));
@@ -1746,6 +2520,8 @@ std::string asio_service_impl::get_password(std::size_t,
 
 void asio_service_impl::worker_entry() {
     uint32_t worker_id = worker_id_.fetch_add(1);
+    // If sharded, each worker runs its own shard exclusively.
+    asio::io_service& my_svc = *shards_[worker_id % shards_.size()];
     std::string thread_name = "nuraft_w_" + std::to_string(worker_id);
 #ifdef __linux__
     pthread_setname_np(pthread_self(), thread_name.c_str());
@@ -1764,7 +2540,7 @@ void asio_service_impl::worker_entry() {
     do {
         try {
             num_active_workers_.fetch_add(1);
-            io_svc_.run();
+            my_svc.run();
             num_active_workers_.fetch_sub(1);
 
         } catch (std::exception& ee) {
@@ -1837,9 +2613,12 @@ void asio_service_impl::stop() {
     // Stop all workers.
     stopping_status_ = 1;
 
-    io_svc_.stop();
-    while (!io_svc_.stopped()) {
-        std::this_thread::yield();
+    extra_shard_works_.clear();
+    for (asio::io_service* svc: shards_) {
+        svc->stop();
+        while (!svc->stopped()) {
+            std::this_thread::yield();
+        }
     }
 
     for (std::shared_ptr<std::thread>& t: worker_handles_) {
@@ -1857,7 +2636,9 @@ asio_service::~asio_service() { delete impl_; }
 
 void asio_service::schedule(std::shared_ptr<delayed_task>& task, int32_t milliseconds) {
     if (task->get_impl_context() == nullptr) {
-        task->set_impl_context(new asio::steady_timer(impl_->io_svc_), &_free_timer_);
+        // Spread timers over shards.
+        asio::io_service& svc = impl_->get_shard_io_svc((uint64_t)task.get() / 64);
+        task->set_impl_context(new asio::steady_timer(svc), &_free_timer_);
     }
     // ensure it's not in cancelled state
     task->reset();
@@ -1896,6 +2677,24 @@ std::shared_ptr<rpc_client> asio_service::create_client(const std::string& endpo
     bool valid_address = false;
     std::string hostname;
     std::string port;
+    if (is_unix_endpoint(endpoint)) {
+        // Unix domain socket: `hostname` is the path, and `port` is empty.
+        // SSL is not used for local connections.
+        hostname = endpoint.substr(UNIX_SOCKET_PREFIX.size());
+        if (hostname.empty()) {
+            p_er("invalid endpoint: %s", endpoint.c_str());
+            return std::shared_ptr<rpc_client>();
+        }
+        return std::make_shared<asio_rpc_client>(impl_,
+                                                 impl_->get_shard_io_svc(
+                                                     std::hash<std::string>()(endpoint)),
+                                                 impl_->ssl_client_ctx_,
+                                                 hostname,
+                                                 port,
+                                                 false,
+                                                 l_);
+    }
+
     size_t pos = endpoint.rfind(":");
     do {
         if (pos == std::string::npos) break;
@@ -1918,8 +2717,10 @@ std::shared_ptr<rpc_client> asio_service::create_client(const std::string& endpo
         return std::shared_ptr<rpc_client>();
     }
 
+    // All clients to the same peer are assigned to the same shard.
+    uint64_t shard_key = std::hash<std::string>()(endpoint);
     return std::make_shared<asio_rpc_client>(impl_,
-                                             impl_->io_svc_,
+                                             impl_->get_shard_io_svc(shard_key),
                                              impl_->ssl_client_ctx_,
                                              hostname,
                                              port,
@@ -1930,17 +2731,46 @@ std::shared_ptr<rpc_client> asio_service::create_client(const std::string& endpo
 std::shared_ptr<rpc_listener>
 asio_service::create_rpc_listener(uint16_t listening_port, std::shared_ptr<logger>& l) {
     try {
+        return std::make_shared<asio_rpc_listener>(
+            impl_,
+            impl_->io_svc_,
+            impl_->ssl_server_ctx_,
+            asio::ip::tcp::endpoint(asio::ip::tcp::v4(), listening_port),
+            impl_->my_opt_.enable_ssl_,
+            l);
+    } catch (std::exception& ee) {
+        // Most likely exception happens due to wrong endpoint.
+        p_er("got exception: %s", ee.what());
+        return nullptr;
+    }
+}
+
+std::shared_ptr<rpc_listener>
+asio_service::create_unix_rpc_listener(const std::string& path,
+                                       std::shared_ptr<logger>& l) {
+#ifdef LOCAL_SOCKET_SUPPORTED
+    std::string unix_path =
+        is_unix_endpoint(path) ? path.substr(UNIX_SOCKET_PREFIX.size()) : path;
+    try {
+        if (!unix_path.empty() && unix_path[0] != '@') {
+            // Remove the stale socket file left by the previous process.
+            ::unlink(unix_path.c_str());
+        }
         return std::make_shared<asio_rpc_listener>(impl_,
                                                    impl_->io_svc_,
                                                    impl_->ssl_server_ctx_,
-                                                   listening_port,
-                                                   impl_->my_opt_.enable_ssl_,
-                                                   l);
+                                                   get_unix_endpoint(unix_path),
+                                                   false,
+                                                   l,
+                                                   unix_path);
     } catch (std::exception& ee) {
-        // Most likely exception happens due to wrong endpoint.
         p_er("got exception: %s", ee.what());
         return nullptr;
     }
+#else
+    p_er("Unix domain socket is not supported: %s", path.c_str());
+    return nullptr;
+#endif
 }
 
 // ==========================
@@ -21,9 +21,11 @@ limitations under the License.
 #include "buffer.hxx"
 #include "stat_mgr.hxx"
 
+#include <atomic>
 #include <cstddef>
 #include <cstring>
 #include <iostream>
+#include <vector>
 
 #define __is_big_block(p) (0x80000000 & *((uint32_t*)(p)))
 
@@ -72,56 +74,231 @@ namespace nuraft {
 
 using std::byte;
 
-static void free_buffer(buffer* buf) {
-    static stat_elem& num_active =
-        *stat_mgr::get_instance()->create_stat(stat_elem::COUNTER, "num_active_buffers");
-    static stat_elem& amount_active = *stat_mgr::get_instance()->create_stat(
-        stat_elem::COUNTER, "amount_active_buffers");
+namespace {
+
+// Size classes of the buffer pool: 32, 64, ..., 64 KB.
+const size_t POOL_MIN_CLASS_SHIFT = 5;
+const size_t POOL_NUM_CLASSES = 12;
+const uint8_t POOL_NO_CLASS = 0xff;
+
+std::atomic<bool> pool_enabled(true);
+std::atomic<size_t> pool_max_cached_bytes(4 * 1024 * 1024);
+std::atomic<bool> pool_stats_enabled(true);
+
+struct buffer_stats {
+    buffer_stats()
+        : num_allocs(*stat_mgr::get_instance()->create_stat(stat_elem::COUNTER,
+                                                            "num_buffer_allocs"))
+        , amount_allocs(*stat_mgr::get_instance()->create_stat(
+              stat_elem::COUNTER, "amount_buffer_allocs"))
+        , num_active(*stat_mgr::get_instance()->create_stat(stat_elem::COUNTER,
+                                                            "num_active_buffers"))
+        , amount_active(*stat_mgr::get_instance()->create_stat(
+              stat_elem::COUNTER, "amount_active_buffers"))
+        , num_pool_hits(*stat_mgr::get_instance()->create_stat(
+              stat_elem::COUNTER, "num_buffer_pool_hits")) {}
+
+    static buffer_stats& get() {
+        static buffer_stats instance;
+        return instance;
+    }
+
+    stat_elem& num_allocs;
+    stat_elem& amount_allocs;
+    stat_elem& num_active;
+    stat_elem& amount_active;
+    stat_elem& num_pool_hits;
+};
+
+// Set when the cache of the current thread is destroyed, so that
+// buffers released afterwards (e.g., by other thread-local objects)
+// go directly to the system. Trivially destructible on purpose.
+thread_local bool pool_cache_gone = false;
+
+struct pool_cache {
+    pool_cache() : cached_bytes(0) {}
+    ~pool_cache() {
+        purge();
+        pool_cache_gone = true;
+    }
+
+    void purge() {
+        for (std::vector<char*>& list: free_lists) {
+            for (char* block: list) {
+                delete[] block;
+            }
+            list.clear();
+        }
+        cached_bytes = 0;
+    }
+
+    std::vector<char*> free_lists[POOL_NUM_CLASSES];
+    size_t cached_bytes;
+};
+
+pool_cache& get_pool_cache() {
+    thread_local pool_cache cache;
+    return cache;
+}
 
-    num_active--;
-    amount_active -= buf->container_size();
+inline size_t class_size(uint8_t cls) { return (size_t)1 << (cls + POOL_MIN_CLASS_SHIFT); }
 
-    delete[] reinterpret_cast<char*>(buf);
+inline uint8_t size_to_class(size_t len) {
+    size_t cls = 0;
+    while (cls < POOL_NUM_CLASSES && class_size(cls) < len) {
+        ++cls;
+    }
+    return (cls < POOL_NUM_CLASSES) ? (uint8_t)cls : POOL_NO_CLASS;
 }
 
-std::shared_ptr<buffer> buffer::alloc(const size_t size) {
-    static stat_elem& num_allocs =
-        *stat_mgr::get_instance()->create_stat(stat_elem::COUNTER, "num_buffer_allocs");
-    static stat_elem& amount_allocs = *stat_mgr::get_instance()->create_stat(
-        stat_elem::COUNTER, "amount_buffer_allocs");
-    static stat_elem& num_active =
-        *stat_mgr::get_instance()->create_stat(stat_elem::COUNTER, "num_active_buffers");
-    static stat_elem& amount_active = *stat_mgr::get_instance()->create_stat(
-        stat_elem::COUNTER, "amount_active_buffers");
+char* pool_get(uint8_t cls, bool& hit) {
+    hit = false;
+    if (!pool_cache_gone) {
+        std::vector<char*>& list = get_pool_cache().free_lists[cls];
+        if (!list.empty()) {
+            char* block = list.back();
+            list.pop_back();
+            get_pool_cache().cached_bytes -= class_size(cls);
+            hit = true;
+            return block;
+        }
+    }
+    return new char[class_size(cls)];
+}
+
+void pool_put(uint8_t cls, char* block) {
+    if (!pool_cache_gone && pool_enabled.load(std::memory_order_relaxed)) {
+        pool_cache& cache = get_pool_cache();
+        if (cache.cached_bytes + class_size(cls)
+            <= pool_max_cached_bytes.load(std::memory_order_relaxed)) {
+            cache.free_lists[cls].push_back(block);
+            cache.cached_bytes += class_size(cls);
+            return;
+        }
+    }
+    delete[] block;
+}
+
+/**
+ * Allocator for the control block of `std::shared_ptr`,
+ * so that it is also recycled through the pool.
+ */
+template <typename T> struct pool_allocator {
+    using value_type = T;
+
+    pool_allocator() = default;
+    template <typename U> pool_allocator(const pool_allocator<U>&) {}
+
+    T* allocate(size_t n) {
+        size_t len = n * sizeof(T);
+        uint8_t cls = size_to_class(len);
+        if (cls == POOL_NO_CLASS) {
+            return reinterpret_cast<T*>(new char[len]);
+        }
+        bool hit = false;
+        return reinterpret_cast<T*>(pool_get(cls, hit));
+    }
+
+    void deallocate(T* p, size_t n) {
+        uint8_t cls = size_to_class(n * sizeof(T));
+        if (cls == POOL_NO_CLASS) {
+            delete[] reinterpret_cast<char*>(p);
+            return;
+        }
+        pool_put(cls, reinterpret_cast<char*>(p));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const pool_allocator<T>&, const pool_allocator<U>&) {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const pool_allocator<T>&, const pool_allocator<U>&) {
+    return false;
+}
+
+struct buffer_deleter {
+    void operator()(buffer* buf) const {
+        if (counted) {
+            buffer_stats& stats = buffer_stats::get();
+            stats.num_active--;
+            stats.amount_active -= buf->container_size();
+        }
+
+        if (cls == POOL_NO_CLASS) {
+            delete[] reinterpret_cast<char*>(buf);
+        } else {
+            pool_put(cls, reinterpret_cast<char*>(buf));
+        }
+    }
+
+    uint8_t cls;
+    bool counted;
+};
+
+} // namespace
+
+void buffer::set_pool_options(const buffer_pool_options& opt) {
+    pool_enabled = opt.enabled_;
+    pool_max_cached_bytes = opt.max_cached_bytes_per_thread_;
+    pool_stats_enabled = opt.stats_enabled_;
+}
 
+buffer_pool_options buffer::get_pool_options() {
+    buffer_pool_options opt;
+    opt.enabled_ = pool_enabled;
+    opt.max_cached_bytes_per_thread_ = pool_max_cached_bytes;
+    opt.stats_enabled_ = pool_stats_enabled;
+    return opt;
+}
+
+void buffer::purge_pool_cache() {
+    if (!pool_cache_gone) {
+        get_pool_cache().purge();
+    }
+}
+
+std::shared_ptr<buffer> buffer::alloc(const size_t size) {
     if (size >= 0x80000000) {
         throw std::out_of_range("size exceed the max size that "
                                 "nuraft::buffer could support");
     }
-    num_allocs++;
-    num_active++;
 
-    if (size >= 0x8000) {
-        size_t len = size + sizeof(uint32_t) * 2;
-        std::shared_ptr<buffer> buf(reinterpret_cast<buffer*>(new char[len]),
-                                    &free_buffer);
-        amount_allocs += len;
-        amount_active += len;
+    bool big_block = (size >= 0x8000);
+    size_t len = size + (big_block ? sizeof(uint32_t) * 2 : sizeof(uint16_t) * 2);
+
+    buffer_deleter deleter;
+    deleter.cls = pool_enabled.load(std::memory_order_relaxed) ? size_to_class(len)
+                                                               : POOL_NO_CLASS;
+    deleter.counted = pool_stats_enabled.load(std::memory_order_relaxed);
 
-        auto ptr = reinterpret_cast<uint32_t*>(buf.get());
+    bool hit = false;
+    char* block = (deleter.cls == POOL_NO_CLASS) ? new char[len]
+                                                 : pool_get(deleter.cls, hit);
+    if (big_block) {
+        auto ptr = reinterpret_cast<uint32_t*>(block);
         __init_b_block(ptr, size);
-        return buf;
+    } else {
+        auto ptr = reinterpret_cast<uint16_t*>(block);
+        __init_s_block(ptr, size);
     }
 
-    size_t len = size + sizeof(uint16_t) * 2;
-    std::shared_ptr<buffer> buf(reinterpret_cast<buffer*>(new char[len]), &free_buffer);
-    amount_allocs += len;
-    amount_active += len;
-
-    auto ptr = reinterpret_cast<uint16_t*>(buf.get());
-    __init_s_block(ptr, size);
+    if (deleter.counted) {
+        buffer_stats& stats = buffer_stats::get();
+        stats.num_allocs++;
+        stats.num_active++;
+        stats.amount_allocs += len;
+        stats.amount_active += len;
+        if (hit) stats.num_pool_hits++;
+    }
 
-    return buf;
+    if (deleter.cls == POOL_NO_CLASS) {
+        return std::shared_ptr<buffer>(reinterpret_cast<buffer*>(block), deleter);
+    }
+    return std::shared_ptr<buffer>(
+        reinterpret_cast<buffer*>(block), deleter, pool_allocator<buffer>());
 }
 
 std::shared_ptr<buffer> buffer::copy(const buffer& buf) {
@@ -160,6 +337,27 @@ std::shared_ptr<buffer> buffer::expand(const buffer& buf, uint32_t new_size) {
     return other;
 }
 
+size_t buffer::slice_meta_size(size_t len) {
+    return (len >= 0x8000) ? sizeof(uint32_t) * 2 : sizeof(uint16_t) * 2;
+}
+
+std::shared_ptr<buffer>
+buffer::slice(const std::shared_ptr<buffer>& src, size_t offset, size_t len) {
+    size_t meta_size = slice_meta_size(len);
+    if (offset < meta_size || offset + len > src->size()) {
+        throw std::out_of_range("invalid range to make a slice");
+    }
+
+    byte* ptr = src->data_begin() + offset - meta_size;
+    if (len >= 0x8000) {
+        __init_b_block(ptr, len);
+    } else {
+        __init_s_block(ptr, len);
+    }
+    // Aliasing constructor: share the reference counter with `src`.
+    return std::shared_ptr<buffer>(src, reinterpret_cast<buffer*>(ptr));
+}
+
 size_t buffer::container_size() const {
     return (size_t)(
         __size_of_block(this)
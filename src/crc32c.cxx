@@ -0,0 +1,256 @@
+/************************************************************************
+Copyright 2017-2019 eBay Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include "crc32c.hxx"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32C_X86 (1)
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+#if defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))                    \
+    && (defined(__linux__) || defined(__APPLE__))
+#define CRC32C_ARM (1)
+#include <arm_acle.h>
+#ifdef __linux__
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+#endif
+
+namespace {
+
+// Castagnoli polynomial, bit-reflected.
+constexpr uint32_t CRC32C_POLY = 0x82f63b78;
+
+struct crc32c_table {
+    uint32_t t_[8][256];
+};
+
+constexpr crc32c_table crc32c_make_table() {
+    crc32c_table table{};
+    for (uint32_t ii = 0; ii < 256; ++ii) {
+        uint32_t crc = ii;
+        for (size_t jj = 0; jj < 8; ++jj) {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : (crc >> 1);
+        }
+        table.t_[0][ii] = crc;
+    }
+    // For slicing-by-8.
+    for (uint32_t ii = 0; ii < 256; ++ii) {
+        for (size_t kk = 1; kk < 8; ++kk) {
+            uint32_t prev = table.t_[kk - 1][ii];
+            table.t_[kk][ii] = (prev >> 8) ^ table.t_[0][prev & 0xff];
+        }
+    }
+    return table;
+}
+
+constexpr crc32c_table crc32c_lookup = crc32c_make_table();
+
+// Returns `a(x) * b(x) mod P(x)`, where bit 31 represents x^0.
+constexpr uint32_t crc32c_multmodp(uint32_t a, uint32_t b) {
+    uint32_t m = (uint32_t)1 << 31;
+    uint32_t p = 0;
+    while (m) {
+        if (a & m) p ^= b;
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ CRC32C_POLY : (b >> 1);
+    }
+    return p;
+}
+
+// Returns `x^n mod P(x)`.
+constexpr uint32_t crc32c_xnmodp(uint64_t n) {
+    uint32_t ret = (uint32_t)1 << 31; // x^0
+    uint32_t base = (uint32_t)1 << 30; // x^1
+    while (n) {
+        if (n & 1) ret = crc32c_multmodp(base, ret);
+        base = crc32c_multmodp(base, base);
+        n >>= 1;
+    }
+    return ret;
+}
+
+inline uint32_t load_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16)
+           | ((uint32_t)p[3] << 24);
+}
+
+inline uint64_t load_u64(const uint8_t* p) {
+    return (uint64_t)load_u32(p) | ((uint64_t)load_u32(p + 4) << 32);
+}
+
+uint32_t crc32c_slicing8(const void* data, size_t len, uint32_t prev_value) {
+    const uint8_t* cur = (const uint8_t*)data;
+    const uint32_t(&t)[8][256] = crc32c_lookup.t_;
+    uint32_t crc = ~prev_value;
+
+    while (len >= 8) {
+        uint32_t one = load_u32(cur) ^ crc;
+        uint32_t two = load_u32(cur + 4);
+        crc = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^ t[5][(one >> 16) & 0xff]
+              ^ t[4][one >> 24] ^ t[3][two & 0xff] ^ t[2][(two >> 8) & 0xff]
+              ^ t[1][(two >> 16) & 0xff] ^ t[0][two >> 24];
+        cur += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *cur++) & 0xff];
+    }
+    return ~crc;
+}
+
+#ifdef CRC32C_X86
+
+// Size of each of three streams calculated in parallel.
+constexpr size_t X86_BLOCK = 256;
+
+// `x^(8n - 33)` for shifting a CRC by `n` bytes using PCLMUL,
+// see `crc32c_shift_pclmul`.
+constexpr uint64_t X86_SHIFT_1_BLOCK = crc32c_xnmodp(8 * X86_BLOCK - 33);
+constexpr uint64_t X86_SHIFT_2_BLOCKS = crc32c_xnmodp(8 * 2 * X86_BLOCK - 33);
+
+__attribute__((target("sse4.2"))) uint32_t crc32c_sse42(const void* data,
+                                                         size_t len,
+                                                         uint32_t prev_value) {
+    const uint8_t* cur = (const uint8_t*)data;
+    uint64_t crc = ~prev_value;
+
+    while (len >= 8) {
+        crc = _mm_crc32_u64(crc, load_u64(cur));
+        cur += 8;
+        len -= 8;
+    }
+    uint32_t crc_low = (uint32_t)crc;
+    while (len--) {
+        crc_low = _mm_crc32_u8(crc_low, *cur++);
+    }
+    return ~crc_low;
+}
+
+// Returns the CRC register after feeding zero bytes into `crc`,
+// where `k` is `x^(8n - 33) mod P(x)` for `n` zero bytes.
+//
+// The carry-less product of two bit-reflected values is `crc * k * x`,
+// and `crc32` instruction multiplies it by `x^32` again.
+__attribute__((target("sse4.2,pclmul"))) inline uint64_t
+crc32c_shift_pclmul(uint64_t crc, uint64_t k) {
+    __m128i prod = _mm_clmulepi64_si128(
+        _mm_cvtsi64_si128((long long)crc), _mm_cvtsi64_si128((long long)k), 0x00);
+    return _mm_crc32_u64(0, (uint64_t)_mm_cvtsi128_si64(prod));
+}
+
+__attribute__((target("sse4.2,pclmul"))) uint32_t
+crc32c_sse42_pclmul(const void* data, size_t len, uint32_t prev_value) {
+    const uint8_t* cur = (const uint8_t*)data;
+    uint64_t crc = ~prev_value;
+
+    // `crc32` instruction has 3-cycle latency and 1-cycle throughput,
+    // calculate three independent streams at once and fold them together.
+    while (len >= 3 * X86_BLOCK) {
+        uint64_t crc0 = crc, crc1 = 0, crc2 = 0;
+        for (size_t ii = 0; ii < X86_BLOCK; ii += 8) {
+            crc0 = _mm_crc32_u64(crc0, load_u64(cur + ii));
+            crc1 = _mm_crc32_u64(crc1, load_u64(cur + X86_BLOCK + ii));
+            crc2 = _mm_crc32_u64(crc2, load_u64(cur + 2 * X86_BLOCK + ii));
+        }
+        crc = crc32c_shift_pclmul(crc0, X86_SHIFT_2_BLOCKS)
+              ^ crc32c_shift_pclmul(crc1, X86_SHIFT_1_BLOCK) ^ crc2;
+        cur += 3 * X86_BLOCK;
+        len -= 3 * X86_BLOCK;
+    }
+    return crc32c_sse42(cur, len, ~(uint32_t)crc);
+}
+
+#endif // CRC32C_X86
+
+#ifdef CRC32C_ARM
+
+#ifdef __clang__
+#define CRC32C_ARM_TARGET __attribute__((target("crc")))
+#else
+#define CRC32C_ARM_TARGET __attribute__((target("+crc")))
+#endif
+
+CRC32C_ARM_TARGET uint32_t crc32c_armv8(const void* data,
+                                        size_t len,
+                                        uint32_t prev_value) {
+    const uint8_t* cur = (const uint8_t*)data;
+    uint32_t crc = ~prev_value;
+
+    while (len >= 8) {
+        crc = __crc32cd(crc, load_u64(cur));
+        cur += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = __crc32cb(crc, *cur++);
+    }
+    return ~crc;
+}
+
+#endif // CRC32C_ARM
+
+typedef uint32_t (*crc32c_func)(const void*, size_t, uint32_t);
+
+struct crc32c_impl {
+    crc32c_func func_;
+    const char* name_;
+};
+
+crc32c_impl crc32c_select() {
+#ifdef CRC32C_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        if (__builtin_cpu_supports("pclmul")) {
+            return {crc32c_sse42_pclmul, "sse4.2+pclmul"};
+        }
+        return {crc32c_sse42, "sse4.2"};
+    }
+#endif
+
+#ifdef CRC32C_ARM
+#ifdef __APPLE__
+    // All ARM-based Macs support CRC32 extension.
+    return {crc32c_armv8, "armv8"};
+#else
+    if (getauxval(AT_HWCAP) & HWCAP_CRC32) {
+        return {crc32c_armv8, "armv8"};
+    }
+#endif
+#endif
+
+    return {crc32c_slicing8, "software"};
+}
+
+const crc32c_impl& crc32c_get_impl() {
+    static const crc32c_impl impl = crc32c_select();
+    return impl;
+}
+
+} // namespace
+
+uint32_t crc32c(const void* data, size_t len, uint32_t prev_value) {
+    return crc32c_get_impl().func_(data, len, prev_value);
+}
+
+uint32_t crc32c_sw(const void* data, size_t len, uint32_t prev_value) {
+    return crc32c_slicing8(data, len, prev_value);
+}
+
+const char* crc32c_impl_name() { return crc32c_get_impl().name_; }
@@ -0,0 +1,63 @@
+/************************************************************************
+Copyright 2017-2019 eBay Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * CRC32C (Castagnoli polynomial) of the given data.
+ *
+ * The implementation is chosen at runtime, based on the CPU features:
+ *   - x86-64: SSE4.2 `crc32` instruction, combined with PCLMUL folding
+ *             for large inputs.
+ *   - ARMv8:  CRC32 extension.
+ *   - Otherwise, slicing-by-8 lookup tables.
+ *
+ * The checksum can be calculated in a streaming manner, by passing
+ * the result of the previous call as `prev_value`:
+ *
+ *   crc = crc32c(chunk1, len1, 0);
+ *   crc = crc32c(chunk2, len2, crc);
+ *
+ * gives the same result as a single call on the concatenated data.
+ *
+ * @param data Data to calculate the checksum.
+ * @param len Length of data.
+ * @param prev_value Checksum of the previous data, 0 for the first call.
+ * @return CRC32C value.
+ */
+uint32_t crc32c(const void* data, size_t len, uint32_t prev_value);
+
+/**
+ * Software (lookup table) version of `crc32c`, regardless of the CPU.
+ */
+uint32_t crc32c_sw(const void* data, size_t len, uint32_t prev_value);
+
+/**
+ * Name of the implementation that `crc32c` is using:
+ * "sse4.2+pclmul", "sse4.2", "armv8", or "software".
+ */
+const char* crc32c_impl_name();
+
+#ifdef __cplusplus
+}
+#endif
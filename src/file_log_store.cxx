@@ -0,0 +1,944 @@
+/************************************************************************
+Copyright 2017-2019 eBay Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include "file_log_store.hxx"
+
+#include "crc32c.hxx"
+#include "raft_server.hxx"
+#include "tracer.hxx"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace nuraft {
+
+namespace {
+
+//   << Log entry format in data file >>
+// length of the rest              4 bytes
+// CRC32C of the rest              4 bytes
+// term                            8 bytes
+// type                            1 byte
+// data                            ...
+//
+// All integers are little-endian.
+const size_t REC_HDR_SIZE = sizeof(uint32_t) * 2;
+const size_t ENTRY_META_SIZE = sizeof(uint64_t) + 1;
+
+// Max size of a single read, for reading a range of logs.
+const size_t MAX_READ_SIZE = 4 * 1024 * 1024;
+
+const char* DATA_FILE_EXT = ".log";
+const char* INDEX_FILE_EXT = ".idx";
+const char* START_IDX_FILE = "start_index";
+
+void put_u32_le(uint8_t* ptr, uint32_t val) {
+    for (size_t ii = 0; ii < sizeof(uint32_t); ++ii) {
+        ptr[ii] = (uint8_t)(val >> (ii * 8));
+    }
+}
+
+void put_u64_le(uint8_t* ptr, uint64_t val) {
+    for (size_t ii = 0; ii < sizeof(uint64_t); ++ii) {
+        ptr[ii] = (uint8_t)(val >> (ii * 8));
+    }
+}
+
+uint32_t get_u32_le(const uint8_t* ptr) {
+    uint32_t val = 0;
+    for (size_t ii = 0; ii < sizeof(uint32_t); ++ii) {
+        val |= (uint32_t)ptr[ii] << (ii * 8);
+    }
+    return val;
+}
+
+uint64_t get_u64_le(const uint8_t* ptr) {
+    uint64_t val = 0;
+    for (size_t ii = 0; ii < sizeof(uint64_t); ++ii) {
+        val |= (uint64_t)ptr[ii] << (ii * 8);
+    }
+    return val;
+}
+
+std::string file_name(const std::string& path, uint64_t first_idx, const char* ext) {
+    char name[32];
+    snprintf(name, sizeof(name), "%020" PRIu64 "%s", first_idx, ext);
+    return path + "/" + name;
+}
+
+std::runtime_error io_error(const std::string& what, const std::string& file) {
+    return std::runtime_error(what + " " + file + ": " + strerror(errno));
+}
+
+bool pwrite_fully(int fd, struct iovec* iov, int iovcnt, off_t offset) {
+    while (iovcnt > 0) {
+        ssize_t written = ::pwritev(fd, iov, iovcnt, offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        offset += written;
+        // Skip the written part.
+        while (iovcnt > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (uint8_t*)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+bool pread_fully(int fd, void* buf, size_t len, off_t offset) {
+    uint8_t* ptr = (uint8_t*)buf;
+    while (len > 0) {
+        ssize_t nread = ::pread(fd, ptr, len, offset);
+        if (nread < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (nread == 0) {
+            // Unexpected EOF.
+            errno = EIO;
+            return false;
+        }
+        ptr += nread;
+        len -= nread;
+        offset += nread;
+    }
+    return true;
+}
+
+int sync_data(int fd) {
+#if defined(__APPLE__)
+    return ::fsync(fd);
+#else
+    return ::fdatasync(fd);
+#endif
+}
+
+int preallocate(int fd, off_t size) {
+#if defined(__linux__)
+    int rc = ::posix_fallocate(fd, 0, size);
+    if (rc != 0) errno = rc;
+    return rc ? -1 : 0;
+#else
+    struct stat st;
+    if (::fstat(fd, &st) != 0) return -1;
+    if (st.st_size >= size) return 0;
+    return ::ftruncate(fd, size);
+#endif
+}
+
+void sync_dir(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    ::fsync(fd);
+    ::close(fd);
+}
+
+} // namespace
+
+struct file_log_store::segment {
+    /**
+     * Index of each log, in the index file.
+     */
+    struct index_slot {
+        /**
+         * End offset of the log in the data file.
+         */
+        uint64_t end_offset_;
+
+        /**
+         * Term of the log.
+         */
+        uint64_t term_;
+    };
+
+    segment(uint64_t first_idx)
+        : first_idx_(first_idx)
+        , num_entries_(0)
+        , capacity_(0)
+        , data_fd_(-1)
+        , index_fd_(-1)
+        , index_(nullptr)
+        , data_size_(0) {}
+
+    ~segment() {
+        if (index_) ::munmap(index_, capacity_ * sizeof(index_slot));
+        if (data_fd_ >= 0) ::close(data_fd_);
+        if (index_fd_ >= 0) ::close(index_fd_);
+    }
+
+    uint64_t offset_of(uint64_t nth) const {
+        return nth ? index_[nth - 1].end_offset_ : 0;
+    }
+
+    uint64_t first_idx_;
+    uint64_t num_entries_;
+    size_t capacity_;
+    int data_fd_;
+    int index_fd_;
+    index_slot* index_;
+
+    /**
+     * Size of the logs in the data file,
+     * excluding preallocated space.
+     */
+    uint64_t data_size_;
+};
+
+/**
+ * Logs in the same segment to be read at once.
+ */
+struct file_log_store::read_chunk {
+    std::shared_ptr<segment> seg_;
+
+    /**
+     * Start offset of the first log.
+     */
+    uint64_t begin_;
+
+    /**
+     * End offset of each log.
+     */
+    std::vector<uint64_t> ends_;
+};
+
+file_log_store::file_log_store(const std::string& path,
+                               const file_log_store_options& opt,
+                               const std::shared_ptr<logger>& l)
+    : path_(path)
+    , opt_(opt)
+    , l_(l)
+    , start_idx_(1)
+    , next_idx_(1)
+    , durable_idx_(0)
+    , flush_target_(0)
+    , truncate_gen_(0)
+    , raft_server_(nullptr)
+    , flush_thread_stop_(false) {
+    opt_.max_entries_per_segment_ = std::max(opt_.max_entries_per_segment_, (size_t)1);
+    recover();
+}
+
+file_log_store::~file_log_store() { close(); }
+
+void file_log_store::recover() {
+    if (::mkdir(path_.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw io_error("cannot create directory", path_);
+    }
+
+    // Find segments, by their data files.
+    std::vector<uint64_t> first_idxs;
+    DIR* dir = ::opendir(path_.c_str());
+    if (!dir) throw io_error("cannot open directory", path_);
+    struct dirent* dent = nullptr;
+    const size_t NAME_LEN = 20 + strlen(DATA_FILE_EXT);
+    while ((dent = ::readdir(dir)) != nullptr) {
+        std::string name = dent->d_name;
+        if (name.size() != NAME_LEN || name.substr(20) != DATA_FILE_EXT) continue;
+        first_idxs.push_back(std::strtoull(name.substr(0, 20).c_str(), nullptr, 10));
+    }
+    ::closedir(dir);
+    std::sort(first_idxs.begin(), first_idxs.end());
+
+    uint64_t expected_idx = 0;
+    for (size_t ii = 0; ii < first_idxs.size(); ++ii) {
+        uint64_t first_idx = first_idxs[ii];
+        if (ii && first_idx != expected_idx) {
+            // Previous segment was not completed (it should not happen
+            // unless files are corrupted), discard the rest.
+            p_er("segment %" PRIu64 " does not follow the previous one ending at "
+                 "%" PRIu64 ", discard %zu segments",
+                 first_idx,
+                 expected_idx - 1,
+                 first_idxs.size() - ii);
+            for (size_t jj = ii; jj < first_idxs.size(); ++jj) {
+                ::unlink(file_name(path_, first_idxs[jj], DATA_FILE_EXT).c_str());
+                ::unlink(file_name(path_, first_idxs[jj], INDEX_FILE_EXT).c_str());
+            }
+            sync_dir(path_);
+            break;
+        }
+
+        struct stat st;
+        std::string index_file = file_name(path_, first_idx, INDEX_FILE_EXT);
+        bool has_index = (::stat(index_file.c_str(), &st) == 0 && st.st_size > 0);
+
+        std::shared_ptr<segment> seg = open_segment(first_idx, false);
+        bool is_last = (ii + 1 == first_idxs.size());
+        uint64_t num_entries = is_last ? 0 : first_idxs[ii + 1] - first_idx;
+        if (!is_last && has_index && num_entries && num_entries <= seg->capacity_) {
+            // Sealed segment, it was synced before the next segment was created.
+            seg->num_entries_ = num_entries;
+            seg->data_size_ = seg->offset_of(num_entries);
+        } else {
+            scan_segment(*seg);
+        }
+        expected_idx = first_idx + seg->num_entries_;
+        segments_[first_idx] = seg;
+    }
+
+    uint64_t start_idx = load_start_index();
+    uint64_t next_idx = std::max(start_idx, (uint64_t)1);
+    if (!segments_.empty()) {
+        segment& last = *segments_.rbegin()->second;
+        next_idx = last.first_idx_ + last.num_entries_;
+        start_idx = std::max(start_idx, segments_.begin()->first);
+    }
+    start_idx = std::max(start_idx, (uint64_t)1);
+
+    if (start_idx > next_idx) {
+        // All logs were compacted.
+        remove_all_segments(start_idx);
+    } else {
+        start_idx_ = start_idx;
+        next_idx_ = next_idx;
+        // Remove segments that were compacted but not removed yet.
+        while (segments_.size() > 1 && std::next(segments_.begin())->first <= start_idx) {
+            remove_segment(segments_.begin()->first);
+        }
+    }
+    durable_idx_ = next_idx_ - 1;
+    flush_target_ = next_idx_ - 1;
+
+    if (next_idx_ > start_idx_) {
+        std::vector<read_chunk> chunks;
+        if (collect_chunks(next_idx_ - 1, next_idx_, 0, chunks)) {
+            auto entries = read_chunks(chunks);
+            if (entries && !entries->empty()) last_entry_ = entries->back();
+        }
+        if (!last_entry_) {
+            throw std::runtime_error("cannot read the last log in " + path_);
+        }
+    }
+
+    p_in("opened log store %s, %zu segments, log range %" PRIu64 " - %" PRIu64,
+         path_.c_str(),
+         segments_.size(),
+         start_idx_.load(),
+         next_idx_ - 1);
+}
+
+uint64_t file_log_store::load_start_index() {
+    std::string file = path_ + "/" + START_IDX_FILE;
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) return 0;
+
+    uint8_t data[sizeof(uint64_t) + sizeof(uint32_t)];
+    bool ok = pread_fully(fd, data, sizeof(data), 0);
+    ::close(fd);
+    if (!ok || crc32c(data, sizeof(uint64_t), 0) != get_u32_le(data + sizeof(uint64_t))) {
+        p_wn("invalid start index file %s, ignore it", file.c_str());
+        return 0;
+    }
+    return get_u64_le(data);
+}
+
+void file_log_store::save_start_index(uint64_t start_idx) {
+    uint8_t data[sizeof(uint64_t) + sizeof(uint32_t)];
+    put_u64_le(data, start_idx);
+    put_u32_le(data + sizeof(uint64_t), crc32c(data, sizeof(uint64_t), 0));
+
+    // Write to a temporary file and rename it, to replace the file atomically.
+    std::string file = path_ + "/" + START_IDX_FILE;
+    std::string tmp_file = file + ".tmp";
+    int fd = ::open(tmp_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) throw io_error("cannot open", tmp_file);
+
+    struct iovec iov = {data, sizeof(data)};
+    bool ok = pwrite_fully(fd, &iov, 1, 0) && ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || ::rename(tmp_file.c_str(), file.c_str()) != 0) {
+        throw io_error("cannot write", file);
+    }
+    sync_dir(path_);
+}
+
+std::shared_ptr<file_log_store::segment> file_log_store::open_segment(uint64_t first_idx,
+                                                                      bool create) {
+    std::shared_ptr<segment> seg = std::make_shared<segment>(first_idx);
+    std::string data_file = file_name(path_, first_idx, DATA_FILE_EXT);
+    std::string index_file = file_name(path_, first_idx, INDEX_FILE_EXT);
+
+    seg->data_fd_ = ::open(data_file.c_str(), O_RDWR | (create ? O_CREAT : 0), 0644);
+    if (seg->data_fd_ < 0) throw io_error("cannot open", data_file);
+    seg->index_fd_ = ::open(index_file.c_str(), O_RDWR | O_CREAT, 0644);
+    if (seg->index_fd_ < 0) throw io_error("cannot open", index_file);
+
+    // Existing index file keeps its capacity.
+    size_t index_size = opt_.max_entries_per_segment_ * sizeof(segment::index_slot);
+    struct stat st;
+    if (::fstat(seg->index_fd_, &st) != 0) throw io_error("cannot stat", index_file);
+    if (!create && st.st_size >= (off_t)sizeof(segment::index_slot)) {
+        index_size = st.st_size - st.st_size % sizeof(segment::index_slot);
+    } else if (::ftruncate(seg->index_fd_, index_size) != 0) {
+        throw io_error("cannot resize", index_file);
+    }
+    seg->capacity_ = index_size / sizeof(segment::index_slot);
+
+    void* addr = ::mmap(
+        nullptr, index_size, PROT_READ | PROT_WRITE, MAP_SHARED, seg->index_fd_, 0);
+    if (addr == MAP_FAILED) throw io_error("cannot mmap", index_file);
+    seg->index_ = static_cast<segment::index_slot*>(addr);
+
+    if (create) {
+        if (opt_.preallocate_ && preallocate(seg->data_fd_, opt_.segment_size_) != 0) {
+            p_wn("cannot preallocate %s: %s", data_file.c_str(), strerror(errno));
+        }
+        sync_dir(path_);
+        p_in("created segment %s", data_file.c_str());
+    }
+    return seg;
+}
+
+void file_log_store::scan_segment(segment& seg) {
+    struct stat st;
+    if (::fstat(seg.data_fd_, &st) != 0) {
+        throw io_error("cannot stat", file_name(path_, seg.first_idx_, DATA_FILE_EXT));
+    }
+    uint64_t file_size = st.st_size;
+
+    // Read logs until the first invalid one,
+    // which is either preallocated space or a torn write.
+    uint64_t offset = 0;
+    uint64_t num = 0;
+    std::vector<uint8_t> rec;
+    while (num < seg.capacity_ && offset + REC_HDR_SIZE <= file_size) {
+        uint8_t hdr[REC_HDR_SIZE];
+        if (!pread_fully(seg.data_fd_, hdr, REC_HDR_SIZE, offset)) break;
+        uint32_t len = get_u32_le(hdr);
+        if (len < ENTRY_META_SIZE || offset + REC_HDR_SIZE + len > file_size) break;
+
+        rec.resize(len);
+        if (!pread_fully(seg.data_fd_, rec.data(), len, offset + REC_HDR_SIZE)) break;
+        if (crc32c(rec.data(), len, 0) != get_u32_le(hdr + sizeof(uint32_t))) break;
+
+        offset += REC_HDR_SIZE + len;
+        seg.index_[num].end_offset_ = offset;
+        seg.index_[num].term_ = get_u64_le(rec.data());
+        num++;
+    }
+    seg.num_entries_ = num;
+    seg.data_size_ = offset;
+
+    if (offset < file_size) {
+        // Clear the rest, so that logs appended later
+        // are not followed by stale data.
+        p_in("segment %" PRIu64 ": %" PRIu64 " logs, clear %" PRIu64 " bytes after them",
+             seg.first_idx_,
+             num,
+             file_size - offset);
+        if (::ftruncate(seg.data_fd_, offset) != 0) {
+            throw io_error("cannot truncate",
+                           file_name(path_, seg.first_idx_, DATA_FILE_EXT));
+        }
+        if (opt_.preallocate_) preallocate(seg.data_fd_, opt_.segment_size_);
+        sync_data(seg.data_fd_);
+    }
+}
+
+void file_log_store::remove_segment(uint64_t first_idx) {
+    // Files will be closed once nobody refers to the segment,
+    // but they can be unlinked now.
+    segments_.erase(first_idx);
+    ::unlink(file_name(path_, first_idx, DATA_FILE_EXT).c_str());
+    ::unlink(file_name(path_, first_idx, INDEX_FILE_EXT).c_str());
+    sync_dir(path_);
+    p_in("removed segment %" PRIu64, first_idx);
+}
+
+void file_log_store::remove_all_segments(uint64_t new_start) {
+    truncate_gen_++;
+    while (!segments_.empty()) {
+        remove_segment(segments_.begin()->first);
+    }
+    // Should be done after removing segments,
+    // otherwise their logs may be regarded as valid after crash.
+    save_start_index(new_start);
+    start_idx_ = new_start;
+    next_idx_ = new_start;
+    durable_idx_ = new_start - 1;
+    flush_target_ = new_start - 1;
+    last_entry_.reset();
+}
+
+void file_log_store::roll_segment() {
+    if (!segments_.empty()) {
+        // Seal the current segment. Recovery does not scan it,
+        // hence it should be durable before the next segment is created.
+        segment& cur = *segments_.rbegin()->second;
+        if (::ftruncate(cur.data_fd_, cur.data_size_) != 0 || sync_data(cur.data_fd_) != 0
+            || ::msync(cur.index_, cur.capacity_ * sizeof(segment::index_slot), MS_SYNC)
+                   != 0) {
+            throw io_error("cannot seal",
+                           file_name(path_, cur.first_idx_, DATA_FILE_EXT));
+        }
+    }
+    segments_[next_idx_] = open_segment(next_idx_, true);
+}
+
+uint64_t file_log_store::append(std::shared_ptr<log_entry>& entry) {
+    std::lock_guard<std::mutex> l(lock_);
+    return append_locked(entry);
+}
+
+uint64_t file_log_store::append_locked(std::shared_ptr<log_entry>& entry) {
+    std::shared_ptr<buffer> data = entry->get_buf_ptr();
+    size_t data_size = data ? data->size() : 0;
+    uint32_t len = ENTRY_META_SIZE + data_size;
+
+    uint8_t hdr[REC_HDR_SIZE + ENTRY_META_SIZE];
+    uint8_t* meta = hdr + REC_HDR_SIZE;
+    put_u64_le(meta, entry->get_term());
+    meta[sizeof(uint64_t)] = static_cast<uint8_t>(entry->get_val_type());
+    uint32_t crc = crc32c(meta, ENTRY_META_SIZE, 0);
+    if (data_size) crc = crc32c(data->data_begin(), data_size, crc);
+    put_u32_le(hdr, len);
+    put_u32_le(hdr + sizeof(uint32_t), crc);
+
+    std::shared_ptr<segment> seg =
+        segments_.empty() ? nullptr : segments_.rbegin()->second;
+    if (!seg || seg->num_entries_ >= seg->capacity_
+        || (seg->num_entries_
+            && seg->data_size_ + REC_HDR_SIZE + len > opt_.segment_size_)) {
+        roll_segment();
+        seg = segments_.rbegin()->second;
+    }
+
+    struct iovec iov[2];
+    iov[0].iov_base = hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[1].iov_base = data_size ? data->data_begin() : nullptr;
+    iov[1].iov_len = data_size;
+    if (!pwrite_fully(seg->data_fd_, iov, 2, seg->data_size_)) {
+        throw io_error("cannot write", file_name(path_, seg->first_idx_, DATA_FILE_EXT));
+    }
+
+    seg->data_size_ += REC_HDR_SIZE + len;
+    seg->index_[seg->num_entries_].end_offset_ = seg->data_size_;
+    seg->index_[seg->num_entries_].term_ = entry->get_term();
+    seg->num_entries_++;
+    last_entry_ = entry;
+    return next_idx_++;
+}
+
+void file_log_store::write_at(uint64_t index, std::shared_ptr<log_entry>& entry) {
+    std::lock_guard<std::mutex> l(lock_);
+    if (index < start_idx_ || index > next_idx_) {
+        // Not contiguous to the existing logs, start over from the given index.
+        p_wn("write log %" PRIu64 " out of range %" PRIu64 " - %" PRIu64
+             ", remove all logs",
+             index,
+             start_idx_.load(),
+             next_idx_ - 1);
+        remove_all_segments(index);
+    } else {
+        truncate_from(index);
+    }
+    append_locked(entry);
+}
+
+void file_log_store::truncate_from(uint64_t index) {
+    if (index >= next_idx_) return;
+    truncate_gen_++;
+
+    while (!segments_.empty() && segments_.rbegin()->first >= index) {
+        remove_segment(segments_.rbegin()->first);
+    }
+    if (!segments_.empty()) {
+        segment& seg = *segments_.rbegin()->second;
+        uint64_t num = index - seg.first_idx_;
+        if (num < seg.num_entries_) {
+            seg.num_entries_ = num;
+            seg.data_size_ = seg.offset_of(num);
+            // Clear the truncated logs, so that recovery does not see them.
+            if (::ftruncate(seg.data_fd_, seg.data_size_) != 0) {
+                throw io_error("cannot truncate",
+                               file_name(path_, seg.first_idx_, DATA_FILE_EXT));
+            }
+            if (opt_.preallocate_) preallocate(seg.data_fd_, opt_.segment_size_);
+        }
+    }
+
+    next_idx_ = index;
+    durable_idx_ = std::min(durable_idx_.load(), index - 1);
+    flush_target_ = std::min(flush_target_.load(), index - 1);
+
+    last_entry_.reset();
+    std::vector<read_chunk> chunks;
+    if (index > start_idx_ && collect_chunks(index - 1, index, 0, chunks)) {
+        auto entries = read_chunks(chunks);
+        if (entries && !entries->empty()) last_entry_ = entries->back();
+    }
+}
+
+void file_log_store::end_of_append_batch(uint64_t start, uint64_t cnt) {
+    if (!cnt) return;
+
+    if (raft_server_) {
+        // Let the background thread sync them.
+        uint64_t last_idx = start + cnt - 1;
+        uint64_t cur_target = flush_target_;
+        while (cur_target < last_idx
+               && !flush_target_.compare_exchange_weak(cur_target, last_idx)) {
+        }
+        flush_ea_.invoke();
+        return;
+    }
+
+    if (opt_.sync_on_append_batch_) {
+        sync_active_segment();
+    }
+}
+
+bool file_log_store::collect_chunks(uint64_t start,
+                                    uint64_t end,
+                                    int64_t batch_size_hint_in_bytes,
+                                    std::vector<read_chunk>& chunks_out) const {
+    if (start < start_idx_ || end > next_idx_ || start > end) return false;
+    if (start == end) return true;
+
+    auto it = segments_.upper_bound(start);
+    if (it == segments_.begin()) return false;
+    --it;
+
+    uint64_t accum_size = 0;
+    for (uint64_t ii = start; ii < end; ++ii) {
+        while (it != segments_.end()
+               && ii >= it->second->first_idx_ + it->second->num_entries_) {
+            ++it;
+        }
+        if (it == segments_.end()) return false;
+
+        const std::shared_ptr<segment>& seg = it->second;
+        uint64_t nth = ii - seg->first_idx_;
+        uint64_t begin = seg->offset_of(nth);
+        uint64_t end_offset = seg->index_[nth].end_offset_;
+        if (chunks_out.empty() || chunks_out.back().seg_ != seg
+            || end_offset - chunks_out.back().begin_ > MAX_READ_SIZE) {
+            chunks_out.emplace_back();
+            chunks_out.back().seg_ = seg;
+            chunks_out.back().begin_ = begin;
+        }
+        chunks_out.back().ends_.push_back(end_offset);
+
+        accum_size += end_offset - begin - REC_HDR_SIZE - ENTRY_META_SIZE;
+        if (batch_size_hint_in_bytes
+            && accum_size >= (uint64_t)batch_size_hint_in_bytes) {
+            break;
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<std::vector<std::shared_ptr<log_entry>>>
+file_log_store::read_chunks(const std::vector<read_chunk>& chunks) {
+    std::shared_ptr<std::vector<std::shared_ptr<log_entry>>> ret =
+        std::make_shared<std::vector<std::shared_ptr<log_entry>>>();
+
+    for (const read_chunk& chunk: chunks) {
+        uint64_t len = chunk.ends_.back() - chunk.begin_;
+        std::shared_ptr<buffer> buf = buffer::alloc(len);
+        if (!pread_fully(chunk.seg_->data_fd_, buf->data_begin(), len, chunk.begin_)) {
+            p_er("failed to read segment %" PRIu64 " at offset %" PRIu64 ": %s",
+                 chunk.seg_->first_idx_,
+                 chunk.begin_,
+                 strerror(errno));
+            return nullptr;
+        }
+
+        // Log data is not copied, but referred to by slices of the buffer.
+        uint64_t offset = 0;
+        for (uint64_t end_offset: chunk.ends_) {
+            uint64_t rec_len = end_offset - chunk.begin_ - offset;
+            const uint8_t* rec = (const uint8_t*)buf->data_begin() + offset;
+            uint32_t len = get_u32_le(rec);
+            if (rec_len < REC_HDR_SIZE + ENTRY_META_SIZE || len != rec_len - REC_HDR_SIZE
+                || crc32c(rec + REC_HDR_SIZE, len, 0)
+                       != get_u32_le(rec + sizeof(uint32_t))) {
+                p_er("corrupted log in segment %" PRIu64 " at offset %" PRIu64,
+                     chunk.seg_->first_idx_,
+                     chunk.begin_ + offset);
+                return nullptr;
+            }
+
+            const uint8_t* meta = rec + REC_HDR_SIZE;
+            uint64_t term = get_u64_le(meta);
+            log_val_type type = static_cast<log_val_type>(meta[sizeof(uint64_t)]);
+            std::shared_ptr<buffer> data =
+                buffer::slice(buf,
+                              offset + REC_HDR_SIZE + ENTRY_META_SIZE,
+                              len - ENTRY_META_SIZE);
+            ret->push_back(std::make_shared<log_entry>(term, data, type));
+            offset += rec_len;
+        }
+    }
+    return ret;
+}
+
+std::shared_ptr<std::vector<std::shared_ptr<log_entry>>>
+file_log_store::log_entries(uint64_t start, uint64_t end) {
+    return log_entries_ext(start, end, 0);
+}
+
+std::shared_ptr<std::vector<std::shared_ptr<log_entry>>>
+file_log_store::log_entries_ext(uint64_t start,
+                                uint64_t end,
+                                int64_t batch_size_hint_in_bytes) {
+    if (batch_size_hint_in_bytes < 0) {
+        return std::make_shared<std::vector<std::shared_ptr<log_entry>>>();
+    }
+
+    std::vector<read_chunk> chunks;
+    {
+        std::lock_guard<std::mutex> l(lock_);
+        if (!collect_chunks(start, end, batch_size_hint_in_bytes, chunks)) {
+            p_wn("log range %" PRIu64 " - %" PRIu64 " is not available, "
+                 "current range %" PRIu64 " - %" PRIu64,
+                 start,
+                 end - 1,
+                 start_idx_.load(),
+                 next_idx_ - 1);
+            return nullptr;
+        }
+    }
+    return read_chunks(chunks);
+}
+
+std::shared_ptr<log_entry> file_log_store::entry_at(uint64_t index) {
+    std::shared_ptr<std::vector<std::shared_ptr<log_entry>>> entries =
+        log_entries(index, index + 1);
+    if (!entries || entries->empty()) return nullptr;
+    return entries->at(0);
+}
+
+uint64_t file_log_store::term_at(uint64_t index) {
+    std::lock_guard<std::mutex> l(lock_);
+    if (index < start_idx_ || index >= next_idx_) return 0;
+
+    auto it = segments_.upper_bound(index);
+    if (it == segments_.begin()) return 0;
+    --it;
+    const segment& seg = *it->second;
+    uint64_t nth = index - seg.first_idx_;
+    if (nth >= seg.num_entries_) return 0;
+    return seg.index_[nth].term_;
+}
+
+bool file_log_store::terms_in_range(uint64_t start,
+                                    uint64_t end,
+                                    std::vector<uint64_t>& terms_out) {
+    terms_out.clear();
+    std::lock_guard<std::mutex> l(lock_);
+    if (start < start_idx_ || end > next_idx_ || start > end) return false;
+    if (start == end) return true;
+
+    auto it = segments_.upper_bound(start);
+    if (it == segments_.begin()) return false;
+    --it;
+
+    terms_out.reserve(end - start);
+    uint64_t idx = start;
+    for (; it != segments_.end() && idx < end; ++it) {
+        const segment& seg = *it->second;
+        if (idx < seg.first_idx_) break;
+        uint64_t seg_end = std::min(end, seg.first_idx_ + seg.num_entries_);
+        for (; idx < seg_end; ++idx) {
+            terms_out.push_back(seg.index_[idx - seg.first_idx_].term_);
+        }
+    }
+    return idx == end;
+}
+
+uint64_t file_log_store::next_slot() const { return next_idx_; }
+
+uint64_t file_log_store::start_index() const { return start_idx_; }
+
+std::shared_ptr<log_entry> file_log_store::last_entry() const {
+    std::lock_guard<std::mutex> l(lock_);
+    if (last_entry_) return last_entry_;
+    return std::make_shared<log_entry>(0, buffer::alloc(sizeof(uint64_t)));
+}
+
+std::shared_ptr<buffer> file_log_store::pack(uint64_t index, int32_t cnt) {
+    std::shared_ptr<std::vector<std::shared_ptr<log_entry>>> entries =
+        log_entries(index, index + cnt);
+    if (!entries) return nullptr;
+
+    std::vector<std::shared_ptr<buffer>> logs;
+    size_t size_total = 0;
+    for (auto& entry: *entries) {
+        std::shared_ptr<buffer> buf = entry->serialize();
+        size_total += buf->size();
+        logs.push_back(buf);
+    }
+
+    std::shared_ptr<buffer> buf_out =
+        buffer::alloc(sizeof(int32_t) + logs.size() * sizeof(int32_t) + size_total);
+    buf_out->pos(0);
+    buf_out->put((int32_t)logs.size());
+    for (auto& entry: logs) {
+        buf_out->put((int32_t)entry->size());
+        buf_out->put(*entry);
+    }
+    buf_out->pos(0);
+    return buf_out;
+}
+
+void file_log_store::apply_pack(uint64_t index, buffer& pack) {
+    pack.pos(0);
+    int32_t num_logs = pack.get_int();
+
+    {
+        std::lock_guard<std::mutex> l(lock_);
+        if (index < start_idx_ || index > next_idx_) {
+            remove_all_segments(index);
+        } else {
+            truncate_from(index);
+        }
+
+        for (int32_t ii = 0; ii < num_logs; ++ii) {
+            int32_t buf_size = pack.get_int();
+            std::shared_ptr<buffer> buf_local = buffer::alloc(buf_size);
+            pack.get(buf_local);
+            std::shared_ptr<log_entry> le = log_entry::deserialize(*buf_local);
+            append_locked(le);
+        }
+    }
+    sync_active_segment();
+}
+
+bool file_log_store::compact(uint64_t last_log_index) {
+    std::lock_guard<std::mutex> l(lock_);
+    if (last_log_index < start_idx_) return true;
+
+    uint64_t new_start = last_log_index + 1;
+    if (new_start >= next_idx_) {
+        // All logs are compacted.
+        remove_all_segments(new_start);
+        return true;
+    }
+
+    // Should be done before removing segments, so that
+    // recovery does not regard the rest of the segment as valid.
+    save_start_index(new_start);
+    start_idx_ = new_start;
+
+    // Remove segments whose logs are all compacted.
+    while (segments_.size() > 1 && std::next(segments_.begin())->first <= new_start) {
+        remove_segment(segments_.begin()->first);
+    }
+    return true;
+}
+
+bool file_log_store::sync_active_segment() {
+    std::shared_ptr<segment> seg;
+    uint64_t target_idx = 0;
+    uint64_t gen = 0;
+    {
+        std::lock_guard<std::mutex> l(lock_);
+        target_idx = next_idx_ - 1;
+        gen = truncate_gen_;
+        if (!segments_.empty()) seg = segments_.rbegin()->second;
+    }
+
+    // Other segments were synced when they were sealed.
+    if (seg && sync_data(seg->data_fd_) != 0) {
+        p_er("failed to sync segment %" PRIu64 ": %s", seg->first_idx_, strerror(errno));
+        return false;
+    }
+
+    std::lock_guard<std::mutex> l(lock_);
+    if (gen == truncate_gen_ && target_idx > durable_idx_) {
+        durable_idx_ = target_idx;
+    }
+    return true;
+}
+
+bool file_log_store::flush() { return sync_active_segment(); }
+
+uint64_t file_log_store::last_durable_index() {
+    if (!raft_server_ && !opt_.sync_on_append_batch_) {
+        return next_idx_ - 1;
+    }
+    return durable_idx_;
+}
+
+void file_log_store::start_async_flush(raft_server* raft) {
+    std::lock_guard<std::mutex> l(lock_);
+    if (flush_thread_) return;
+
+    raft_server_ = raft;
+    flush_thread_stop_ = false;
+    flush_thread_ =
+        std::unique_ptr<std::thread>(new std::thread(&file_log_store::flush_loop, this));
+}
+
+void file_log_store::flush_loop() {
+    while (!flush_thread_stop_) {
+        // Reset before checking the target, so that a request
+        // made after the check wakes up the wait below.
+        flush_ea_.reset();
+        if (flush_target_ > durable_idx_) {
+            // Logs requested while syncing will be synced together next time.
+            bool ok = sync_active_segment();
+            raft_server_->notify_log_append_completion(ok);
+            if (ok) continue;
+        }
+        flush_ea_.wait_ms(100);
+    }
+}
+
+void file_log_store::close() {
+    if (flush_thread_) {
+        flush_thread_stop_ = true;
+        flush_ea_.invoke();
+        if (flush_thread_->joinable()) {
+            flush_thread_->join();
+        }
+        flush_thread_.reset();
+    }
+
+    std::lock_guard<std::mutex> l(lock_);
+    if (!segments_.empty()) {
+        sync_data(segments_.rbegin()->second->data_fd_);
+    }
+    segments_.clear();
+}
+
+size_t file_log_store::num_segments() const {
+    std::lock_guard<std::mutex> l(lock_);
+    return segments_.size();
+}
+
+} // namespace nuraft
@@ -26,6 +26,7 @@ limitations under the License.
 #include "error_code.hxx"
 #include "event_awaiter.hxx"
 #include "handle_custom_notification.hxx"
+#include "log_tail_cache.hxx"
 #include "peer.hxx"
 #include "snapshot.hxx"
 #include "state_machine.hxx"
@@ -38,6 +39,9 @@ limitations under the License.
 
 namespace nuraft {
 
+// Max number of log entry ranges to keep in `repl_cache_`.
+static const size_t REPL_CACHE_SIZE = 4;
+
 /**
  * Additional information in addition to `append_entries_response`.
  */
@@ -48,20 +52,33 @@ struct resp_appendix {
     };
 
     resp_appendix()
-        : extra_order_(NONE) {}
+        : extra_order_(NONE)
+        , conflict_term_(0)
+        , conflict_term_first_idx_(0) {}
 
     std::shared_ptr<buffer> serialize() const {
-        const static uint8_t CUR_VERSION = 0;
+        // Use version 0 if possible, as old versions cannot read version 1.
+        const uint8_t CUR_VERSION = conflict_term_ ? 1 : 0;
         size_t buf_len = sizeof(CUR_VERSION) + sizeof(extra_order_);
+        if (CUR_VERSION >= 1) {
+            buf_len += sizeof(conflict_term_) + sizeof(conflict_term_first_idx_);
+        }
 
         //  << Format >>
         // Format version       1 byte
         // Extra order          1 byte
+        //  (version 1)
+        // Conflict term        8 bytes
+        // First log index of conflict term   8 bytes
 
         auto result = buffer::alloc(buf_len);
         buffer_serializer bs(*result);
         bs.put_u8(CUR_VERSION);
         bs.put_u8(extra_order_);
+        if (CUR_VERSION >= 1) {
+            bs.put_u64(conflict_term_);
+            bs.put_u64(conflict_term_first_idx_);
+        }
 
         return result;
     }
@@ -71,12 +88,16 @@ struct resp_appendix {
         auto res = std::make_shared<resp_appendix>();
 
         uint8_t cur_ver = bs.get_u8();
-        if (cur_ver != 0) {
+        if (cur_ver > 1) {
             // Not supported version.
             return res;
         }
 
         res->extra_order_ = static_cast<extra_order>(bs.get_u8());
+        if (cur_ver >= 1) {
+            res->conflict_term_ = bs.get_u64();
+            res->conflict_term_first_idx_ = bs.get_u64();
+        }
         return res;
     }
 
@@ -92,6 +113,17 @@ struct resp_appendix {
     };
 
     extra_order extra_order_;
+
+    /**
+     * If non-zero, the term of the follower's log at the index
+     * the leader tried to match, which is different from the leader's.
+     */
+    uint64_t conflict_term_;
+
+    /**
+     * The first log index of `conflict_term_` in the follower's log.
+     */
+    uint64_t conflict_term_first_idx_;
 };
 
 void raft_server::append_entries_in_bg() {
@@ -246,6 +278,7 @@ bool raft_server::request_append_entries(std::shared_ptr<peer> p) {
                  p->get_matched_idx());
             p->set_next_log_idx(0);
             p->set_matched_idx(0);
+            update_voter_matched_idx(p);
         }
         p->clear_reconnection();
     }
@@ -258,6 +291,11 @@ bool raft_server::request_append_entries(std::shared_ptr<peer> p) {
         }
     }
 
+    if (params->append_pipelining_enabled() && p->is_busy()
+        && request_pipelined_append_entries(p)) {
+        return true;
+    }
+
     if (p->make_busy()) {
         p_tr("send request to %d\n", (int)p->get_id());
 
@@ -364,6 +402,57 @@ bool raft_server::request_append_entries(std::shared_ptr<peer> p) {
     return false;
 }
 
+bool raft_server::request_pipelined_append_entries(std::shared_ptr<peer>& p) {
+    std::shared_ptr<raft_params> params = ctx_->get_params();
+
+    // Reserved message, snapshot, or leaving server should be handled
+    // one by one, by the regular path.
+    if (p->get_rsv_msg() || p->get_snapshot_sync_ctx()) return false;
+    if (srv_to_leave_ && srv_to_leave_->get_id() == p->get_id()) return false;
+
+    {
+        auto guard = auto_lock(p->get_lock());
+        if (!p->is_pipeline_ready()) {
+            // Previous request is not accepted yet,
+            // we don't know where to start.
+            return false;
+        }
+        if (!p->get_next_log_idx() || p->get_next_log_idx() > precommit_index_) {
+            // Nothing to send.
+            return false;
+        }
+        size_t num_inflight = p->get_num_inflight_appends();
+        if (num_inflight >= (size_t)params->max_append_reqs_in_flight_) {
+            p_tr("peer %d has %zu requests in flight, window is full",
+                 p->get_id(),
+                 num_inflight);
+            return false;
+        }
+        uint64_t inflight_bytes = p->get_inflight_append_bytes();
+        if (params->max_append_bytes_in_flight_
+            && inflight_bytes >= (uint64_t)params->max_append_bytes_in_flight_) {
+            p_tr("peer %d has %" PRIu64 " bytes in flight, window is full",
+                 p->get_id(),
+                 inflight_bytes);
+            return false;
+        }
+    }
+
+    std::shared_ptr<req_msg> msg = create_append_entries_req(p);
+    if (!msg) return true;
+
+    p_tr("send pipelined request to %d, last log idx %" PRIu64 ", %zu entries",
+         p->get_id(),
+         msg->get_last_log_idx(),
+         msg->log_entries().size());
+    p->send_req(p, msg, resp_handler_);
+    p->reset_ls_timer();
+
+    auto param = cb_func::Param(id_, leader_, p->get_id(), msg.get());
+    ctx_->cb_func_.call(cb_func::SentAppendEntriesReq, &param);
+    return true;
+}
+
 std::shared_ptr<req_msg>
 raft_server::create_append_entries_req(std::shared_ptr<peer>& pp) {
     peer& p = *pp;
@@ -445,8 +534,8 @@ raft_server::create_append_entries_req(std::shared_ptr<peer>& pp) {
     if ((last_log_idx + 1) >= cur_nxt_idx) {
         log_entries = std::shared_ptr<std::vector<std::shared_ptr<log_entry>>>();
     } else if (entries_valid) {
-        log_entries = log_store_->log_entries_ext(
-            last_log_idx + 1, end_idx, p.get_next_batch_size_hint_in_bytes());
+        log_entries = get_log_entries_for_replication(
+            term, last_log_idx + 1, end_idx, p.get_next_batch_size_hint_in_bytes());
         if (log_entries == nullptr) {
             p_wn("failed to retrieve log entries: %" PRIu64 " - %" PRIu64,
                  last_log_idx + 1,
@@ -456,6 +545,13 @@ raft_server::create_append_entries_req(std::shared_ptr<peer>& pp) {
     }
 
     if (!entries_valid) {
+        if (ctx_->get_params()->append_pipelining_enabled()) {
+            // Requests in flight will be rejected anyway, they should
+            // not move the log index of this peer.
+            auto guard = auto_lock(p.get_lock());
+            p.invalidate_inflight_appends();
+        }
+
         // Required log entries are missing. First, we try to use snapshot to recover.
         // To avoid inconsistency due to smart pointer, should have local varaible
         // to increase its ref count.
@@ -559,9 +655,54 @@ raft_server::create_append_entries_req(std::shared_ptr<peer>& pp) {
     }
     p.set_last_sent_idx(last_log_idx + 1);
 
+    if (ctx_->get_params()->append_pipelining_enabled()) {
+        uint64_t payload_bytes = 0;
+        for (auto& le: v) {
+            if (!le->is_buf_null()) payload_bytes += le->get_buf().size();
+        }
+        auto guard = auto_lock(p.get_lock());
+        p.add_inflight_append(last_log_idx + 1, payload_bytes);
+        // Optimistically assume that this request will be accepted,
+        // so that the next request can be sent before its response.
+        p.set_next_log_idx(adjusted_end_idx);
+    }
+
     return req;
 }
 
+std::shared_ptr<std::vector<std::shared_ptr<log_entry>>>
+raft_server::get_log_entries_for_replication(uint64_t term,
+                                             uint64_t start_idx,
+                                             uint64_t end_idx,
+                                             int64_t batch_size_hint) {
+    // Leader never overwrites its own logs within the same term,
+    // so that the same term and range always returns the same log entries.
+    {
+        auto guard = auto_lock(repl_cache_lock_);
+        for (auto& entry: repl_cache_) {
+            if (entry.term_ == term && entry.start_idx_ == start_idx
+                && entry.end_idx_ == end_idx
+                && entry.batch_size_hint_ == batch_size_hint) {
+                return entry.entries_;
+            }
+        }
+    }
+
+    std::shared_ptr<std::vector<std::shared_ptr<log_entry>>> log_entries =
+        cached_log_entries(start_idx, end_idx, batch_size_hint);
+    if (!log_entries) return log_entries;
+
+    auto guard = auto_lock(repl_cache_lock_);
+    if (!repl_cache_.empty() && repl_cache_.front().term_ != term) {
+        repl_cache_.clear();
+    }
+    repl_cache_.push_front({term, start_idx, end_idx, batch_size_hint, log_entries});
+    while (repl_cache_.size() > REPL_CACHE_SIZE) {
+        repl_cache_.pop_back();
+    }
+    return log_entries;
+}
+
 std::shared_ptr<resp_msg> raft_server::handle_append_entries(req_msg& req) {
     bool supp_exp_warning = false;
     if (catching_up_) {
@@ -636,11 +777,11 @@ std::shared_ptr<resp_msg> raft_server::handle_append_entries(req_msg& req) {
                                    msg_type::append_entries_response,
                                    id_,
                                    req.get_src(),
-                                   log_store_->next_slot());
+                                   log_tail_->next_slot());
 
     std::shared_ptr<snapshot> local_snp = get_last_snapshot();
     uint64_t log_term = 0;
-    if (req.get_last_log_idx() < log_store_->next_slot()) {
+    if (req.get_last_log_idx() < log_tail_->next_slot()) {
         log_term = term_for_log(req.get_last_log_idx());
     }
     bool log_okay =
@@ -663,10 +804,19 @@ std::shared_ptr<resp_msg> raft_server::handle_append_entries(req_msg& req) {
          (log_okay ? "OK" : "XX"),
          req.get_last_log_idx(),
          req.get_last_log_term(),
-         log_store_->next_slot() - 1,
+         log_tail_->next_slot() - 1,
          req.get_last_log_idx(),
          log_term);
 
+    if (!log_okay && req.get_term() == state_->get_term() && role_ == srv_role::follower
+        && !catching_up_ && !req.log_entries().empty()
+        && req.get_last_log_idx() >= log_tail_->next_slot()
+        && park_append_entries_req(req, resp)) {
+        // Preceding requests may still be on the other connections.
+        restart_election_timer();
+        return resp;
+    }
+
     if (req.get_term() < state_->get_term() || log_okay == false) {
         p_lv(log_lv,
              "deny, req term %" PRIu64 ", my term %" PRIu64 ", req log idx %" PRIu64
@@ -674,13 +824,28 @@ std::shared_ptr<resp_msg> raft_server::handle_append_entries(req_msg& req) {
              req.get_term(),
              state_->get_term(),
              req.get_last_log_idx(),
-             log_store_->next_slot() - 1);
+             log_tail_->next_slot() - 1);
         if (local_snp) {
             p_lv(log_lv,
                  "snp idx %" PRIu64 " term %" PRIu64,
                  local_snp->get_last_log_idx(),
                  local_snp->get_last_log_term());
         }
+        if (req.get_term() == state_->get_term() && log_term
+            && req.get_last_log_idx() >= log_store_->start_index()) {
+            // The log at the given index has a different term. Tell the leader
+            // the term and where it starts, so that the leader can skip all
+            // logs of the term at once, instead of one by one.
+            resp_appendix appendix;
+            appendix.conflict_term_ = log_term;
+            appendix.conflict_term_first_idx_ =
+                first_log_idx_of_term(req.get_last_log_idx());
+            resp->set_ctx(appendix.serialize());
+            p_lv(log_lv,
+                 "conflict term %" PRIu64 ", first log idx of the term %" PRIu64,
+                 appendix.conflict_term_,
+                 appendix.conflict_term_first_idx_);
+        }
         resp->set_next_batch_size_hint_in_bytes(
             state_machine_->get_next_batch_size_hint_in_bytes());
         return resp;
@@ -720,6 +885,8 @@ std::shared_ptr<resp_msg> raft_server::handle_append_entries(req_msg& req) {
         return resp;
     }
 
+    // If `true`, the response will be sent once the logs become durable.
+    bool defer_resp = false;
     if (req.log_entries().size() > 0) {
         // Write logs to store, start from overlapped logs
 
@@ -733,17 +900,21 @@ std::shared_ptr<resp_msg> raft_server::handle_append_entries(req_msg& req) {
              "req.log_entries().size(): %zu",
              log_idx,
              cnt,
-             log_store_->next_slot(),
+             log_tail_->next_slot(),
              req.log_entries().size());
 
         // Skipping already existing (with the same term) logs.
-        while (log_idx < log_store_->next_slot() && cnt < req.log_entries().size()) {
-            if (log_store_->term_at(log_idx) == req.log_entries().at(cnt)->get_term()) {
-                log_idx++;
-                cnt++;
-            } else {
-                break;
-            }
+        // Terms of the overlapped logs are read at once.
+        uint64_t overlap_end =
+            std::min(log_tail_->next_slot(), log_idx + req.log_entries().size());
+        std::vector<uint64_t> my_terms;
+        if (log_idx < overlap_end) {
+            cached_terms_in_range(log_idx, overlap_end, my_terms);
+        }
+        while (cnt < my_terms.size()
+               && my_terms[cnt] == req.log_entries().at(cnt)->get_term()) {
+            log_idx++;
+            cnt++;
         }
         p_db("[after SKIP] log_idx: %" PRIu64 ", count: %zu", log_idx, cnt);
 
@@ -753,7 +924,7 @@ std::shared_ptr<resp_msg> raft_server::handle_append_entries(req_msg& req) {
         //      and MUST BE in backward direction.
         //   2) Should do rollback ONLY WHEN we have at least one log
         //      to overwrite.
-        uint64_t my_last_log_idx = log_store_->next_slot() - 1;
+        uint64_t my_last_log_idx = log_tail_->next_slot() - 1;
         bool rollback_in_progress = false;
         if (my_last_log_idx >= log_idx && cnt < req.log_entries().size()) {
             p_in("rollback logs: %" PRIu64 " - %" PRIu64 ", commit idx req %" PRIu64
@@ -784,9 +955,18 @@ std::shared_ptr<resp_msg> raft_server::handle_append_entries(req_msg& req) {
                 sm_commit_index_ = log_idx - 1;
             }
 
-            for (uint64_t ii = 0; ii < my_last_log_idx - log_idx + 1; ++ii) {
+            // Logs to roll back are read at once.
+            uint64_t num_rollback = my_last_log_idx - log_idx + 1;
+            std::shared_ptr<std::vector<std::shared_ptr<log_entry>>> old_entries =
+                cached_log_entries(log_idx, my_last_log_idx + 1);
+            if (old_entries && old_entries->size() != num_rollback) {
+                old_entries.reset();
+            }
+
+            for (uint64_t ii = 0; ii < num_rollback; ++ii) {
                 uint64_t idx = my_last_log_idx - ii;
-                std::shared_ptr<log_entry> old_entry = log_store_->entry_at(idx);
+                std::shared_ptr<log_entry> old_entry =
+                    old_entries ? old_entries->at(idx - log_idx) : cached_entry_at(idx);
                 if (old_entry->get_val_type() == log_val_type::app_log) {
                     std::shared_ptr<buffer> buf = old_entry->get_buf_ptr();
                     buf->pos(0);
@@ -804,7 +984,7 @@ std::shared_ptr<resp_msg> raft_server::handle_append_entries(req_msg& req) {
         }
 
         // Dealing with overwrites (logs with different term).
-        while (log_idx < log_store_->next_slot() && cnt < req.log_entries().size()) {
+        while (log_idx < log_tail_->next_slot() && cnt < req.log_entries().size()) {
             std::shared_ptr<log_entry> entry = req.log_entries().at(cnt);
             p_in("overwrite at %" PRIu64 ", term %" PRIu64 ", timestamp %" PRIu64 "\n",
                  log_idx,
@@ -832,14 +1012,17 @@ std::shared_ptr<resp_msg> raft_server::handle_append_entries(req_msg& req) {
 
         if (rollback_in_progress) {
             p_in("last log index after rollback and overwrite: %" PRIu64,
-                 log_store_->next_slot() - 1);
+                 log_tail_->next_slot() - 1);
+            // Deferred responses may refer to the logs that have been
+            // overwritten, they should not be accepted.
+            flush_pending_append_resps(true);
         }
 
         // Append new log entries
         while (cnt < req.log_entries().size()) {
             std::shared_ptr<log_entry> entry = req.log_entries().at(cnt++);
             p_tr("append at %" PRIu64 ", term %" PRIu64 ", timestamp %" PRIu64 "\n",
-                 log_store_->next_slot(),
+                 log_tail_->next_slot(),
                  entry->get_term(),
                  entry->get_timestamp());
             uint64_t idx_for_entry = store_log_entry(entry);
@@ -864,19 +1047,13 @@ std::shared_ptr<resp_msg> raft_server::handle_append_entries(req_msg& req) {
         std::shared_ptr<raft_params> params = ctx_->get_params();
         if (params->parallel_log_appending_) {
             uint64_t last_durable_index = log_store_->last_durable_index();
-            while (last_durable_index
-                   < req.get_last_log_idx() + req.log_entries().size()) {
-                // Some logs are not durable yet, wait here and block the thread.
-                p_tr("durable index %" PRIu64
-                     ", sleep and wait for log appending completion",
-                     last_durable_index);
-                ea_follower_log_append_->wait_ms(params->heart_beat_interval_);
-
-                // --- `notify_log_append_completion` API will wake it up. ---
-
-                ea_follower_log_append_->reset();
-                last_durable_index = log_store_->last_durable_index();
-                p_tr("wake up, durable index %" PRIu64, last_durable_index);
+            if (last_durable_index
+                < req.get_last_log_idx() + req.log_entries().size()) {
+                // Some logs are not durable yet. Instead of blocking the thread,
+                // the response will be sent later by
+                // `notify_log_append_completion`.
+                p_tr("durable index %" PRIu64 ", defer the response", last_durable_index);
+                defer_resp = true;
             }
         }
     }
@@ -922,14 +1099,32 @@ std::shared_ptr<resp_msg> raft_server::handle_append_entries(req_msg& req) {
     //   always compare the target index with current precommit index, and take
     //   it only when it is greater than the previous one.
     bool pc_updated = try_update_precommit_index(target_precommit_index);
+    uint64_t commit_idx = 0;
     if (!pc_updated) {
         // If updating `precommit_index_` failed, we SHOULD NOT update
         // commit index as well.
     } else {
-        commit(std::min(req.get_commit_idx(), target_precommit_index));
+        commit_idx = std::min(req.get_commit_idx(), target_precommit_index);
+        if (ctx_->get_params()->parallel_log_appending_) {
+            // Logs that are not durable yet should not be applied to
+            // the state machine. The rest will be committed by
+            // `flush_pending_append_resps` once they become durable.
+            commit(std::min(commit_idx, log_store_->last_durable_index()));
+        } else {
+            commit(commit_idx);
+        }
     }
 
-    resp->accept(target_precommit_index + 1);
+    if (defer_resp) {
+        defer_append_entries_resp(resp, target_precommit_index, commit_idx);
+    } else {
+        if (!pending_append_resps_.empty()) {
+            // Logs of the previous requests may not be durable yet.
+            pending_append_resp& last = pending_append_resps_.back();
+            last.commit_idx_ = std::max(last.commit_idx_, commit_idx);
+        }
+        resp->accept(target_precommit_index + 1);
+    }
 
     auto time_ms = tt.get_us() / 1000;
     if (time_ms >= ctx_->get_params()->heart_beat_interval_) {
@@ -1024,14 +1219,28 @@ void raft_server::handle_append_entries_resp(resp_msg& resp) {
     p_tr("peer %d batch size hint: %" PRId64 " bytes", p->get_id(), bs_hint);
     p->set_next_batch_size_hint_in_bytes(bs_hint);
 
+    bool pipelining = ctx_->get_params()->append_pipelining_enabled();
     if (resp.get_accepted()) {
         uint64_t prev_matched_idx = 0;
         uint64_t new_matched_idx = 0;
         {
             std::lock_guard<std::mutex> l(p->get_lock());
-            p->set_next_log_idx(resp.get_next_idx());
             prev_matched_idx = p->get_matched_idx();
             new_matched_idx = resp.get_next_idx() - 1;
+            if (pipelining) {
+                // The following requests may be in flight already,
+                // log indexes should not go backward.
+                uint64_t start_idx = 0;
+                bool stale = false;
+                if (p->pop_inflight_append(start_idx, stale) && !stale) {
+                    p->set_pipeline_ready(true);
+                }
+                p->set_next_log_idx(
+                    std::max(p->get_next_log_idx(), resp.get_next_idx()));
+                new_matched_idx = std::max(prev_matched_idx, new_matched_idx);
+            } else {
+                p->set_next_log_idx(resp.get_next_idx());
+            }
             p_tr("peer %d, prev matched idx: %" PRIu64 ", new matched idx: %" PRIu64,
                  p->get_id(),
                  prev_matched_idx,
@@ -1039,6 +1248,7 @@ void raft_server::handle_append_entries_resp(resp_msg& resp) {
             p->set_matched_idx(new_matched_idx);
             p->set_last_accepted_log_idx(new_matched_idx);
         }
+        update_voter_matched_idx(p);
         cb_func::Param param(id_, leader_, p->get_id());
         param.ctx = &new_matched_idx;
         CbReturnCode rc =
@@ -1048,12 +1258,31 @@ void raft_server::handle_append_entries_resp(resp_msg& resp) {
         // Try to commit with this response.
         uint64_t committed_index = get_expected_committed_log_idx();
         commit(committed_index);
+        // In pipelined mode, logs up to the next log index are in flight.
+        uint64_t p_next_idx = pipelining ? p->get_next_log_idx() : resp.get_next_idx();
         need_to_catchup =
-            p->clear_pending_commit() || resp.get_next_idx() < log_store_->next_slot();
+            p->clear_pending_commit() || p_next_idx < log_tail_->next_slot();
 
     } else {
         auto guard = auto_lock(p->get_lock());
         uint64_t prev_next_log = p->get_next_log_idx();
+        uint64_t start_idx = 0;
+        bool stale = false;
+        if (pipelining && p->pop_inflight_append(start_idx, stale)) {
+            if (stale) {
+                // Log index has been already adjusted by the previous rejection.
+                p_tr("ignore rejection of stale request to peer %d, "
+                     "start idx %" PRIu64 ", resp next %" PRIu64,
+                     p->get_id(),
+                     start_idx,
+                     resp.get_next_idx());
+                return;
+            }
+            // Rewind from the rejected request, not from the latest one.
+            p->invalidate_inflight_appends();
+            prev_next_log = start_idx;
+            p->set_next_log_idx(start_idx);
+        }
         if (resp.get_next_idx() > 0 && prev_next_log > resp.get_next_idx()) {
             // fast move for the peer to catch up
             p->set_next_log_idx(resp.get_next_idx());
@@ -1066,6 +1295,26 @@ void raft_server::handle_append_entries_resp(resp_msg& resp) {
                     do_log_rewind = false;
                 }
 
+                if (appendix->conflict_term_ && prev_next_log) {
+                    // Skip all logs of the conflicting term: to the next of
+                    // our last log of the term, or to the first log of the term
+                    // in the peer's log if we don't have it.
+                    uint64_t last_idx =
+                        last_log_idx_of_term(appendix->conflict_term_, prev_next_log - 1);
+                    uint64_t new_next_log =
+                        last_idx ? last_idx + 1 : appendix->conflict_term_first_idx_;
+                    if (new_next_log && new_next_log < prev_next_log) {
+                        p->set_next_log_idx(new_next_log);
+                        do_log_rewind = false;
+                    }
+                    p_db("conflict term %" PRIu64 " (first log idx %" PRIu64 ") "
+                         "from peer %d, my last log idx of the term %" PRIu64,
+                         appendix->conflict_term_,
+                         appendix->conflict_term_first_idx_,
+                         p->get_id(),
+                         last_idx);
+                }
+
                 static auto extra_order_timer = timer_helper{1000 * 1000, true};
                 int log_lv = extra_order_timer.timeout_and_reset() ? L_INFO : L_TRACE;
                 p_lv(log_lv,
@@ -1103,7 +1352,7 @@ void raft_server::handle_append_entries_resp(resp_msg& resp) {
     //   re-election timer in heartbeat handler, and do force resign.
     uint64_t p_matched_idx = p->get_matched_idx();
     if (write_paused_ && p->get_id() == next_leader_candidate_ && p_matched_idx
-        && p_matched_idx == log_store_->next_slot() - 1 && p->make_busy()) {
+        && p_matched_idx == log_tail_->next_slot() - 1 && p->make_busy()) {
         // NOTE:
         //   If `make_busy` fails (very unlikely to happen), next
         //   response handler (of heartbeat, append_entries ..) will
@@ -1134,8 +1383,8 @@ void raft_server::handle_append_entries_resp(resp_msg& resp) {
                                       msg_type::custom_notification_request,
                                       id_,
                                       p->get_id(),
-                                      term_for_log(log_store_->next_slot() - 1),
-                                      log_store_->next_slot() - 1,
+                                      term_for_log(log_tail_->next_slot() - 1),
+                                      log_tail_->next_slot() - 1,
                                       quick_commit_index_.load());
 
         // Create a notification.
@@ -1188,33 +1437,69 @@ uint64_t raft_server::get_current_leader_index() {
     return leader_index;
 }
 
-uint64_t raft_server::get_expected_committed_log_idx() {
-    std::vector<uint64_t> matched_indexes;
-    state_machine::adjust_commit_index_params aci_params;
-    matched_indexes.reserve(16);
-    aci_params.peer_index_map_.reserve(16);
-
-    // Put the index of leader itself.
-    uint64_t leader_index = get_current_leader_index();
-    matched_indexes.push_back(leader_index);
-    aci_params.peer_index_map_[id_] = leader_index;
+void raft_server::invalidate_voter_matched_idxs() {
+    voter_matched_dirty_ = true;
+}
 
+void raft_server::rebuild_voter_matched_idxs() {
+    voter_matched_idxs_.clear();
+    voter_matched_map_.clear();
     for (auto& entry: peers_) {
         std::shared_ptr<peer>& p = entry.second;
-        aci_params.peer_index_map_[p->get_id()] = p->get_matched_idx();
-
         if (!is_regular_member(p)) continue;
-        matched_indexes.push_back(p->get_matched_idx());
+        voter_matched_map_[p->get_id()] = p->get_matched_idx();
+        voter_matched_idxs_.push_back(p->get_matched_idx());
     }
-    int voting_members = get_num_voting_members();
-    assert((int32_t)matched_indexes.size() == voting_members);
-
     // NOTE: Descending order.
-    //       e.g.) 100 100 99 95 92
-    //             => commit on 99 if `quorum_idx == 2`.
-    std::sort(matched_indexes.begin(), matched_indexes.end(), std::greater<uint64_t>());
+    std::sort(voter_matched_idxs_.begin(),
+              voter_matched_idxs_.end(),
+              std::greater<uint64_t>());
+    voter_matched_dirty_ = false;
+}
+
+void raft_server::update_voter_matched_idx(const std::shared_ptr<peer>& p) {
+    // Will be rebuilt anyway.
+    if (voter_matched_dirty_) return;
+
+    auto entry = voter_matched_map_.find(p->get_id());
+    // Not a voting member.
+    if (entry == voter_matched_map_.end()) return;
+
+    uint64_t prev_idx = entry->second;
+    uint64_t new_idx = p->get_matched_idx();
+    if (prev_idx == new_idx) return;
+
+    auto itr = std::lower_bound(voter_matched_idxs_.begin(),
+                                voter_matched_idxs_.end(),
+                                prev_idx,
+                                std::greater<uint64_t>());
+    if (itr == voter_matched_idxs_.end() || *itr != prev_idx) {
+        // Should not happen.
+        p_wn("matched idx %" PRIu64 " of peer %d is not found, rebuild",
+             prev_idx,
+             p->get_id());
+        voter_matched_dirty_ = true;
+        return;
+    }
+    voter_matched_idxs_.erase(itr);
+    voter_matched_idxs_.insert(std::lower_bound(voter_matched_idxs_.begin(),
+                                                voter_matched_idxs_.end(),
+                                                new_idx,
+                                                std::greater<uint64_t>()),
+                               new_idx);
+    entry->second = new_idx;
+}
+
+uint64_t raft_server::get_expected_committed_log_idx() {
+    if (voter_matched_dirty_) {
+        rebuild_voter_matched_idxs();
+    }
 
-    size_t quorum_idx = get_quorum_for_commit();
+    // Index of leader itself.
+    uint64_t leader_index = get_current_leader_index();
+
+    int voting_members = voter_matched_idxs_.size() + 1;
+    size_t quorum_idx = get_quorum_for_commit(voting_members);
     if (ctx_->get_params()->use_full_consensus_among_healthy_members_) {
         size_t not_responding_peers = get_not_responding_peers();
         if (not_responding_peers < voting_members - quorum_idx) {
@@ -1238,16 +1523,43 @@ uint64_t raft_server::get_expected_committed_log_idx() {
         }
     }
 
+    // `quorum_idx`-th largest one among the leader's index and
+    // `voter_matched_idxs_` (descending order).
+    //   e.g.) 100 100 99 95 92
+    //         => commit on 99 if `quorum_idx == 2`.
+    uint64_t expected_idx = leader_index;
+    if (quorum_idx > 0) {
+        expected_idx = std::min(leader_index, voter_matched_idxs_[quorum_idx - 1]);
+    }
+    if (quorum_idx < voter_matched_idxs_.size()) {
+        expected_idx = std::max(expected_idx, voter_matched_idxs_[quorum_idx]);
+    }
+
     if (l_ && l_->get_level() >= 6) {
         std::string tmp_str;
-        for (uint64_t m_idx: matched_indexes) {
+        for (uint64_t m_idx: voter_matched_idxs_) {
             tmp_str += std::to_string(m_idx) + " ";
         }
-        p_tr("quorum idx %zu, %s", quorum_idx, tmp_str.c_str());
+        p_tr("quorum idx %zu, leader %" PRIu64 ", peers %s",
+             quorum_idx,
+             leader_index,
+             tmp_str.c_str());
+    }
+
+    if (!state_machine_->uses_adjust_commit_index()) {
+        return expected_idx;
+    }
+
+    state_machine::adjust_commit_index_params aci_params;
+    aci_params.peer_index_map_.reserve(peers_.size() + 1);
+    aci_params.peer_index_map_[id_] = leader_index;
+    for (auto& entry: peers_) {
+        std::shared_ptr<peer>& p = entry.second;
+        aci_params.peer_index_map_[p->get_id()] = p->get_matched_idx();
     }
 
     aci_params.current_commit_index_ = quick_commit_index_;
-    aci_params.expected_commit_index_ = matched_indexes[quorum_idx];
+    aci_params.expected_commit_index_ = expected_idx;
     uint64_t adjusted_commit_index = state_machine_->adjust_commit_index(aci_params);
     if (aci_params.expected_commit_index_ != adjusted_commit_index) {
         p_tr("commit index adjusted: %" PRIu64 " -> %" PRIu64,
@@ -1293,9 +1605,207 @@ void raft_server::notify_log_append_completion(bool ok) {
             return;
         }
 
-        // Follower: wake up the waiting thread.
-        ea_follower_log_append_->invoke();
+        // Follower: send the responses whose logs have become durable.
+        auto guard = recur_lock(lock_);
+        flush_pending_append_resps(false);
+    }
+}
+
+void raft_server::defer_append_entries_resp(std::shared_ptr<resp_msg>& resp,
+                                            uint64_t target_idx,
+                                            uint64_t commit_idx) {
+    pending_append_resp elem;
+    elem.term_ = state_->get_term();
+    elem.target_idx_ = target_idx;
+    elem.commit_idx_ = commit_idx;
+    elem.deferred_at_us_ = timer_helper::get_timeofday_us();
+    elem.resp_ = resp;
+    elem.result_ = std::make_shared<cmd_result<std::shared_ptr<buffer>>>();
+
+    // RPC layer will send the response once the result is set.
+    std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> result = elem.result_;
+    resp->set_async_cb([result]() { return result; });
+    pending_append_resps_.push_back(elem);
+}
+
+void raft_server::flush_pending_append_resps(bool abandon) {
+    if (pending_append_resps_.empty()) return;
+
+    uint64_t last_durable_index = log_store_->last_durable_index();
+    uint64_t cur_term = state_->get_term();
+    auto entry = pending_append_resps_.begin();
+    while (entry != pending_append_resps_.end()) {
+        pending_append_resp& elem = *entry;
+        bool stale = abandon || elem.term_ != cur_term;
+        if (!stale) {
+            // Commit the durable part of the logs of this request.
+            commit(std::min(elem.commit_idx_, last_durable_index));
+        }
+        if (!stale && elem.target_idx_ > last_durable_index) {
+            // Not durable yet.
+            ++entry;
+            continue;
+        }
+
+        if (stale) {
+            // Send it without accepting, leader will retry
+            // from the next of the last durable log.
+            uint64_t next_idx =
+                std::min(last_durable_index, log_tail_->next_slot() - 1) + 1;
+            p_in("abandon deferred response, term %" PRIu64 ", target idx %" PRIu64
+                 ", next idx %" PRIu64,
+                 elem.term_,
+                 elem.target_idx_,
+                 next_idx);
+            elem.resp_->set_next_idx(next_idx);
+        } else {
+            p_tr("durable index %" PRIu64 ", send deferred response, "
+                 "target idx %" PRIu64,
+                 last_durable_index,
+                 elem.target_idx_);
+            elem.resp_->accept(elem.target_idx_ + 1);
+        }
+        std::shared_ptr<buffer> ctx = elem.resp_->get_ctx();
+        std::shared_ptr<std::exception> err;
+        elem.result_->set_result(ctx, err);
+        entry = pending_append_resps_.erase(entry);
+    }
+}
+
+bool raft_server::park_append_entries_req(req_msg& req,
+                                          std::shared_ptr<resp_msg>& resp) {
+    std::shared_ptr<raft_params> params = ctx_->get_params();
+    if (params->data_connections_per_peer_ <= 1) return false;
+
+    // No more requests than the leader can send at once.
+    size_t max_parked = std::max(params->max_append_reqs_in_flight_,
+                                 params->data_connections_per_peer_);
+    uint64_t max_gap = max_parked * std::max(params->max_append_size_, 1);
+    uint64_t gap = req.get_last_log_idx() - (log_tail_->next_slot() - 1);
+    if (gap > max_gap) {
+        // Too far, not a request overtaking the others.
+        return false;
+    }
+
+    auto existing = parked_append_reqs_.find(req.get_last_log_idx());
+    if (existing != parked_append_reqs_.end()) {
+        // Re-sent by leader, the previous one is not needed anymore.
+        parked_append_req old_elem = existing->second;
+        parked_append_reqs_.erase(existing);
+        finish_parked_append_req(old_elem, nullptr);
+    }
+
+    if (parked_append_reqs_.size() >= max_parked) {
+        p_wn("too many parked append_entries requests: %zu, "
+             "req log idx %" PRIu64 ", my last log idx %" PRIu64,
+             parked_append_reqs_.size(),
+             req.get_last_log_idx(),
+             log_tail_->next_slot() - 1);
+        return false;
+    }
+
+    // `req` is owned by the caller, make a copy.
+    parked_append_req elem;
+    elem.req_ = std::make_shared<req_msg>(req.get_term(),
+                                          req.get_type(),
+                                          req.get_src(),
+                                          req.get_dst(),
+                                          req.get_last_log_term(),
+                                          req.get_last_log_idx(),
+                                          req.get_commit_idx());
+    elem.req_->log_entries() = req.log_entries();
+    elem.resp_ = resp;
+    elem.result_ = std::make_shared<cmd_result<std::shared_ptr<buffer>>>();
+    elem.parked_at_us_ = timer_helper::get_timeofday_us();
+
+    // RPC layer will send the response once the result is set.
+    std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> result = elem.result_;
+    resp->set_async_cb([result]() { return result; });
+
+    p_tr("park append_entries request, req log idx %" PRIu64 ", "
+         "my last log idx %" PRIu64,
+         req.get_last_log_idx(),
+         log_tail_->next_slot() - 1);
+    parked_append_reqs_.insert(std::make_pair(req.get_last_log_idx(), elem));
+    return true;
+}
+
+void raft_server::process_parked_append_reqs(bool abandon) {
+    if (parked_append_reqs_.empty()) return;
+
+    uint64_t now_us = timer_helper::get_timeofday_us();
+    uint64_t expiry_us =
+        (uint64_t)ctx_->get_params()->election_timeout_lower_bound_ * 1000;
+    auto entry = parked_append_reqs_.begin();
+    while (entry != parked_append_reqs_.end()) {
+        parked_append_req& elem = entry->second;
+        bool stale = abandon || stopping_ || receiving_snapshot_
+                     || role_ != srv_role::follower
+                     || elem.req_->get_term() != state_->get_term();
+        if (!stale && entry->first >= log_tail_->next_slot()) {
+            if (now_us - elem.parked_at_us_ < expiry_us) {
+                // Preceding requests have not arrived yet.
+                ++entry;
+                continue;
+            }
+            p_wn("parked append_entries request expired, "
+                 "req log idx %" PRIu64 ", my last log idx %" PRIu64,
+                 entry->first,
+                 log_tail_->next_slot() - 1);
+            stale = true;
+        }
+
+        parked_append_req cur = elem;
+        parked_append_reqs_.erase(entry);
+        if (stale) {
+            // Send it without accepting, leader will retry.
+            finish_parked_append_req(cur, nullptr);
+        } else {
+            finish_parked_append_req(cur, handle_append_entries(*cur.req_));
+        }
+        // Last log index has been changed, start over.
+        entry = parked_append_reqs_.begin();
+    }
+}
+
+void raft_server::finish_parked_append_req(parked_append_req& elem,
+                                           std::shared_ptr<resp_msg> resp) {
+    std::shared_ptr<resp_msg> parked_resp = elem.resp_;
+    std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> result = elem.result_;
+    std::shared_ptr<std::exception> err;
+    if (!resp) {
+        std::shared_ptr<buffer> no_ctx;
+        result->set_result(no_ctx, err);
+        return;
+    }
+
+    if (resp->has_async_cb()) {
+        // Deferred until the logs become durable.
+        std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> deferred =
+            resp->call_async_cb();
+        deferred->when_ready(
+            [parked_resp, resp, result](
+                cmd_result<std::shared_ptr<buffer>, std::shared_ptr<std::exception>>& res,
+                std::shared_ptr<std::exception>& exp) {
+                if (resp->get_accepted()) parked_resp->accept(resp->get_next_idx());
+                parked_resp->set_next_batch_size_hint_in_bytes(
+                    resp->get_next_batch_size_hint_in_bytes());
+                std::shared_ptr<buffer> ctx = res.get();
+                result->set_result(ctx, exp);
+                // This is needed to avoid circular reference.
+                res.reset();
+            });
+        return;
+    }
+
+    if (resp->has_cb()) {
+        resp = resp->call_cb(resp);
     }
+    if (resp->get_accepted()) parked_resp->accept(resp->get_next_idx());
+    parked_resp->set_next_batch_size_hint_in_bytes(
+        resp->get_next_batch_size_hint_in_bytes());
+    std::shared_ptr<buffer> ctx = resp->get_ctx();
+    result->set_result(ctx, err);
 }
 
 } // namespace nuraft
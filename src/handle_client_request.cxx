@@ -20,15 +20,18 @@ limitations under the License.
 
 #include "handle_client_request.hxx"
 
+#include "buffer_serializer.hxx"
 #include "cluster_config.hxx"
 #include "context.hxx"
 #include "debugging_options.hxx"
 #include "error_code.hxx"
 #include "global_mgr.hxx"
+#include "log_tail_cache.hxx"
 #include "state_machine.hxx"
 #include "state_mgr.hxx"
 #include "tracer.hxx"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <sstream>
@@ -37,29 +40,105 @@ namespace nuraft {
 
 std::shared_ptr<resp_msg>
 raft_server::handle_cli_req_prelock(req_msg& req, const req_ext_params& ext_params) {
-    std::shared_ptr<resp_msg> resp = nullptr;
     std::shared_ptr<raft_params> params = ctx_->get_params();
     uint64_t timestamp_us = timer_helper::get_timeofday_us();
 
+    cli_req_elem elem(req, ext_params, timestamp_us);
+    if (params->group_commit_window_us_ > 0) {
+        if (!handle_cli_req_group(elem)) {
+            // Handled by another thread, it also requested replication.
+            return elem.resp_;
+        }
+    } else {
+        std::vector<cli_req_elem*> elems(1, &elem);
+        handle_cli_reqs_prelock(elems);
+    }
+
+    // Urgent commit, so that the commit will not depend on hb.
+    request_append_entries_for_all();
+
+    return elem.resp_;
+}
+
+void raft_server::handle_cli_reqs_prelock(std::vector<cli_req_elem*>& elems) {
+    std::shared_ptr<raft_params> params = ctx_->get_params();
     switch (params->locking_method_type_) {
     case raft_params::single_mutex: {
         auto guard = recur_lock(lock_);
-        resp = handle_cli_req(req, ext_params, timestamp_us);
+        handle_cli_reqs(elems);
         break;
     }
     case raft_params::dual_mutex:
     default: {
         // TODO: Use RW lock here.
         auto guard = auto_lock(cli_lock_);
-        resp = handle_cli_req(req, ext_params, timestamp_us);
+        handle_cli_reqs(elems);
         break;
     }
     }
+}
 
-    // Urgent commit, so that the commit will not depend on hb.
-    request_append_entries_for_all();
+bool raft_server::handle_cli_req_group(cli_req_elem& elem) {
+    std::shared_ptr<raft_params> params = ctx_->get_params();
+    size_t max_bytes = std::max(params->group_commit_max_bytes_, (int64_t)0);
 
-    return resp;
+    std::vector<cli_req_elem*> elems;
+    {
+        std::unique_lock<std::mutex> l(group_commit_lock_);
+        group_commit_queue_.push_back(&elem);
+        group_commit_bytes_ += elem.bytes_;
+        group_commit_callers_++;
+
+        if (group_commit_active_) {
+            // Other thread is gathering requests, it will handle this one.
+            group_commit_cv_.notify_all();
+            l.unlock();
+            elem.done_.wait();
+
+            l.lock();
+            group_commit_callers_--;
+            group_commit_cv_.notify_all();
+            l.unlock();
+            if (elem.error_) std::rethrow_exception(elem.error_);
+            return false;
+        }
+
+        // This thread handles the group: wait for other requests to join,
+        // but not longer than all the requests being handled join.
+        // A lone request does not wait at all.
+        group_commit_active_ = true;
+        group_commit_cv_.wait_for(
+            l, std::chrono::microseconds(params->group_commit_window_us_), [&]() {
+                return (max_bytes && group_commit_bytes_ >= max_bytes)
+                       || group_commit_callers_ == group_commit_queue_.size();
+            });
+        elems.swap(group_commit_queue_);
+        group_commit_bytes_ = 0;
+        // The next request will start a new group.
+        group_commit_active_ = false;
+    }
+
+    p_tr("group commit: %zu requests", elems.size());
+    std::exception_ptr error;
+    try {
+        handle_cli_reqs_prelock(elems);
+    } catch (...) {
+        // Other threads should not wait forever, pass the error to them.
+        error = std::current_exception();
+    }
+    for (cli_req_elem* ee: elems) {
+        if (ee == &elem) continue;
+        ee->error_ = error;
+        ee->done_.invoke();
+    }
+
+    {
+        std::lock_guard<std::mutex> l(group_commit_lock_);
+        group_commit_callers_--;
+        group_commit_cv_.notify_all();
+    }
+    if (error) std::rethrow_exception(error);
+    return true;
 }
 
 void raft_server::request_append_entries_for_all() {
@@ -84,65 +163,82 @@ void raft_server::request_append_entries_for_all() {
 std::shared_ptr<resp_msg> raft_server::handle_cli_req(req_msg& req,
                                                       const req_ext_params& ext_params,
                                                       uint64_t timestamp_us) {
-    std::shared_ptr<resp_msg> resp = nullptr;
+    cli_req_elem elem(req, ext_params, timestamp_us);
+    std::vector<cli_req_elem*> elems(1, &elem);
+    handle_cli_reqs(elems);
+    return elem.resp_;
+}
+
+void raft_server::handle_cli_reqs(std::vector<cli_req_elem*>& elems) {
     uint64_t last_idx = 0;
-    std::shared_ptr<buffer> ret_value = nullptr;
+    size_t num_entries = 0;
     uint64_t resp_idx = 1;
     uint64_t cur_term = state_->get_term();
-    std::shared_ptr<raft_params> params = ctx_->get_params();
 
-    resp = std::make_shared<resp_msg>(
-        cur_term, msg_type::append_entries_response, id_, leader_);
-    if (role_ != srv_role::leader || write_paused_) {
-        resp->set_result_code(cmd_result_code::NOT_LEADER);
-        return resp;
-    }
+    for (cli_req_elem* elem: elems) {
+        std::shared_ptr<resp_msg>& resp = elem->resp_;
+        const req_ext_params& ext_params = elem->ext_params_;
+        resp = std::make_shared<resp_msg>(
+            cur_term, msg_type::append_entries_response, id_, leader_);
+        if (role_ != srv_role::leader || write_paused_) {
+            resp->set_result_code(cmd_result_code::NOT_LEADER);
+            elem->rejected_ = true;
+            continue;
+        }
 
-    if (ext_params.expected_term_) {
-        // If expected term is given, check the current term.
-        if (ext_params.expected_term_ != cur_term) {
-            resp->set_result_code(cmd_result_code::TERM_MISMATCH);
-            return resp;
+        if (ext_params.expected_term_) {
+            // If expected term is given, check the current term.
+            if (ext_params.expected_term_ != cur_term) {
+                resp->set_result_code(cmd_result_code::TERM_MISMATCH);
+                elem->rejected_ = true;
+                continue;
+            }
         }
-    }
 
-    std::vector<std::shared_ptr<log_entry>>& entries = req.log_entries();
-    size_t num_entries = entries.size();
-
-    for (size_t i = 0; i < num_entries; ++i) {
-        // force the log's term to current term
-        entries.at(i)->set_term(cur_term);
-        entries.at(i)->set_timestamp(timestamp_us);
-
-        uint64_t next_slot = store_log_entry(entries.at(i));
-        p_db(
-            "append at log_idx %" PRIu64 ", timestamp %" PRIu64, next_slot, timestamp_us);
-        last_idx = next_slot;
-
-        std::shared_ptr<buffer> buf = entries.at(i)->get_buf_ptr();
-        buf->pos(0);
-        ret_value =
-            state_machine_->pre_commit_ext(state_machine::ext_op_params(last_idx, buf));
-
-        if (ext_params.after_precommit_) {
-            req_ext_cb_params cb_params;
-            cb_params.log_idx = last_idx;
-            cb_params.log_term = cur_term;
-            cb_params.context = ext_params.context_;
-            ext_params.after_precommit_(cb_params);
+        std::vector<std::shared_ptr<log_entry>>& entries = elem->req_.log_entries();
+        for (size_t i = 0; i < entries.size(); ++i) {
+            // force the log's term to current term
+            entries.at(i)->set_term(cur_term);
+            entries.at(i)->set_timestamp(elem->timestamp_us_);
+
+            uint64_t next_slot = store_log_entry(entries.at(i));
+            p_db("append at log_idx %" PRIu64 ", timestamp %" PRIu64,
+                 next_slot,
+                 elem->timestamp_us_);
+            last_idx = next_slot;
+            elem->last_idx_ = next_slot;
+
+            std::shared_ptr<buffer> buf = entries.at(i)->get_buf_ptr();
+            buf->pos(0);
+            elem->ret_value_ = state_machine_->pre_commit_ext(
+                state_machine::ext_op_params(last_idx, buf));
+
+            if (ext_params.after_precommit_) {
+                req_ext_cb_params cb_params;
+                cb_params.log_idx = last_idx;
+                cb_params.log_term = cur_term;
+                cb_params.context = ext_params.context_;
+                ext_params.after_precommit_(cb_params);
+            }
         }
+        num_entries += entries.size();
     }
     if (num_entries) {
         log_store_->end_of_append_batch(last_idx - num_entries, num_entries);
     }
     try_update_precommit_index(last_idx);
-    resp_idx = log_store_->next_slot();
+    resp_idx = log_tail_->next_slot();
 
     // Finished appending logs and pre_commit of itself.
     cb_func::Param param(id_, leader_);
     param.ctx = &last_idx;
     CbReturnCode rc = ctx_->cb_func_.call(cb_func::AppendLogs, &param);
-    if (rc == CbReturnCode::ReturnNull) return nullptr;
+    if (rc == CbReturnCode::ReturnNull) {
+        for (cli_req_elem* elem: elems) {
+            if (!elem->rejected_) elem->resp_.reset();
+        }
+        return;
+    }
 
     size_t sleep_us = debugging_options::get_instance().handle_cli_req_sleep_us_.load(
         std::memory_order_relaxed);
@@ -151,22 +247,23 @@ std::shared_ptr<resp_msg> raft_server::handle_cli_req(req_msg& req,
         timer_helper::sleep_us(sleep_us);
     }
 
-    if (!get_config()->is_async_replication()) {
-        // Sync replication:
-        //   Set callback function for `last_idx`.
-        std::shared_ptr<commit_ret_elem> elem = std::make_shared<commit_ret_elem>();
-        elem->idx_ = last_idx;
-        elem->result_code_ = cmd_result_code::TIMEOUT;
-
-        {
-            auto guard = auto_lock(commit_ret_elems_lock_);
-            auto entry = commit_ret_elems_.find(last_idx);
-            if (entry != commit_ret_elems_.end()) {
+    bool async_replication = get_config()->is_async_replication();
+    for (cli_req_elem* elem: elems) {
+        if (elem->rejected_) continue;
+
+        std::shared_ptr<resp_msg>& resp = elem->resp_;
+        if (!async_replication) {
+            // Sync replication:
+            //   Set callback function for `last_idx`.
+            commit_ret_table::accessor acc(*commit_ret_elems_, elem->last_idx_);
+            std::shared_ptr<commit_ret_elem> cre = acc.find();
+            if (cre) {
                 // Commit thread was faster than this.
-                elem = entry->second;
-                p_tr("commit thread was faster than this thread: %p", (void*)elem.get());
+                p_tr("commit thread was faster than this thread: %p", (void*)cre.get());
             } else {
-                commit_ret_elems_.insert(std::make_pair(last_idx, elem));
+                cre = acc.create();
+                cre->result_code_ = cmd_result_code::TIMEOUT;
+                acc.insert(cre);
             }
 
             switch (ctx_->get_params()->return_method_) {
@@ -175,34 +272,36 @@ std::shared_ptr<resp_msg> raft_server::handle_cli_req(req_msg& req,
                 // Blocking call: set callback function waiting for the result.
                 resp->set_cb(std::bind(&raft_server::handle_cli_req_callback,
                                        this,
-                                       elem,
+                                       cre,
                                        std::placeholders::_1));
                 break;
 
             case raft_params::async_handler:
                 // Async handler: create & set async result object.
-                if (!elem->async_result_) {
-                    elem->async_result_ =
+                if (!cre->async_result_) {
+                    cre->async_result_ =
                         std::make_shared<cmd_result<std::shared_ptr<buffer>>>();
+                } else {
+                    // Already committed, the result is set.
+                    acc.erase();
                 }
                 resp->set_async_cb(std::bind(&raft_server::handle_cli_req_callback_async,
                                              this,
-                                             elem->async_result_));
+                                             cre->async_result_));
                 break;
             }
+
+        } else {
+            // Async replication:
+            //   Immediately return with the result of pre-commit.
+            p_dv("asynchronously replicated %" PRIu64 ", return value %p",
+                 elem->last_idx_,
+                 (void*)elem->ret_value_.get());
+            resp->set_ctx(elem->ret_value_);
         }
 
-    } else {
-        // Async replication:
-        //   Immediately return with the result of pre-commit.
-        p_dv("asynchronously replicated %" PRIu64 ", return value %p",
-             last_idx,
-             (void*)ret_value.get());
-        resp->set_ctx(ret_value);
+        resp->accept(resp_idx);
     }
-
-    resp->accept(resp_idx);
-    return resp;
 }
 
 std::shared_ptr<resp_msg>
@@ -216,22 +315,24 @@ raft_server::handle_cli_req_callback(std::shared_ptr<commit_ret_elem> elem,
     uint64_t idx = 0;
     uint64_t elapsed_us = 0;
     std::shared_ptr<buffer> ret_value = nullptr;
+    cmd_result_code result_code = cmd_result_code::OK;
     {
-        auto guard = auto_lock(commit_ret_elems_lock_);
+        commit_ret_table::accessor acc(*commit_ret_elems_, elem->idx_);
         idx = elem->idx_;
         elapsed_us = elem->timer_.get_us();
         ret_value = elem->ret_value_;
+        result_code = elem->result_code_;
         elem->callback_invoked_ = true;
-        if (elem->result_code_ != cmd_result_code::TIMEOUT) {
-            commit_ret_elems_.erase(elem->idx_);
+        if (result_code != cmd_result_code::TIMEOUT) {
+            acc.erase();
         } else {
             p_dv("Client timeout leave commit thread to remove commit_ret_elem %" PRIu64,
                  idx);
         }
-        p_dv("remaining elems in waiting queue: %zu", commit_ret_elems_.size());
     }
+    p_dv("remaining elems in waiting queue: %zu", commit_ret_elems_->size());
 
-    if (elem->result_code_ == cmd_result_code::OK) {
+    if (result_code == cmd_result_code::OK) {
         p_dv("[OK] commit_ret_cv %" PRIu64 " wake up (%" PRIu64 " us), return value %p",
              idx,
              elapsed_us,
@@ -243,7 +344,7 @@ raft_server::handle_cli_req_callback(std::shared_ptr<commit_ret_elem> elem,
              idx,
              elapsed_us,
              (void*)ret_value.get(),
-             elem->result_code_);
+             result_code);
         bool valid_leader = check_leadership_validity();
         if (valid_leader) {
             p_in("leadership is still valid");
@@ -252,7 +353,7 @@ raft_server::handle_cli_req_callback(std::shared_ptr<commit_ret_elem> elem,
         }
     }
     resp->set_ctx(ret_value);
-    resp->set_result_code(elem->result_code_);
+    resp->set_result_code(result_code);
 
     return resp;
 }
@@ -264,15 +365,233 @@ raft_server::handle_cli_req_callback_async(
     return async_res;
 }
 
+namespace {
+
+/**
+ * Result of each client request in a batch.
+ */
+struct batch_req_result {
+    batch_req_result()
+        : accepted_(false)
+        , code_(cmd_result_code::OK) {}
+
+    bool accepted_;
+    cmd_result_code code_;
+    std::shared_ptr<buffer> ret_value_;
+};
+
+std::shared_ptr<buffer>
+serialize_batch_results(const std::vector<batch_req_result>& results) {
+    //   << Format >>
+    // version                  1 byte
+    // number of requests       4 bytes
+    // { accepted               1 byte
+    //   result code            4 bytes
+    //   return value length    4 bytes
+    //   return value           ...      } * number of requests
+    size_t len = sizeof(uint8_t) + sizeof(uint32_t);
+    for (const batch_req_result& rr: results) {
+        len += sizeof(uint8_t) + sizeof(int32_t) + sizeof(uint32_t);
+        if (rr.ret_value_) len += rr.ret_value_->size();
+    }
+
+    std::shared_ptr<buffer> buf = buffer::alloc(len);
+    buffer_serializer bs(buf);
+    bs.put_u8(0);
+    bs.put_u32(results.size());
+    for (const batch_req_result& rr: results) {
+        bs.put_u8(rr.accepted_ ? 1 : 0);
+        bs.put_i32(rr.code_);
+        if (rr.ret_value_) {
+            rr.ret_value_->pos(0);
+            bs.put_bytes(rr.ret_value_->data_begin(), rr.ret_value_->size());
+        } else {
+            bs.put_bytes(nullptr, 0);
+        }
+    }
+    return buf;
+}
+
+} // namespace
+
+std::shared_ptr<resp_msg> raft_server::handle_cli_batch_req(req_msg& req) {
+    // The first log is the header with the number of logs of each request,
+    // see `auto_fwd_send_batches` for the format.
+    std::vector<std::shared_ptr<log_entry>>& entries = req.log_entries();
+    std::vector<uint32_t> counts;
+    try {
+        if (entries.empty() || entries[0]->get_val_type() != log_val_type::custom) {
+            throw std::runtime_error("header not found");
+        }
+        std::shared_ptr<buffer> header = entries[0]->get_buf_ptr();
+        header->pos(0);
+        buffer_serializer bs(header);
+        bs.get_u8(); // version.
+        size_t num = bs.get_u32();
+        size_t num_logs = 0;
+        for (size_t ii = 0; ii < num; ++ii) {
+            counts.push_back(bs.get_u32());
+            num_logs += counts.back();
+        }
+        if (num_logs != entries.size() - 1) {
+            throw std::runtime_error("number of logs mismatch");
+        }
+    } catch (std::exception& ex) {
+        p_er("invalid batched client request from %d: %s", req.get_src(), ex.what());
+        return nullptr;
+    }
+
+    std::list<req_msg> reqs;
+    auto entry = entries.begin() + 1;
+    for (uint32_t cnt: counts) {
+        reqs.emplace_back(req.get_term(),
+                          msg_type::client_request,
+                          req.get_src(),
+                          req.get_dst(),
+                          0,
+                          0,
+                          0);
+        reqs.back().log_entries().assign(entry, entry + cnt);
+        entry += cnt;
+    }
+    p_tr("batched client request from %d: %zu requests, %zu logs",
+         req.get_src(),
+         reqs.size(),
+         entries.size() - 1);
+
+    // Handle all requests at once, as a group.
+    // Empty requests have nothing to append, they are rejected here.
+    req_ext_params ext_params;
+    uint64_t timestamp_us = timer_helper::get_timeofday_us();
+    std::list<cli_req_elem> elems_holder;
+    std::vector<cli_req_elem*> elems;
+    std::vector<cli_req_elem*> all_elems;
+    for (req_msg& rr: reqs) {
+        if (rr.log_entries().empty()) {
+            all_elems.push_back(nullptr);
+            continue;
+        }
+        elems_holder.emplace_back(rr, ext_params, timestamp_us);
+        elems.push_back(&elems_holder.back());
+        all_elems.push_back(&elems_holder.back());
+    }
+    if (!elems.empty()) {
+        handle_cli_reqs_prelock(elems);
+        request_append_entries_for_all();
+    }
+
+    std::shared_ptr<std::vector<std::shared_ptr<resp_msg>>> resps =
+        std::make_shared<std::vector<std::shared_ptr<resp_msg>>>();
+    bool has_cb = false;
+    bool has_async_cb = false;
+    for (cli_req_elem* elem: all_elems) {
+        if (!elem) {
+            std::shared_ptr<resp_msg> empty_resp = std::make_shared<resp_msg>(
+                state_->get_term(), msg_type::append_entries_response, id_, leader_);
+            empty_resp->set_result_code(cmd_result_code::BAD_REQUEST);
+            resps->push_back(empty_resp);
+            continue;
+        }
+        if (!elem->resp_) return nullptr;
+        has_cb = has_cb || elem->resp_->has_cb();
+        has_async_cb = has_async_cb || elem->resp_->has_async_cb();
+        resps->push_back(elem->resp_);
+    }
+
+    std::shared_ptr<resp_msg> resp = std::make_shared<resp_msg>(
+        state_->get_term(), msg_type::client_batch_response, id_, req.get_src());
+    resp->accept(log_tail_->next_slot());
+
+    auto make_result = [](const std::shared_ptr<resp_msg>& rr) -> batch_req_result {
+        batch_req_result ret;
+        ret.accepted_ = rr->get_accepted();
+        ret.code_ = rr->get_result_code();
+        ret.ret_value_ = rr->get_ctx();
+        return ret;
+    };
+
+    if (has_cb) {
+        // Blocking mode:
+        //   Wait for the result of each request, in the order of log index.
+        resp->set_cb([resps, make_result](std::shared_ptr<resp_msg> b_resp) {
+            std::vector<batch_req_result> results;
+            for (std::shared_ptr<resp_msg>& rr: *resps) {
+                if (rr->has_cb()) rr = rr->call_cb(rr);
+                results.push_back(make_result(rr));
+            }
+            b_resp->set_ctx(serialize_batch_results(results));
+            return b_resp;
+        });
+
+    } else if (has_async_cb) {
+        // Async handler mode:
+        //   Return the results once all requests are committed.
+        struct async_ctx {
+            std::vector<batch_req_result> results_;
+            std::atomic<size_t> num_pending_;
+            std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> b_result_;
+        };
+        std::shared_ptr<async_ctx> actx = std::make_shared<async_ctx>();
+        actx->b_result_ = std::make_shared<cmd_result<std::shared_ptr<buffer>>>();
+        actx->num_pending_ = resps->size() + 1;
+
+        auto finish_one = [actx]() {
+            if (actx->num_pending_.fetch_sub(1) > 1) return;
+            std::shared_ptr<buffer> ctx = serialize_batch_results(actx->results_);
+            std::shared_ptr<std::exception> err;
+            actx->b_result_->accept();
+            actx->b_result_->set_result(ctx, err);
+        };
+
+        for (std::shared_ptr<resp_msg>& rr: *resps) {
+            actx->results_.push_back(make_result(rr));
+        }
+        for (size_t ii = 0; ii < resps->size(); ++ii) {
+            std::shared_ptr<resp_msg>& rr = (*resps)[ii];
+            if (!rr->has_async_cb()) {
+                // Rejected request, the result is already set.
+                finish_one();
+                continue;
+            }
+
+            std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> res =
+                rr->call_async_cb();
+            res->when_ready(
+                [actx, ii, finish_one](cmd_result<std::shared_ptr<buffer>,
+                                                  std::shared_ptr<std::exception>>& r,
+                                       std::shared_ptr<std::exception>& err) {
+                    batch_req_result& br = actx->results_[ii];
+                    br.code_ = r.get_result_code();
+                    br.ret_value_ = err ? nullptr : r.get();
+                    finish_one();
+                    // This is needed to avoid circular reference.
+                    r.reset();
+                });
+        }
+        finish_one();
+
+        std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> b_result = actx->b_result_;
+        resp->set_async_cb([b_result]() { return b_result; });
+
+    } else {
+        // Async replication, or all requests are rejected.
+        std::vector<batch_req_result> results;
+        for (std::shared_ptr<resp_msg>& rr: *resps) {
+            results.push_back(make_result(rr));
+        }
+        resp->set_ctx(serialize_batch_results(results));
+    }
+    return resp;
+}
+
 void raft_server::drop_all_pending_commit_elems() {
     // Blocking mode:
     //   Invoke all awaiting requests to return `CANCELLED`.
     if (ctx_->get_params()->return_method_ == raft_params::blocking) {
-        auto guard = auto_lock(commit_ret_elems_lock_);
         uint64_t min_idx = std::numeric_limits<uint64_t>::max();
         uint64_t max_idx = 0;
-        for (auto& entry: commit_ret_elems_) {
-            std::shared_ptr<commit_ret_elem>& elem = entry.second;
+        size_t num_elems = 0;
+        commit_ret_elems_->clear([&](std::shared_ptr<commit_ret_elem>& elem) {
             elem->ret_value_ = nullptr;
             elem->result_code_ = cmd_result_code::CANCELLED;
             elem->awaiter_.invoke();
@@ -282,35 +601,28 @@ void raft_server::drop_all_pending_commit_elems() {
             if (max_idx < elem->idx_) {
                 max_idx = elem->idx_;
             }
+            num_elems++;
             p_db("cancelled blocking client request %" PRIu64 ", waited %" PRIu64 " us",
                  elem->idx_,
                  elem->timer_.get_us());
-        }
-        if (!commit_ret_elems_.empty()) {
+        });
+        if (num_elems) {
             p_wn("cancelled %zu blocking client requests from %" PRIu64 " to %" PRIu64
                  ".",
-                 commit_ret_elems_.size(),
+                 num_elems,
                  min_idx,
                  max_idx);
         }
-        commit_ret_elems_.clear();
         return;
     }
 
     // Non-blocking mode:
     //   Set `CANCELLED` and set result & error.
     std::list<std::shared_ptr<commit_ret_elem>> elems;
+    commit_ret_elems_->clear(
+        [&](std::shared_ptr<commit_ret_elem>& elem) { elems.push_back(elem); });
 
-    {
-        auto guard = auto_lock(commit_ret_elems_lock_);
-        for (auto& entry: commit_ret_elems_) {
-            std::shared_ptr<commit_ret_elem>& ee = entry.second;
-            elems.push_back(ee);
-        }
-        commit_ret_elems_.clear();
-    }
-
-    // Calling handler should be done outside the mutex.
+    // Calling handler should be done outside the slot lock.
     for (auto& entry: elems) {
         std::shared_ptr<commit_ret_elem>& ee = entry;
         p_wn("cancelled non-blocking client request %" PRIu64, ee->idx_);
@@ -26,6 +26,15 @@ limitations under the License.
 #include "internal_timer.hxx"
 #include "raft_server.hxx"
 
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace nuraft {
 
 struct raft_server::commit_ret_elem {
@@ -37,6 +46,15 @@ struct raft_server::commit_ret_elem {
 
     ~commit_ret_elem() {}
 
+    void reset() {
+        awaiter_.reset();
+        timer_.reset();
+        ret_value_.reset();
+        result_code_ = cmd_result_code::OK;
+        async_result_.reset();
+        callback_invoked_ = false;
+    }
+
     uint64_t idx_;
     EventAwaiter awaiter_;
     timer_helper timer_;
@@ -46,4 +64,214 @@ struct raft_server::commit_ret_elem {
     bool callback_invoked_;
 };
 
+/**
+ * Client request being handled, possibly together with other requests.
+ */
+struct raft_server::cli_req_elem {
+    cli_req_elem(req_msg& req, const req_ext_params& ext_params, uint64_t timestamp_us)
+        : req_(req)
+        , ext_params_(ext_params)
+        , timestamp_us_(timestamp_us)
+        , bytes_(0)
+        , last_idx_(0)
+        , rejected_(false) {
+        for (auto& entry: req.log_entries()) {
+            bytes_ += entry->get_buf().size();
+        }
+    }
+
+    req_msg& req_;
+    const req_ext_params& ext_params_;
+    uint64_t timestamp_us_;
+    size_t bytes_;
+
+    /**
+     * Log index of the last log of this request.
+     */
+    uint64_t last_idx_;
+
+    /**
+     * Result of pre-commit of the last log.
+     */
+    std::shared_ptr<buffer> ret_value_;
+
+    /**
+     * `true` if this request is rejected without appending logs.
+     */
+    bool rejected_;
+
+    std::shared_ptr<resp_msg> resp_;
+
+    /**
+     * Exception thrown while other thread was handling this request.
+     */
+    std::exception_ptr error_;
+
+    /**
+     * Invoked once this request is handled by other thread.
+     */
+    EventAwaiter done_;
+};
+
+/**
+ * Table of `commit_ret_elem`s waiting for the commit, indexed by log index.
+ *
+ * Each log index is mapped to a fixed slot (`log_idx % capacity`) that has
+ * its own spin lock, so that the client thread and the commit thread do
+ * not contend with each other unless they access the same log index.
+ * If the slot is already occupied by another log index, the element goes
+ * to the overflow map protected by a mutex.
+ *
+ * Each slot keeps the last element removed from it, and reuses it once
+ * nobody else refers to it, to avoid allocation for every request.
+ */
+struct raft_server::commit_ret_table {
+    static const size_t DEFAULT_CAPACITY = 4096;
+
+    struct slot {
+        slot()
+            : idx_(0)
+            , busy_(false) {}
+
+        void lock() {
+            while (busy_.exchange(true, std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+        }
+
+        void unlock() { busy_.store(false, std::memory_order_release); }
+
+        void clear() {
+            idx_ = 0;
+            spare_ = std::move(elem_);
+            elem_.reset();
+        }
+
+        // Log index of `elem_`, 0 if empty.
+        uint64_t idx_;
+        std::shared_ptr<commit_ret_elem> elem_;
+        std::shared_ptr<commit_ret_elem> spare_;
+        std::atomic<bool> busy_;
+    };
+
+    /**
+     * Access to the element of the given log index,
+     * holding the lock of the corresponding slot.
+     */
+    class accessor {
+    public:
+        accessor(commit_ret_table& table, uint64_t idx)
+            : table_(table)
+            , idx_(idx)
+            , slot_(table.slots_[idx % table.slots_.size()]) {
+            slot_.lock();
+        }
+
+        ~accessor() { slot_.unlock(); }
+
+        std::shared_ptr<commit_ret_elem> find() {
+            if (slot_.idx_ == idx_) return slot_.elem_;
+            if (!table_.num_overflow_) return nullptr;
+
+            std::lock_guard<std::mutex> l(table_.overflow_lock_);
+            auto entry = table_.overflow_.find(idx_);
+            if (entry == table_.overflow_.end()) return nullptr;
+            return entry->second;
+        }
+
+        void insert(const std::shared_ptr<commit_ret_elem>& elem) {
+            if (!slot_.idx_) {
+                slot_.idx_ = idx_;
+                slot_.elem_ = elem;
+            } else {
+                std::lock_guard<std::mutex> l(table_.overflow_lock_);
+                table_.overflow_[idx_] = elem;
+                table_.num_overflow_++;
+            }
+            table_.num_elems_++;
+        }
+
+        void erase() {
+            if (slot_.idx_ == idx_) {
+                slot_.clear();
+                table_.num_elems_--;
+                return;
+            }
+            if (!table_.num_overflow_) return;
+
+            std::lock_guard<std::mutex> l(table_.overflow_lock_);
+            if (table_.overflow_.erase(idx_)) {
+                table_.num_overflow_--;
+                table_.num_elems_--;
+            }
+        }
+
+        /**
+         * Create a new element for this log index. It is not inserted
+         * into the table.
+         */
+        std::shared_ptr<commit_ret_elem> create() {
+            std::shared_ptr<commit_ret_elem> elem;
+            if (slot_.spare_ && slot_.spare_.use_count() == 1) {
+                // Nobody else can get the spare element, as it is only
+                // accessible under the slot lock.
+                std::atomic_thread_fence(std::memory_order_acquire);
+                elem = std::move(slot_.spare_);
+                slot_.spare_.reset();
+                elem->reset();
+            } else {
+                elem = std::make_shared<commit_ret_elem>();
+            }
+            elem->idx_ = idx_;
+            return elem;
+        }
+
+    private:
+        commit_ret_table& table_;
+        uint64_t idx_;
+        slot& slot_;
+    };
+
+    commit_ret_table(size_t capacity = DEFAULT_CAPACITY)
+        : slots_(capacity)
+        , num_overflow_(0)
+        , num_elems_(0) {}
+
+    size_t size() const { return num_elems_; }
+
+    /**
+     * Remove all elements. The given function is invoked for each
+     * element before removing it, holding the slot lock.
+     */
+    void clear(const std::function<void(std::shared_ptr<commit_ret_elem>&)>& func) {
+        for (slot& ss: slots_) {
+            ss.lock();
+            if (ss.idx_) {
+                func(ss.elem_);
+                ss.clear();
+                num_elems_--;
+            }
+            ss.unlock();
+        }
+        while (num_overflow_) {
+            uint64_t idx = 0;
+            {
+                std::lock_guard<std::mutex> l(overflow_lock_);
+                if (overflow_.empty()) break;
+                idx = overflow_.begin()->first;
+            }
+            accessor acc(*this, idx);
+            std::shared_ptr<commit_ret_elem> elem = acc.find();
+            if (elem) func(elem);
+            acc.erase();
+        }
+    }
+
+    std::vector<slot> slots_;
+    std::map<uint64_t, std::shared_ptr<commit_ret_elem>> overflow_;
+    std::mutex overflow_lock_;
+    std::atomic<size_t> num_overflow_;
+    std::atomic<size_t> num_elems_;
+};
+
 } // namespace nuraft
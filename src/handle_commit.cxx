@@ -25,12 +25,14 @@ limitations under the License.
 #include "error_code.hxx"
 #include "global_mgr.hxx"
 #include "handle_client_request.hxx"
+#include "log_tail_cache.hxx"
 #include "peer.hxx"
 #include "snapshot.hxx"
 #include "state_machine.hxx"
 #include "state_mgr.hxx"
 #include "tracer.hxx"
 
+#include <algorithm>
 #include <cassert>
 #include <list>
 #include <random>
@@ -59,12 +61,12 @@ void raft_server::commit(uint64_t target_idx) {
 
     p_tr("local log idx %" PRIu64 ", target_commit_idx %" PRIu64 ", "
          "quick_commit_index_ %" PRIu64 ", state_->get_commit_idx() %" PRIu64 "",
-         log_store_->next_slot() - 1,
+         log_tail_->next_slot() - 1,
          target_idx,
          quick_commit_index_.load(),
          sm_commit_index_.load());
 
-    if (log_store_->next_slot() - 1 > sm_commit_index_
+    if (log_tail_->next_slot() - 1 > sm_commit_index_
         && quick_commit_index_ > sm_commit_index_) {
 
         nuraft_global_mgr* mgr = nuraft_global_mgr::get_instance();
@@ -108,7 +110,7 @@ void raft_server::commit_in_bg() {
     while (true) {
         try {
             while (quick_commit_index_ <= sm_commit_index_
-                   || sm_commit_index_ >= log_store_->next_slot() - 1) {
+                   || sm_commit_index_ >= log_tail_->next_slot() - 1) {
                 std::unique_lock<std::mutex> lock(commit_cv_lock_);
 
                 auto wait_check = [this]() {
@@ -119,7 +121,7 @@ void raft_server::commit_in_bg() {
                     if (sm_commit_paused_) {
                         return false;
                     }
-                    return (log_store_->next_slot() - 1 > sm_commit_index_
+                    return (log_tail_->next_slot() - 1 > sm_commit_index_
                             && quick_commit_index_ > sm_commit_index_);
                 };
                 p_tr("commit_cv_ sleep\n");
@@ -205,11 +207,16 @@ bool raft_server::commit_in_bg_exec(size_t timeout_ms) {
     bool need_to_handle_commit_elem =
         (is_leader() && !cur_config->is_async_replication());
 
+    uint64_t max_batch = 0;
+    if (ctx_->get_params()->max_commit_batch_size_ > 1) {
+        max_batch = ctx_->get_params()->max_commit_batch_size_;
+    }
+
     bool first_loop_exec = true;
     bool finished_in_time = true;
     timer_helper tt(timeout_ms * 1000);
     while (sm_commit_index_ < quick_commit_index_
-           && sm_commit_index_ < log_store_->next_slot() - 1) {
+           && sm_commit_index_ < log_tail_->next_slot() - 1) {
         // NOTE: Skip timeout checking for the first loop execution.
         if (!first_loop_exec && timeout_ms && tt.timeout()) {
             p_wn("abort commit due to timeout (%zu ms), %" PRIu64 " ms elapsed",
@@ -230,7 +237,38 @@ bool raft_server::commit_in_bg_exec(size_t timeout_ms) {
              quick_commit_index_.load(),
              index_to_commit);
 
-        std::shared_ptr<log_entry> le = log_store_->entry_at(index_to_commit);
+        if (max_batch > 1) {
+            uint64_t last_idx_to_commit =
+                std::min(quick_commit_index_.load(), log_tail_->next_slot() - 1);
+            last_idx_to_commit =
+                std::min(last_idx_to_commit, index_to_commit + max_batch - 1);
+            uint64_t num_committed = 0;
+            if (last_idx_to_commit > index_to_commit) {
+                num_committed = commit_app_logs_in_batch(
+                    index_to_commit, last_idx_to_commit, need_to_handle_commit_elem);
+            }
+            if (num_committed) {
+                uint64_t batch_last_idx = index_to_commit + num_committed - 1;
+                uint64_t exp_idx = index_to_commit - 1;
+                if (sm_commit_index_.compare_exchange_strong(exp_idx, batch_last_idx)) {
+                    snapshot_and_compact(sm_commit_index_);
+
+                    cb_func::Param param(id_, leader_);
+                    uint64_t log_idx = batch_last_idx;
+                    param.ctx = &log_idx;
+                    ctx_->cb_func_.call(cb_func::StateMachineExecution, &param);
+                } else {
+                    p_er("sm_commit_index_ has been changed from %" PRIu64
+                         " to %" PRIu64 ", this thread attempted %" PRIu64,
+                         index_to_commit - 1,
+                         exp_idx,
+                         batch_last_idx);
+                }
+                continue;
+            }
+        }
+
+        std::shared_ptr<log_entry> le = cached_entry_at(index_to_commit);
         if (!le) {
             // LCOV_EXCL_START
             p_ft("failed to get log entry with idx %" PRIu64 "", index_to_commit);
@@ -317,84 +355,150 @@ void raft_server::commit_app_log(uint64_t idx_to_commit,
 
     std::list<std::shared_ptr<commit_ret_elem>> async_elems;
     if (need_to_handle_commit_elem) {
-        std::unique_lock<std::mutex> cre_lock(commit_ret_elems_lock_);
-        /// Sometimes user can batch requests to RAFT: for example send 30
-        /// append entries requests in a single batch. For such request batch
-        /// user will receive a single response: all was successful or all
-        /// failed. Obviously we don't need to add info about responses
-        /// (commit_ret_elems) for 29 requests from batch and need to do it only
-        /// for 30-th request. precommit_index is exact value which identify ID
-        /// of the last request from the latest batch. So if we commiting this
-        /// last request and for some reason it was not added into
-        /// commit_ret_elems in the handle_cli_req method (logical race
-        /// condition) we have to add it here. Otherwise we don't need to add
-        /// anything into commit_ret_elems_, because nobody will wait for the
-        /// responses of the intermediate requests from requests batch.
-        bool need_to_check_commit_ret = sm_idx == pc_idx;
-
-        auto entry = commit_ret_elems_.find(sm_idx);
-        if (entry != commit_ret_elems_.end()) {
-            std::shared_ptr<commit_ret_elem> elem = entry->second;
-            if (elem->idx_ == sm_idx) {
-                elem->result_code_ = cmd_result_code::OK;
-                elem->ret_value_ = ret_value;
-                need_to_check_commit_ret = false;
-                p_dv("notify cb %" PRIu64 " %p", sm_idx, (void*)&elem->awaiter_);
-
-                switch (ctx_->get_params()->return_method_) {
-                case raft_params::blocking:
-                default:
-                    // Blocking mode:
-                    if (elem->callback_invoked_) {
-                        // If elem callback invoked, remove it
-                        commit_ret_elems_.erase(entry);
-                    } else {
-                        // or notify client that request done
-                        elem->awaiter_.invoke();
-                    }
-                    break;
+        set_commit_ret_elem(sm_idx, pc_idx, ret_value, async_elems);
+    }
 
-                case raft_params::async_handler:
-                    // Async handler: put into list.
-                    async_elems.push_back(elem);
-                    commit_ret_elems_.erase(entry);
-                    break;
-                }
-            }
+    // Calling handler should be done outside the mutex.
+    invoke_async_commit_results(async_elems);
+}
+
+uint64_t raft_server::commit_app_logs_in_batch(uint64_t start_idx,
+                                               uint64_t last_idx,
+                                               bool need_to_handle_commit_elem) {
+    std::shared_ptr<std::vector<std::shared_ptr<log_entry>>> entries =
+        cached_log_entries(start_idx, last_idx + 1);
+    if (!entries) return 0;
+
+    std::vector<std::shared_ptr<buffer>> data_list;
+    data_list.reserve(entries->size());
+    for (std::shared_ptr<log_entry>& le: *entries) {
+        // Stop at the first non-app log (or corrupted one),
+        // it will be handled by the regular path.
+        if (le->get_term() == 0 || le->get_val_type() != log_val_type::app_log) break;
+        std::shared_ptr<buffer> buf = le->get_buf_ptr();
+        buf->pos(0);
+        data_list.push_back(buf);
+    }
+    if (data_list.size() < 2) {
+        // Nothing to batch.
+        return 0;
+    }
+
+    uint64_t batch_last_idx = start_idx + data_list.size() - 1;
+    uint64_t pc_idx = precommit_index_.load();
+    if (pc_idx < batch_last_idx) {
+        // Pre-commit should have been invoked, must be a bug.
+        p_ft("pre-commit index %" PRIu64 " is smaller than commit index %" PRIu64,
+             pc_idx,
+             batch_last_idx);
+        ctx_->state_mgr_->system_exit(raft_err::N23_precommit_order_inversion);
+        ::exit(-1);
+    }
+
+    std::vector<std::shared_ptr<buffer>> ret_values;
+    ret_values.reserve(data_list.size());
+    state_machine_->commit_batch_ext(start_idx, data_list, ret_values);
+    if (ret_values.size() != data_list.size()) {
+        p_wn("state machine returned %zu results for %zu logs",
+             ret_values.size(),
+             data_list.size());
+        ret_values.resize(data_list.size());
+    }
+    p_tr("committed logs %" PRIu64 " - %" PRIu64 " in batch", start_idx, batch_last_idx);
+
+    std::list<std::shared_ptr<commit_ret_elem>> async_elems;
+    if (need_to_handle_commit_elem) {
+        for (size_t ii = 0; ii < ret_values.size(); ++ii) {
+            if (ret_values[ii]) ret_values[ii]->pos(0);
+            set_commit_ret_elem(start_idx + ii, pc_idx, ret_values[ii], async_elems);
         }
+    }
+    invoke_async_commit_results(async_elems);
+
+    return data_list.size();
+}
 
-        if (need_to_check_commit_ret) {
-            // If not found, commit thread is invoked earlier than user thread.
-            // Create one here.
-            std::shared_ptr<commit_ret_elem> elem = std::make_shared<commit_ret_elem>();
-            elem->idx_ = sm_idx;
+void raft_server::set_commit_ret_elem(
+    uint64_t sm_idx,
+    uint64_t pc_idx,
+    std::shared_ptr<buffer>& ret_value,
+    std::list<std::shared_ptr<commit_ret_elem>>& async_elems) {
+    /// Sometimes user can batch requests to RAFT: for example send 30
+    /// append entries requests in a single batch. For such request batch
+    /// user will receive a single response: all was successful or all
+    /// failed. Obviously we don't need to add info about responses
+    /// (commit_ret_elems) for 29 requests from batch and need to do it only
+    /// for 30-th request. precommit_index is exact value which identify ID
+    /// of the last request from the latest batch. So if we commiting this
+    /// last request and for some reason it was not added into
+    /// commit_ret_elems in the handle_cli_req method (logical race
+    /// condition) we have to add it here. Otherwise we don't need to add
+    /// anything into commit_ret_elems_, because nobody will wait for the
+    /// responses of the intermediate requests from requests batch.
+    bool need_to_check_commit_ret = sm_idx == pc_idx;
+
+    commit_ret_table::accessor acc(*commit_ret_elems_, sm_idx);
+    std::shared_ptr<commit_ret_elem> elem = acc.find();
+    if (elem) {
+        if (elem->idx_ == sm_idx) {
             elem->result_code_ = cmd_result_code::OK;
             elem->ret_value_ = ret_value;
-            p_tr("commit thread is invoked earlier than user thread, "
-                 "log %" PRIu64 ", elem %p",
-                 sm_idx,
-                 (void*)elem.get());
+            need_to_check_commit_ret = false;
+            p_dv("notify cb %" PRIu64 " %p", sm_idx, (void*)&elem->awaiter_);
 
             switch (ctx_->get_params()->return_method_) {
             case raft_params::blocking:
             default:
-                elem->awaiter_.invoke(); // Callback will not sleep.
+                // Blocking mode:
+                if (elem->callback_invoked_) {
+                    // If elem callback invoked, remove it
+                    acc.erase();
+                } else {
+                    // or notify client that request done
+                    elem->awaiter_.invoke();
+                }
                 break;
+
             case raft_params::async_handler:
-                // Async handler:
-                //   Set the result, but should not put it into the
-                //   `async_elems` list, as the user thread (supposed to be
-                //   executed right after this) will invoke the callback immediately.
-                elem->async_result_ =
-                    std::make_shared<cmd_result<std::shared_ptr<buffer>>>(
-                        elem->ret_value_);
+                // Async handler: put into list.
+                async_elems.push_back(elem);
+                acc.erase();
                 break;
             }
-            commit_ret_elems_.insert(std::make_pair(sm_idx, elem));
         }
     }
 
-    // Calling handler should be done outside the mutex.
+    if (need_to_check_commit_ret) {
+        // If not found, commit thread is invoked earlier than user thread.
+        // Create one here.
+        elem = acc.create();
+        elem->result_code_ = cmd_result_code::OK;
+        elem->ret_value_ = ret_value;
+        p_tr("commit thread is invoked earlier than user thread, "
+             "log %" PRIu64 ", elem %p",
+             sm_idx,
+             (void*)elem.get());
+
+        switch (ctx_->get_params()->return_method_) {
+        case raft_params::blocking:
+        default:
+            elem->awaiter_.invoke(); // Callback will not sleep.
+            break;
+        case raft_params::async_handler:
+            // Async handler:
+            //   Set the result, but should not put it into the
+            //   `async_elems` list, as the user thread (supposed to be
+            //   executed right after this) will invoke the callback immediately.
+            elem->async_result_ =
+                std::make_shared<cmd_result<std::shared_ptr<buffer>>>(elem->ret_value_);
+            break;
+        }
+        acc.insert(elem);
+    }
+}
+
+void raft_server::invoke_async_commit_results(
+    std::list<std::shared_ptr<commit_ret_elem>>& async_elems) {
     for (auto& entry: async_elems) {
         std::shared_ptr<commit_ret_elem>& elem = entry;
         if (elem->async_result_) {
@@ -487,7 +591,7 @@ bool raft_server::snapshot_and_compact(uint64_t committed_idx, bool forced_creat
 
     // get the latest configuration info
     std::shared_ptr<cluster_config> conf = get_config();
-    if (conf->get_prev_log_idx() >= log_store_->next_slot()) {
+    if (conf->get_prev_log_idx() >= log_tail_->next_slot()) {
         // The latest config and previous config is not in log_store,
         // so skip the snapshot creation.
         return false;
@@ -563,7 +667,7 @@ bool raft_server::snapshot_and_compact(uint64_t committed_idx, bool forced_creat
                 // return;
             }
 
-            uint64_t log_term_to_compact = log_store_->term_at(committed_idx);
+            uint64_t log_term_to_compact = cached_term_at(committed_idx);
             std::shared_ptr<snapshot> new_snapshot(
                 std::make_shared<snapshot>(committed_idx, log_term_to_compact, conf));
             p_in("create snapshot idx %" PRIu64 " log_term %" PRIu64,
@@ -637,6 +741,7 @@ void raft_server::on_snapshot_completed(std::shared_ptr<snapshot>& s,
                         compact_upto,
                         std::placeholders::_1,
                         std::placeholders::_2);
+                log_tail_->compact(compact_upto);
                 log_store_->compact(compact_upto, handler);
             }
         }
@@ -668,6 +773,9 @@ void raft_server::reconfigure(const std::shared_ptr<cluster_config>& new_config)
 
     std::stringstream str_buf;
 
+    // Voting members may change.
+    invalidate_voter_matched_idxs();
+
     // Compare old and new configs, to check if
     // the configuration change is for adding this node.
     bool invoke_join_cb = (!cur_config->get_server(id_) && new_config->get_server(id_));
@@ -719,7 +827,7 @@ void raft_server::reconfigure(const std::shared_ptr<cluster_config>& new_config)
                                   context&,
                                   timer_task<int32_t>::executor&,
                                   std::shared_ptr<logger>&>(srv_added, *ctx_, exec, l_);
-        p->set_next_log_idx(log_store_->next_slot());
+        p->set_next_log_idx(log_tail_->next_slot());
 
         str_buf << "add peer " << srv_added->get_id() << ", " << srv_added->get_endpoint()
                 << ", " << (srv_added->is_learner() ? "learner" : "voting member")
@@ -882,6 +990,7 @@ void raft_server::remove_peer_from_peers(const std::shared_ptr<peer>& pp) {
     pp->enable_hb(false);
     clear_snapshot_sync_ctx(*pp);
     peers_.erase(pp->get_id());
+    invalidate_voter_matched_idxs();
 }
 
 void raft_server::pause_state_machine_exeuction(size_t timeout_ms) {
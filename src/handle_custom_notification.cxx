@@ -167,6 +167,9 @@ std::shared_ptr<resp_msg> raft_server::handle_custom_notification_req(req_msg& r
     case custom_notification_msg::request_resignation: {
         return handle_resignation_request(req, msg, resp);
     }
+    case custom_notification_msg::control_heartbeat: {
+        return handle_ctrl_heartbeat(req, msg, resp);
+    }
     default:
         break;
     }
@@ -245,6 +248,95 @@ raft_server::handle_resignation_request(req_msg& req,
     return resp;
 }
 
+std::shared_ptr<resp_msg>
+raft_server::handle_ctrl_heartbeat(req_msg& req,
+                                   std::shared_ptr<custom_notification_msg>,
+                                   std::shared_ptr<resp_msg> resp) {
+    // The same as heartbeat through append entries,
+    // but without checking and touching logs.
+    update_term(req.get_term());
+
+    if (req.get_term() == state_->get_term()) {
+        if (role_ == srv_role::candidate) {
+            become_follower();
+        } else if (role_ == srv_role::leader) {
+            p_wn("got control heartbeat from another leader (%d) with same term",
+                 req.get_src());
+            return resp;
+        }
+        update_target_priority();
+        restart_election_timer();
+    }
+    p_tr("control heartbeat from peer %d, term %" PRIu64,
+         req.get_src(),
+         req.get_term());
+
+    // Response term should be the one after update.
+    std::shared_ptr<resp_msg> ret =
+        std::make_shared<resp_msg>(state_->get_term(),
+                                   msg_type::custom_notification_response,
+                                   id_,
+                                   req.get_src(),
+                                   log_store_->next_slot());
+    ret->accept(log_store_->next_slot());
+    return ret;
+}
+
+bool raft_server::send_ctrl_heartbeat(std::shared_ptr<peer>& p) {
+    std::shared_ptr<raft_params> params = ctx_->get_params();
+    if (!params->use_control_connection_) return false;
+
+    // Data connection sent something recently, don't need to send.
+    if (p->get_ls_timer_us() < (uint64_t)params->heart_beat_interval_ * 1000) {
+        return false;
+    }
+
+    std::shared_ptr<req_msg> req =
+        std::make_shared<req_msg>(state_->get_term(),
+                                  msg_type::custom_notification_request,
+                                  id_,
+                                  p->get_id(),
+                                  term_for_log(log_store_->next_slot() - 1),
+                                  log_store_->next_slot() - 1,
+                                  quick_commit_index_.load());
+
+    std::shared_ptr<custom_notification_msg> custom_noti =
+        std::make_shared<custom_notification_msg>(
+            custom_notification_msg::control_heartbeat);
+    std::shared_ptr<log_entry> custom_noti_le =
+        std::make_shared<log_entry>(0, custom_noti->serialize(), log_val_type::custom);
+    req->log_entries().push_back(custom_noti_le);
+
+    bool sent = p->send_ctrl_req(p, *ctx_, req, ctrl_resp_handler_);
+    p_db("peer %d is busy for %" PRIu64 " ms, %s control heartbeat",
+         p->get_id(),
+         p->get_ls_timer_us() / 1000,
+         sent ? "sent" : "failed to send");
+    return sent;
+}
+
+void raft_server::handle_ctrl_peer_resp(std::shared_ptr<resp_msg>& resp,
+                                        std::shared_ptr<rpc_exception>& err) {
+    if (err) {
+        p_db("control heartbeat to peer %d failed: %s",
+             err->req()->get_dst(),
+             err->what());
+        return;
+    }
+    if (!resp) return;
+
+    auto guard = recur_lock(lock_);
+    if (update_term(resp->get_term())) return;
+    if (role_ != srv_role::leader || resp->get_term() != state_->get_term()) return;
+    if (!resp->get_accepted()) return;
+
+    // Peer is alive, even though data connection is busy.
+    auto entry = peers_.find(resp->get_src());
+    if (entry != peers_.end()) {
+        entry->second->reset_resp_timer();
+    }
+}
+
 void raft_server::handle_custom_notification_resp(resp_msg& resp) {
     if (!resp.get_accepted()) return;
 
@@ -23,6 +23,7 @@ limitations under the License.
 
 #include "cluster_config.hxx"
 #include "event_awaiter.hxx"
+#include "log_tail_cache.hxx"
 #include "peer.hxx"
 #include "snapshot_sync_ctx.hxx"
 #include "state_machine.hxx"
@@ -324,6 +325,7 @@ std::shared_ptr<resp_msg> raft_server::handle_log_sync_req(req_msg& req) {
     }
 
     log_store_->apply_pack(req.get_last_log_idx() + 1, entries[0]->get_buf());
+    log_tail_->reset(log_store_->next_slot());
     p_db("last log %" PRIu64, log_store_->next_slot() - 1);
     precommit_index_ = log_store_->next_slot() - 1;
     commit(log_store_->next_slot() - 1);
@@ -512,6 +514,7 @@ void raft_server::rm_srv_from_cluster(int32_t srv_id) {
         std::shared_ptr<peer> pp = p_entry->second;
         srv_to_leave_ = pp;
         srv_to_leave_target_idx_ = new_conf->get_log_idx();
+        invalidate_voter_matched_idxs();
         p_in("set srv_to_leave_, "
              "server %d will be removed from cluster, config %" PRIu64,
              srv_id,
@@ -546,6 +549,7 @@ void raft_server::handle_join_leave_rpc_err(msg_type t_msg, std::shared_ptr<peer
             if (pit != peers_.end()) {
                 pit->second->enable_hb(false);
                 peers_.erase(pit);
+                invalidate_voter_matched_idxs();
                 p_in("server %d is removed from cluster", p->get_id());
             } else {
                 p_in("peer %d cannot be found, no action for removing", p->get_id());
@@ -593,6 +597,7 @@ void raft_server::reset_srv_to_leave() {
     srv_to_leave_->shutdown();
     srv_to_leave_.reset();
     srv_to_leave_target_idx_ = 0;
+    invalidate_voter_matched_idxs();
     p_in("clearing srv_to_leave_");
 }
 
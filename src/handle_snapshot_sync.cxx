@@ -23,6 +23,7 @@ limitations under the License.
 #include "context.hxx"
 #include "error_code.hxx"
 #include "event_awaiter.hxx"
+#include "log_tail_cache.hxx"
 #include "peer.hxx"
 #include "snapshot.hxx"
 #include "snapshot_sync_ctx.hxx"
@@ -367,6 +368,7 @@ void raft_server::handle_install_snapshot_resp(resp_msg& resp) {
                 p_db("snapshot sync is done (raw type)");
                 p->set_next_log_idx(sync_ctx->get_snapshot()->get_last_log_idx() + 1);
                 p->set_matched_idx(sync_ctx->get_snapshot()->get_last_log_idx());
+                update_voter_matched_idx(p);
                 clear_snapshot_sync_ctx(*p);
 
                 need_to_catchup = p->clear_pending_commit()
@@ -555,7 +557,9 @@ bool raft_server::handle_snapshot_sync_req(snapshot_sync_req& req, std::unique_l
                  ") from leader",
                  req.get_snapshot().get_last_log_idx(),
                  req.get_snapshot().get_last_log_term());
-            if (log_store_->compact(req.get_snapshot().get_last_log_idx())) {
+            bool compacted = log_store_->compact(req.get_snapshot().get_last_log_idx());
+            log_tail_->reset(log_store_->next_slot());
+            if (compacted) {
                 // The state machine will not be able to commit anything before the
                 // snapshot is applied, so make this synchronously with election
                 // timer stopped as usually applying a snapshot may take a very
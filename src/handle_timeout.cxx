@@ -142,6 +142,7 @@ void raft_server::handle_hb_timeout(int32_t srv_id) {
     if (role_ == srv_role::leader) {
         update_target_priority();
         request_append_entries(p);
+        send_ctrl_heartbeat(p);
         {
             std::lock_guard<std::mutex> guard(p->get_lock());
             if (p->is_hb_enabled()) {
@@ -240,6 +241,11 @@ void raft_server::handle_election_timeout() {
         return;
     }
 
+    // Send deferred responses whose logs have become durable,
+    // in case of missing `notify_log_append_completion` call.
+    flush_pending_append_resps(false);
+    process_parked_append_reqs(false);
+
     if (catching_up_) {
         // this is a new server for the cluster, will not send out vote req
         // until conf that includes this srv is committed
@@ -264,8 +270,25 @@ void raft_server::handle_election_timeout() {
         return;
     }
 
+    // Deferred responses suppress the election for up to one election timeout,
+    // in case the log store does not make the logs durable.
+    bool waiting_durable_logs = false;
+    if (!pending_append_resps_.empty()) {
+        uint64_t deferred_at_us = pending_append_resps_.front().deferred_at_us_;
+        uint64_t waited_ms = (timer_helper::get_timeofday_us() - deferred_at_us) / 1000;
+        if (waited_ms < (uint64_t)ctx_->get_params()->election_timeout_upper_bound_) {
+            waiting_durable_logs = true;
+        } else {
+            p_wn("deferred append response has been waiting for %" PRIu64 " ms, "
+                 "durable index %" PRIu64,
+                 waited_ms,
+                 log_store_->last_durable_index());
+        }
+    }
+
     auto time_ms = last_election_timer_reset_.get_us() / 1000;
-    if (serving_req_ || time_ms < ctx_->get_params()->election_timeout_lower_bound_) {
+    if (serving_req_ || waiting_durable_logs || !parked_append_reqs_.empty()
+        || time_ms < ctx_->get_params()->election_timeout_lower_bound_) {
         // Handling appending entries is now taking long time,
         // so that server keeps skipping sending heartbeat.
         // It doesn't mean server is gone. Just ignore.
@@ -20,6 +20,7 @@ limitations under the License.
 
 #include "raft_server.hxx"
 
+#include "buffer_serializer.hxx"
 #include "cluster_config.hxx"
 #include "context.hxx"
 #include "event_awaiter.hxx"
@@ -32,6 +33,10 @@ limitations under the License.
 namespace nuraft {
 
 struct raft_server::auto_fwd_pkg {
+    auto_fwd_pkg()
+        : next_batch_client_(0)
+        , batches_in_flight_(0) {}
+
     /**
      * Available RPC clients.
      */
@@ -51,6 +56,26 @@ struct raft_server::auto_fwd_pkg {
      * Event awaiter.
      */
     EventAwaiter ea_;
+
+    /**
+     * Requests waiting to be forwarded in a batch.
+     */
+    std::list<auto_fwd_req_resp> batch_queue_;
+
+    /**
+     * RPC clients for batched forwarding, used in a round-robin manner.
+     */
+    std::vector<std::shared_ptr<rpc_client>> batch_clients_;
+
+    /**
+     * Index of the RPC client to send the next batch.
+     */
+    size_t next_batch_client_;
+
+    /**
+     * Number of batches sent but not responded yet.
+     */
+    size_t batches_in_flight_;
 };
 
 std::shared_ptr<cmd_result<std::shared_ptr<buffer>>>
@@ -207,6 +232,27 @@ raft_server::send_msg_to_leader(std::shared_ptr<req_msg>& req,
         }
     }
 
+    if (params->auto_forwarding_batch_size_ > 1
+        && req->get_type() == msg_type::client_request) {
+        // Batching is enabled, put it into the queue, it will be sent
+        // by this thread or once the previous batch is responded.
+        std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> presult(
+            std::make_shared<cmd_result<std::shared_ptr<buffer>>>());
+        {
+            std::lock_guard<std::mutex> l(cur_pkg->lock_);
+            auto_fwd_req_resp req_resp_pair;
+            req_resp_pair.req = req;
+            req_resp_pair.resp = presult;
+            cur_pkg->batch_queue_.push_back(req_resp_pair);
+        }
+        auto_fwd_send_batches(cur_pkg, leader_id);
+
+        if (is_blocking_mode) {
+            presult->get();
+        }
+        return presult;
+    }
+
     // Find available `rpc_cli`.
     do {
         std::unique_lock<std::mutex> l(cur_pkg->lock_);
@@ -365,26 +411,208 @@ void raft_server::auto_fwd_resp_handler(
     auto_fwd_release_rpc_cli(cur_pkg, rpc_cli);
 }
 
-void raft_server::cleanup_auto_fwd_pkgs() {
-    auto guard = auto_lock(rpc_clients_lock_);
-    for (auto& entry: auto_fwd_pkgs_) {
-        std::shared_ptr<auto_fwd_pkg> pkg = entry.second;
-        pkg->ea_.invoke();
-        auto pguard = auto_lock(pkg->lock_);
-        p_in("srv %d, in-use %zu, idle %zu",
-             entry.first,
-             pkg->rpc_client_in_use_.size(),
-             pkg->rpc_client_idle_.size());
-        for (auto& ee: pkg->rpc_client_in_use_) {
-            p_tr("use count %zu", ee.use_count());
+void raft_server::auto_fwd_send_batches(std::shared_ptr<auto_fwd_pkg> cur_pkg,
+                                        int32_t leader_id) {
+    std::shared_ptr<raft_params> params = ctx_->get_params();
+    size_t batch_size = std::max(1, params->auto_forwarding_batch_size_);
+    size_t max_batches = std::max(1, params->auto_forwarding_max_batches_in_flight_);
+    // Batches are pipelined, more connections than batches are useless.
+    size_t max_conns = std::min(
+        max_batches, (size_t)std::max(1, params->auto_forwarding_max_connections_));
+
+    auto create_client = [&]() -> std::shared_ptr<rpc_client> {
+        std::shared_ptr<srv_config> srv_conf = get_config()->get_server(leader_id);
+        if (!srv_conf) return nullptr;
+        return ctx_->rpc_cli_factory_->create_client(srv_conf->get_endpoint());
+    };
+
+    do {
+        std::shared_ptr<std::list<auto_fwd_req_resp>> batch =
+            std::make_shared<std::list<auto_fwd_req_resp>>();
+        std::shared_ptr<rpc_client> rpc_cli;
+        {
+            std::lock_guard<std::mutex> l(cur_pkg->lock_);
+            if (cur_pkg->batch_queue_.empty()
+                || cur_pkg->batches_in_flight_ >= max_batches) {
+                return;
+            }
+            while (!cur_pkg->batch_queue_.empty() && batch->size() < batch_size) {
+                batch->push_back(cur_pkg->batch_queue_.front());
+                cur_pkg->batch_queue_.pop_front();
+            }
+
+            if (cur_pkg->batch_clients_.size() < max_conns) {
+                rpc_cli = create_client();
+                if (rpc_cli) cur_pkg->batch_clients_.push_back(rpc_cli);
+            } else {
+                std::shared_ptr<rpc_client>& cli =
+                    cur_pkg->batch_clients_[cur_pkg->next_batch_client_++
+                                            % cur_pkg->batch_clients_.size()];
+                if (!cli || cli->is_abandoned()) {
+                    // Abandoned connection, need to reconnect.
+                    cli = create_client();
+                }
+                rpc_cli = cli;
+            }
+            if (rpc_cli) cur_pkg->batches_in_flight_++;
         }
-        for (auto& ee: pkg->rpc_client_idle_) {
-            p_tr("use count %zu", ee.use_count());
+
+        if (!rpc_cli) {
+            p_wn("cannot create a connection to leader %d", leader_id);
+            std::shared_ptr<buffer> result;
+            std::shared_ptr<std::exception> err = std::make_shared<std::runtime_error>(
+                "Cannot connect to the leader.");
+            for (auto_fwd_req_resp& entry: *batch) {
+                entry.resp->set_result(result, err, cmd_result_code::FAILED);
+            }
+            continue;
         }
-        pkg->rpc_client_idle_.clear();
-        pkg->rpc_client_in_use_.clear();
+
+        // The first log is the header with the number of logs of each request,
+        // so that the leader can split them.
+        //   << Format >>
+        // version                  1 byte
+        // number of requests       4 bytes
+        // { number of logs         4 bytes } * number of requests
+        std::shared_ptr<buffer> header = buffer::alloc(
+            sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint32_t) * batch->size());
+        buffer_serializer bs(header);
+        bs.put_u8(0);
+        bs.put_u32(batch->size());
+
+        std::shared_ptr<req_msg> b_req =
+            std::make_shared<req_msg>((uint64_t)0,
+                                      msg_type::client_batch_request,
+                                      0,
+                                      0,
+                                      (uint64_t)0,
+                                      (uint64_t)0,
+                                      (uint64_t)0);
+        b_req->log_entries().push_back(
+            std::make_shared<log_entry>(0, header, log_val_type::custom));
+        for (auto_fwd_req_resp& entry: *batch) {
+            bs.put_u32(entry.req->log_entries().size());
+            for (auto& le: entry.req->log_entries()) {
+                b_req->log_entries().push_back(le);
+            }
+        }
+        p_tr("forward %zu requests (%zu logs) to leader %d in a batch",
+             batch->size(),
+             b_req->log_entries().size() - 1,
+             leader_id);
+
+        rpc_handler handler = std::bind(&raft_server::auto_fwd_batch_resp_handler,
+                                        this,
+                                        batch,
+                                        cur_pkg,
+                                        leader_id,
+                                        std::placeholders::_1,
+                                        std::placeholders::_2);
+        rpc_cli->send(b_req, handler, params->auto_forwarding_req_timeout_);
+    } while (true);
+}
+
+void raft_server::auto_fwd_batch_resp_handler(
+    std::shared_ptr<std::list<auto_fwd_req_resp>> batch,
+    std::shared_ptr<auto_fwd_pkg> cur_pkg,
+    int32_t leader_id,
+    std::shared_ptr<resp_msg>& resp,
+    std::shared_ptr<rpc_exception>& err) {
+    {
+        std::lock_guard<std::mutex> l(cur_pkg->lock_);
+        cur_pkg->batches_in_flight_--;
+    }
+
+    // Decode the result of each request,
+    // see `serialize_batch_results` for the format.
+    struct req_result {
+        bool accepted_;
+        cmd_result_code code_;
+        std::shared_ptr<buffer> ret_value_;
+    };
+    std::vector<req_result> results;
+    std::shared_ptr<std::exception> perr = err;
+    if (!perr) {
+        std::shared_ptr<buffer> ctx = resp ? resp->get_ctx() : nullptr;
+        try {
+            if (!ctx) throw std::runtime_error("empty context");
+            ctx->pos(0);
+            buffer_serializer bs(ctx);
+            bs.get_u8(); // version.
+            size_t num = bs.get_u32();
+            for (size_t ii = 0; ii < num; ++ii) {
+                req_result rr;
+                rr.accepted_ = (bs.get_u8() != 0);
+                rr.code_ = static_cast<cmd_result_code>(bs.get_i32());
+                size_t len = 0;
+                void* data = bs.get_bytes(len);
+                if (len) {
+                    rr.ret_value_ = buffer::alloc(len);
+                    rr.ret_value_->put_raw(static_cast<std::byte*>(data), len);
+                    rr.ret_value_->pos(0);
+                }
+                results.push_back(rr);
+            }
+            if (results.size() != batch->size()) {
+                throw std::runtime_error("number of results mismatch");
+            }
+        } catch (std::exception& ex) {
+            p_er("invalid batched response from leader %d: %s", leader_id, ex.what());
+            perr = std::make_shared<std::runtime_error>("Invalid batched response.");
+        }
+    }
+
+    size_t idx = 0;
+    for (auto_fwd_req_resp& entry: *batch) {
+        if (perr) {
+            std::shared_ptr<buffer> result;
+            entry.resp->set_result(result, perr, cmd_result_code::FAILED);
+            continue;
+        }
+        req_result& rr = results[idx++];
+        std::shared_ptr<std::exception> no_err;
+        if (rr.accepted_) entry.resp->accept();
+        entry.resp->set_result(rr.ret_value_, no_err, rr.code_);
+    }
+
+    // Send the requests queued in the meantime.
+    auto_fwd_send_batches(cur_pkg, leader_id);
+}
+
+void raft_server::cleanup_auto_fwd_pkgs() {
+    std::list<auto_fwd_req_resp> queued_reqs;
+    {
+        auto guard = auto_lock(rpc_clients_lock_);
+        for (auto& entry: auto_fwd_pkgs_) {
+            std::shared_ptr<auto_fwd_pkg> pkg = entry.second;
+            pkg->ea_.invoke();
+            auto pguard = auto_lock(pkg->lock_);
+            p_in("srv %d, in-use %zu, idle %zu",
+                 entry.first,
+                 pkg->rpc_client_in_use_.size(),
+                 pkg->rpc_client_idle_.size());
+            for (auto& ee: pkg->rpc_client_in_use_) {
+                p_tr("use count %zu", ee.use_count());
+            }
+            for (auto& ee: pkg->rpc_client_idle_) {
+                p_tr("use count %zu", ee.use_count());
+            }
+            pkg->rpc_client_idle_.clear();
+            pkg->rpc_client_in_use_.clear();
+            pkg->batch_clients_.clear();
+            queued_reqs.splice(queued_reqs.end(), pkg->batch_queue_);
+        }
+        auto_fwd_pkgs_.clear();
+    }
+
+    // Requests waiting to be batched will not be sent,
+    // handlers should be invoked outside the lock.
+    for (auto_fwd_req_resp& entry: queued_reqs) {
+        std::shared_ptr<buffer> result;
+        std::shared_ptr<std::exception> err =
+            std::make_shared<std::runtime_error>("Request cancelled.");
+        entry.resp->set_result(result, err, cmd_result_code::CANCELLED);
     }
-    auto_fwd_pkgs_.clear();
 }
 
 } // namespace nuraft
@@ -156,7 +156,10 @@ void raft_server::request_prevote() {
                                       term_for_log(log_store_->next_slot() - 1),
                                       log_store_->next_slot() - 1,
                                       quick_commit_index_.load()));
-        if (pp->make_busy()) {
+        if (ctx_->get_params()->use_control_connection_
+            && pp->send_ctrl_req(pp, *ctx_, req, resp_handler_)) {
+            // Sent through control connection.
+        } else if (pp->make_busy()) {
             pp->send_req(pp, req, resp_handler_);
         } else {
             p_wn("failed to send prevote request: peer %d (%s) is busy",
@@ -276,7 +279,10 @@ void raft_server::request_vote(bool force_vote) {
              msg_type_to_string(req->get_type()).c_str(),
              it->second->get_id(),
              state_->get_term());
-        if (pp->make_busy()) {
+        if (ctx_->get_params()->use_control_connection_
+            && pp->send_ctrl_req(pp, *ctx_, req, resp_handler_)) {
+            // Sent through control connection.
+        } else if (pp->make_busy()) {
             pp->send_req(pp, req, resp_handler_);
         } else {
             p_wn("failed to send vote request: peer %d (%s) is busy",
@@ -0,0 +1,486 @@
+/************************************************************************
+Copyright 2017-2019 eBay Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include "inproc_service.hxx"
+
+#include "raft_server.hxx"
+#include "raft_server_handler.hxx"
+#include "rpc_listener.hxx"
+#include "strfmt.hxx"
+#include "tracer.hxx"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nuraft {
+
+class inproc_listener;
+
+using inproc_resp_handler =
+    std::function<void(std::shared_ptr<resp_msg>, std::shared_ptr<rpc_exception>)>;
+
+// Copy of the request, as if it is sent over the network.
+static std::shared_ptr<req_msg> copy_req(req_msg& src) {
+    std::shared_ptr<req_msg> dst = std::make_shared<req_msg>(src.get_term(),
+                                                             src.get_type(),
+                                                             src.get_src(),
+                                                             src.get_dst(),
+                                                             src.get_last_log_term(),
+                                                             src.get_last_log_idx(),
+                                                             src.get_commit_idx());
+    std::vector<std::shared_ptr<log_entry>>& entries = dst->log_entries();
+    entries.reserve(src.log_entries().size());
+    for (auto& le: src.log_entries()) {
+        // Payload should be copied, as buffer position is not thread-safe.
+        std::shared_ptr<buffer> buf =
+            le->is_buf_null() ? buffer::alloc(0) : buffer::clone(le->get_buf());
+        entries.push_back(std::make_shared<log_entry>(
+            le->get_term(), buf, le->get_val_type(), le->get_timestamp()));
+    }
+    return dst;
+}
+
+// Copy of the response, containing the fields that `asio_service` delivers.
+static std::shared_ptr<resp_msg> copy_resp(resp_msg& src) {
+    std::shared_ptr<resp_msg> dst = std::make_shared<resp_msg>(src.get_term(),
+                                                               src.get_type(),
+                                                               src.get_src(),
+                                                               src.get_dst(),
+                                                               src.get_next_idx(),
+                                                               src.get_accepted());
+    dst->set_next_batch_size_hint_in_bytes(src.get_next_batch_size_hint_in_bytes());
+    if (src.get_ctx()) {
+        dst->set_ctx(buffer::clone(*src.get_ctx()));
+    }
+    return dst;
+}
+
+// inproc service implementation
+class inproc_service_impl {
+public:
+    inproc_service_impl(size_t num_threads, std::shared_ptr<logger> l);
+    ~inproc_service_impl();
+
+    void stop();
+    bool is_stopped() const { return stopped_; }
+    uint64_t assign_client_id() { return client_id_counter_.fetch_add(1); }
+
+    void register_listener(const std::string& endpoint,
+                           std::shared_ptr<inproc_listener> listener);
+    void unregister_listener(const std::string& endpoint, inproc_listener* listener);
+    std::shared_ptr<inproc_listener> find_listener(const std::string& endpoint);
+
+    // Let a worker thread process the requests of the given listener.
+    void schedule(std::shared_ptr<inproc_listener> listener);
+
+private:
+    void worker_entry(size_t worker_id);
+
+    std::mutex listeners_lock_;
+    std::map<std::string, std::weak_ptr<inproc_listener>> listeners_;
+
+    std::mutex run_queue_lock_;
+    std::condition_variable run_queue_cv_;
+    // Listeners having requests to process. Each listener is in this
+    // queue at most once, so that its requests are processed in order.
+    std::deque<std::shared_ptr<inproc_listener>> run_queue_;
+
+    std::atomic<bool> stopped_;
+    std::atomic<uint64_t> client_id_counter_;
+    std::vector<std::thread> workers_;
+    std::shared_ptr<logger> l_;
+};
+
+// rpc listener implementation
+class inproc_listener : public rpc_listener,
+                        public raft_server_handler,
+                        public std::enable_shared_from_this<inproc_listener> {
+public:
+    struct request {
+        std::shared_ptr<req_msg> req_;
+        inproc_resp_handler when_done_;
+    };
+
+    inproc_listener(inproc_service_impl* _impl,
+                    const std::string& endpoint,
+                    std::shared_ptr<logger> l)
+        : impl_(_impl)
+        , endpoint_(endpoint)
+        , stopped_(true)
+        , scheduled_(false)
+        , l_(l) {}
+
+    __nocopy__(inproc_listener);
+
+public:
+    void listen(std::shared_ptr<raft_server>& handler) override {
+        {
+            std::lock_guard<std::mutex> l(lock_);
+            handler_ = handler;
+            stopped_ = false;
+        }
+        impl_->register_listener(endpoint_, this->shared_from_this());
+        p_in("Raft in-process listener initiated on %s", endpoint_.c_str());
+    }
+
+    void stop() override {
+        impl_->unregister_listener(endpoint_, this);
+        std::lock_guard<std::mutex> l(lock_);
+        stopped_ = true;
+    }
+
+    void shutdown() override {
+        std::lock_guard<std::mutex> l(lock_);
+        handler_.reset();
+    }
+
+    void enqueue(request&& req) {
+        bool need_schedule = false;
+        {
+            std::lock_guard<std::mutex> l(lock_);
+            queue_.push_back(std::move(req));
+            if (!scheduled_) {
+                scheduled_ = true;
+                need_schedule = true;
+            }
+        }
+        if (need_schedule) {
+            impl_->schedule(this->shared_from_this());
+        }
+    }
+
+    // Process the requests queued so far.
+    // Returns `true` if more requests have been queued in the meantime.
+    bool process_batch() {
+        std::deque<request> reqs;
+        std::shared_ptr<raft_server> handler;
+        bool stopped = false;
+        {
+            std::lock_guard<std::mutex> l(lock_);
+            reqs.swap(queue_);
+            handler = handler_;
+            stopped = stopped_;
+        }
+
+        for (request& entry: reqs) {
+            if (stopped || !handler || impl_->is_stopped()) {
+                fail(entry, "listener is stopped");
+                continue;
+            }
+            handle(handler, entry);
+        }
+
+        std::lock_guard<std::mutex> l(lock_);
+        if (queue_.empty()) {
+            scheduled_ = false;
+            return false;
+        }
+        return true;
+    }
+
+    // Fail all requests queued so far, when the service is stopped.
+    void fail_all() {
+        std::deque<request> reqs;
+        {
+            std::lock_guard<std::mutex> l(lock_);
+            reqs.swap(queue_);
+            scheduled_ = false;
+        }
+        for (request& entry: reqs) {
+            fail(entry, "service is stopped");
+        }
+    }
+
+private:
+    void handle(std::shared_ptr<raft_server>& handler, request& entry) {
+        std::shared_ptr<req_msg> req = entry.req_;
+        inproc_resp_handler when_done = entry.when_done_;
+
+        // === RAFT server processes the request here. ===
+        std::shared_ptr<resp_msg> resp;
+        try {
+            resp = raft_server_handler::process_req(handler.get(), *req);
+        } catch (std::exception& ex) {
+            p_er("failed to process request message from %d due to error: %s",
+                 req->get_src(),
+                 ex.what());
+        }
+        if (!resp) {
+            fail(entry, "no response is returned from raft message handler");
+            return;
+        }
+
+        if (resp->has_async_cb()) {
+            // Response will be ready later.
+            std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> ret =
+                resp->call_async_cb();
+            ret->when_ready(
+                [resp, when_done](cmd_result<std::shared_ptr<buffer>,
+                                             std::shared_ptr<std::exception>>& res,
+                                  std::shared_ptr<std::exception>&) {
+                    resp->set_ctx(res.get());
+                    when_done(copy_resp(*resp), nullptr);
+                    // This is needed to avoid circular reference.
+                    res.reset();
+                });
+            return;
+        }
+
+        if (resp->has_cb()) {
+            // If callback function exists, get new response message.
+            resp = resp->call_cb(resp);
+        }
+        when_done(copy_resp(*resp), nullptr);
+    }
+
+    void fail(request& entry, const std::string& err_msg) {
+        entry.when_done_(nullptr,
+                         std::make_shared<rpc_exception>(
+                             sstrfmt("%s: %s").fmt(endpoint_.c_str(), err_msg.c_str()),
+                             entry.req_));
+    }
+
+    inproc_service_impl* impl_;
+    std::string endpoint_;
+    std::mutex lock_;
+    std::shared_ptr<raft_server> handler_;
+    bool stopped_;
+    // Requests not processed yet, in the order of arrival.
+    std::deque<request> queue_;
+    // `true` if this listener is in the run queue or being processed.
+    bool scheduled_;
+    std::shared_ptr<logger> l_;
+};
+
+// rpc client implementation
+class inproc_client : public rpc_client,
+                      public std::enable_shared_from_this<inproc_client> {
+public:
+    inproc_client(inproc_service_impl* _impl,
+                  const std::string& endpoint,
+                  std::shared_ptr<logger> l)
+        : impl_(_impl)
+        , endpoint_(endpoint)
+        , client_id_(_impl->assign_client_id())
+        , delivering_(false)
+        , l_(l) {}
+
+    __nocopy__(inproc_client);
+
+public:
+    void send(std::shared_ptr<req_msg>& req,
+              rpc_handler& when_done,
+              uint64_t /* send_timeout_ms */ = 0) override {
+        std::shared_ptr<inproc_client> self = this->shared_from_this();
+        std::shared_ptr<resp_slot> slot = std::make_shared<resp_slot>(req, when_done);
+        {
+            std::lock_guard<std::mutex> l(lock_);
+            pending_.push_back(slot);
+        }
+
+        inproc_resp_handler on_resp = [self, slot](std::shared_ptr<resp_msg> resp,
+                                                   std::shared_ptr<rpc_exception> err) {
+            self->response_ready(slot, resp, err);
+        };
+
+        std::shared_ptr<inproc_listener> listener = impl_->find_listener(endpoint_);
+        if (!listener || impl_->is_stopped()) {
+            on_resp(nullptr,
+                    std::make_shared<rpc_exception>(
+                        sstrfmt("no in-process listener on %s").fmt(endpoint_.c_str()),
+                        req));
+            return;
+        }
+        listener->enqueue(inproc_listener::request{copy_req(*req), on_resp});
+    }
+
+    uint64_t get_id() const override { return client_id_; }
+
+    bool is_abandoned() const override { return impl_->is_stopped(); }
+
+private:
+    struct resp_slot {
+        resp_slot(std::shared_ptr<req_msg>& req, rpc_handler& when_done)
+            : req_(req)
+            , when_done_(when_done)
+            , ready_(false) {}
+        std::shared_ptr<req_msg> req_;
+        rpc_handler when_done_;
+        bool ready_;
+        std::shared_ptr<resp_msg> resp_;
+        std::shared_ptr<rpc_exception> err_;
+    };
+
+    // Responses are delivered in the order of requests,
+    // the same as the responses over a single connection.
+    void response_ready(std::shared_ptr<resp_slot> slot,
+                        std::shared_ptr<resp_msg> resp,
+                        std::shared_ptr<rpc_exception> err) {
+        std::unique_lock<std::mutex> l(lock_);
+        slot->resp_ = resp;
+        slot->err_ = err;
+        slot->ready_ = true;
+        if (delivering_) {
+            // The other thread will deliver it.
+            return;
+        }
+        delivering_ = true;
+        while (!pending_.empty() && pending_.front()->ready_) {
+            std::shared_ptr<resp_slot> cur = pending_.front();
+            pending_.pop_front();
+            l.unlock();
+            cur->when_done_(cur->resp_, cur->err_);
+            l.lock();
+        }
+        delivering_ = false;
+    }
+
+    inproc_service_impl* impl_;
+    std::string endpoint_;
+    uint64_t client_id_;
+    std::mutex lock_;
+    // Requests waiting for the response, in the order of requests.
+    std::list<std::shared_ptr<resp_slot>> pending_;
+    // `true` if a thread is delivering responses.
+    bool delivering_;
+    std::shared_ptr<logger> l_;
+};
+
+inproc_service_impl::inproc_service_impl(size_t num_threads, std::shared_ptr<logger> l)
+    : stopped_(false)
+    , client_id_counter_(1)
+    , l_(l) {
+    if (!num_threads) num_threads = 1;
+    for (size_t ii = 0; ii < num_threads; ++ii) {
+        workers_.emplace_back(&inproc_service_impl::worker_entry, this, ii);
+    }
+}
+
+inproc_service_impl::~inproc_service_impl() { stop(); }
+
+void inproc_service_impl::stop() {
+    {
+        std::lock_guard<std::mutex> l(run_queue_lock_);
+        if (stopped_) return;
+        stopped_ = true;
+    }
+    run_queue_cv_.notify_all();
+    for (std::thread& t: workers_) {
+        if (t.joinable()) t.join();
+    }
+
+    // Return error to the requests not processed yet.
+    std::deque<std::shared_ptr<inproc_listener>> remaining;
+    {
+        std::lock_guard<std::mutex> l(run_queue_lock_);
+        remaining.swap(run_queue_);
+    }
+    for (auto& entry: remaining) {
+        entry->fail_all();
+    }
+    p_in("in-process rpc service stopped");
+}
+
+void inproc_service_impl::register_listener(const std::string& endpoint,
+                                            std::shared_ptr<inproc_listener> listener) {
+    std::lock_guard<std::mutex> l(listeners_lock_);
+    listeners_[endpoint] = listener;
+}
+
+void inproc_service_impl::unregister_listener(const std::string& endpoint,
+                                              inproc_listener* listener) {
+    std::lock_guard<std::mutex> l(listeners_lock_);
+    auto entry = listeners_.find(endpoint);
+    if (entry == listeners_.end()) return;
+
+    std::shared_ptr<inproc_listener> cur = entry->second.lock();
+    if (!cur || cur.get() == listener) {
+        listeners_.erase(entry);
+    }
+}
+
+std::shared_ptr<inproc_listener>
+inproc_service_impl::find_listener(const std::string& endpoint) {
+    std::lock_guard<std::mutex> l(listeners_lock_);
+    auto entry = listeners_.find(endpoint);
+    if (entry == listeners_.end()) return nullptr;
+    return entry->second.lock();
+}
+
+void inproc_service_impl::schedule(std::shared_ptr<inproc_listener> listener) {
+    {
+        std::lock_guard<std::mutex> l(run_queue_lock_);
+        if (!stopped_) {
+            run_queue_.push_back(listener);
+            run_queue_cv_.notify_one();
+            return;
+        }
+    }
+    // Workers are stopped, return error.
+    listener->fail_all();
+}
+
+void inproc_service_impl::worker_entry(size_t worker_id) {
+    std::string thread_name = "nuraft_ip_" + std::to_string(worker_id);
+#ifdef __linux__
+    pthread_setname_np(pthread_self(), thread_name.c_str());
+#elif __APPLE__
+    pthread_setname_np(thread_name.c_str());
+#endif
+
+    while (true) {
+        std::shared_ptr<inproc_listener> listener;
+        {
+            std::unique_lock<std::mutex> l(run_queue_lock_);
+            run_queue_cv_.wait(l, [this]() { return stopped_ || !run_queue_.empty(); });
+            if (stopped_) break;
+            listener = run_queue_.front();
+            run_queue_.pop_front();
+        }
+
+        if (listener->process_batch()) {
+            // More requests have arrived, put it at the end of
+            // the queue to be fair to the other listeners.
+            schedule(listener);
+        }
+    }
+}
+
+inproc_service::inproc_service(size_t num_threads, std::shared_ptr<logger> l)
+    : impl_(new inproc_service_impl(num_threads, l))
+    , l_(l) {}
+
+inproc_service::~inproc_service() { delete impl_; }
+
+std::shared_ptr<rpc_client> inproc_service::create_client(const std::string& endpoint) {
+    if (impl_->is_stopped()) return nullptr;
+    return std::make_shared<inproc_client>(impl_, endpoint, l_);
+}
+
+std::shared_ptr<rpc_listener>
+inproc_service::create_rpc_listener(const std::string& endpoint) {
+    return std::make_shared<inproc_listener>(impl_, endpoint, l_);
+}
+
+void inproc_service::stop() { impl_->stop(); }
+
+} // namespace nuraft
@@ -0,0 +1,256 @@
+/************************************************************************
+Copyright 2017-2019 eBay Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include "log_tail_cache.hxx"
+
+#include <algorithm>
+#include <mutex>
+
+namespace nuraft {
+
+log_tail_cache::log_tail_cache(size_t capacity, uint64_t next_idx)
+    : capacity_(capacity)
+    , start_idx_(next_idx)
+    , next_idx_(next_idx) {
+    if (capacity_) {
+        size_t size = 1;
+        while (size < capacity_) {
+            size *= 2;
+        }
+        entries_.resize(size);
+    }
+}
+
+void log_tail_cache::clear(uint64_t from, uint64_t to) {
+    if (entries_.empty()) return;
+    for (uint64_t ii = from; ii < to; ++ii) {
+        slot(ii).reset();
+    }
+}
+
+void log_tail_cache::put_term(uint64_t log_idx, uint64_t term) {
+    if (log_idx > next_idx_
+        || (!term_runs_.empty() && log_idx < term_runs_.front().first_idx_)) {
+        // Not contiguous to the known terms.
+        term_runs_.clear();
+    }
+    truncate_terms(log_idx);
+    if (term_runs_.empty() || term_runs_.back().term_ != term) {
+        term_runs_.push_back({log_idx, term});
+    }
+}
+
+void log_tail_cache::truncate_terms(uint64_t log_idx) {
+    while (!term_runs_.empty() && term_runs_.back().first_idx_ >= log_idx) {
+        term_runs_.pop_back();
+    }
+}
+
+void log_tail_cache::compact_terms(uint64_t last_log_idx) {
+    if (last_log_idx + 1 >= next_idx_) {
+        term_runs_.clear();
+        return;
+    }
+    while (term_runs_.size() > 1 && term_runs_[1].first_idx_ <= last_log_idx + 1) {
+        term_runs_.pop_front();
+    }
+    if (!term_runs_.empty() && term_runs_.front().first_idx_ <= last_log_idx) {
+        term_runs_.front().first_idx_ = last_log_idx + 1;
+    }
+}
+
+bool log_tail_cache::terms_cover(uint64_t start, uint64_t end) const {
+    return !term_runs_.empty() && start >= term_runs_.front().first_idx_
+           && end <= next_idx_ && start < end;
+}
+
+void log_tail_cache::reset(uint64_t next_idx) {
+    std::lock_guard<std::shared_mutex> l(lock_);
+    clear(start_idx_, next_idx_);
+    term_runs_.clear();
+    start_idx_ = next_idx;
+    next_idx_ = next_idx;
+}
+
+void log_tail_cache::truncate(uint64_t log_idx) {
+    std::lock_guard<std::shared_mutex> l(lock_);
+    if (log_idx >= next_idx_) return;
+
+    truncate_terms(log_idx);
+    clear(std::max(log_idx, start_idx_), next_idx_);
+    start_idx_ = std::min(start_idx_, log_idx);
+    next_idx_ = log_idx;
+}
+
+void log_tail_cache::put(uint64_t log_idx, const std::shared_ptr<log_entry>& entry) {
+    std::lock_guard<std::shared_mutex> l(lock_);
+    put_term(log_idx, entry->get_term());
+    if (log_idx < start_idx_ || log_idx > next_idx_) {
+        // Not contiguous to the cached logs.
+        clear(start_idx_, next_idx_);
+        start_idx_ = log_idx;
+    } else {
+        // Overwritten, discard the logs after it.
+        clear(log_idx, next_idx_);
+    }
+
+    if (entries_.empty()) {
+        start_idx_ = log_idx + 1;
+        next_idx_ = log_idx + 1;
+        return;
+    }
+
+    if (log_idx - start_idx_ >= capacity_) {
+        // Evict the oldest one, before its slot is reused.
+        slot(start_idx_).reset();
+        start_idx_++;
+    }
+    slot(log_idx) = entry;
+    next_idx_ = log_idx + 1;
+}
+
+void log_tail_cache::compact(uint64_t last_log_idx) {
+    std::lock_guard<std::shared_mutex> l(lock_);
+    compact_terms(last_log_idx);
+    if (last_log_idx < start_idx_) return;
+
+    if (last_log_idx >= next_idx_) {
+        // All logs are compacted.
+        clear(start_idx_, next_idx_);
+        start_idx_ = last_log_idx + 1;
+        next_idx_ = last_log_idx + 1;
+        return;
+    }
+
+    clear(start_idx_, last_log_idx + 1);
+    start_idx_ = last_log_idx + 1;
+}
+
+std::shared_ptr<log_entry> log_tail_cache::get(uint64_t log_idx) const {
+    std::shared_lock<std::shared_mutex> l(lock_);
+    if (entries_.empty() || log_idx < start_idx_ || log_idx >= next_idx_) {
+        return nullptr;
+    }
+    return slot(log_idx);
+}
+
+bool log_tail_cache::get_term(uint64_t log_idx, uint64_t& term_out) const {
+    std::shared_lock<std::shared_mutex> l(lock_);
+    if (!terms_cover(log_idx, log_idx + 1)) return false;
+
+    auto it = std::upper_bound(
+        term_runs_.begin(),
+        term_runs_.end(),
+        log_idx,
+        [](uint64_t idx, const term_run& run) { return idx < run.first_idx_; });
+    term_out = (--it)->term_;
+    return true;
+}
+
+bool log_tail_cache::get_terms(uint64_t start,
+                               uint64_t end,
+                               std::vector<uint64_t>& terms_out) const {
+    terms_out.clear();
+    std::shared_lock<std::shared_mutex> l(lock_);
+    if (!terms_cover(start, end)) return false;
+
+    terms_out.reserve(end - start);
+    auto it = std::upper_bound(
+        term_runs_.begin(),
+        term_runs_.end(),
+        start,
+        [](uint64_t idx, const term_run& run) { return idx < run.first_idx_; });
+    --it;
+    for (uint64_t ii = start; ii < end; ++ii) {
+        auto next = it + 1;
+        if (next != term_runs_.end() && ii >= next->first_idx_) it = next;
+        terms_out.push_back(it->term_);
+    }
+    return true;
+}
+
+bool log_tail_cache::get_range(
+    uint64_t start,
+    uint64_t end,
+    int64_t batch_size_hint_in_bytes,
+    std::vector<std::shared_ptr<log_entry>>& entries_out) const {
+    std::shared_lock<std::shared_mutex> l(lock_);
+    if (entries_.empty() || start < start_idx_ || end > next_idx_ || start >= end) {
+        return false;
+    }
+    if (batch_size_hint_in_bytes < 0) {
+        return true;
+    }
+
+    entries_out.reserve(end - start);
+    size_t accum_size = 0;
+    for (uint64_t ii = start; ii < end; ++ii) {
+        const std::shared_ptr<log_entry>& le = slot(ii);
+        entries_out.push_back(le);
+        if (!le->is_buf_null()) accum_size += le->get_buf().size();
+        if (batch_size_hint_in_bytes
+            && accum_size >= (uint64_t)batch_size_hint_in_bytes) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool log_tail_cache::get_term_start(uint64_t log_idx, uint64_t& first_idx_out) const {
+    std::shared_lock<std::shared_mutex> l(lock_);
+    if (!terms_cover(log_idx, log_idx + 1)) return false;
+
+    auto it = std::upper_bound(
+        term_runs_.begin(),
+        term_runs_.end(),
+        log_idx,
+        [](uint64_t idx, const term_run& run) { return idx < run.first_idx_; });
+    --it;
+    // The first run may have started before the known range.
+    if (it == term_runs_.begin()) return false;
+
+    first_idx_out = it->first_idx_;
+    return true;
+}
+
+bool log_tail_cache::get_term_end(uint64_t term,
+                                  uint64_t max_idx,
+                                  uint64_t& last_idx_out) const {
+    std::shared_lock<std::shared_mutex> l(lock_);
+    if (term_runs_.empty()) return false;
+
+    max_idx = std::min(max_idx, next_idx_ - 1);
+    if (max_idx < term_runs_.front().first_idx_ || term < term_runs_.front().term_) {
+        return false;
+    }
+
+    auto it = std::lower_bound(
+        term_runs_.begin(),
+        term_runs_.end(),
+        term,
+        [](const term_run& run, uint64_t t) { return run.term_ < t; });
+    if (it == term_runs_.end() || it->term_ != term || it->first_idx_ > max_idx) {
+        last_idx_out = 0;
+        return true;
+    }
+
+    auto next = it + 1;
+    uint64_t last_idx = (next == term_runs_.end()) ? next_idx_ - 1 : next->first_idx_ - 1;
+    last_idx_out = std::min(last_idx, max_idx);
+    return true;
+}
+
+} // namespace nuraft
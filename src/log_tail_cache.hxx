@@ -0,0 +1,216 @@
+/************************************************************************
+Copyright 2017-2019 eBay Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include "log_entry.hxx"
+#include "pp_util.hxx"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <shared_mutex>
+#include <vector>
+
+namespace nuraft {
+
+/**
+ * Cache of the most recent logs in the log store, so that replication
+ * and commit, which mostly read the tail of logs, do not need to call
+ * the log store. It also keeps the next log index of the log store,
+ * and the first index of each term (term runs) of the logs written
+ * since the last reset, regardless of the number of cached logs.
+ *
+ * Raft server should reflect every change of the log store to this cache.
+ */
+class log_tail_cache {
+public:
+    /**
+     * @param capacity Max number of logs to keep. If 0, only the next
+     *                 log index is kept.
+     * @param next_idx Next log index of the log store.
+     */
+    log_tail_cache(size_t capacity, uint64_t next_idx);
+
+    __nocopy__(log_tail_cache);
+
+public:
+    /**
+     * Discard all logs, and set the next log index.
+     *
+     * @param next_idx Next log index of the log store.
+     */
+    void reset(uint64_t next_idx);
+
+    /**
+     * Discard the logs equal to or greater than the given index,
+     * before the log store overwrites them.
+     *
+     * @param log_idx Log index to be overwritten.
+     */
+    void truncate(uint64_t log_idx);
+
+    /**
+     * Add a log which has been written to the log store.
+     * If it overwrites an existing log, the logs after it are discarded.
+     *
+     * @param log_idx Log index.
+     * @param entry Log entry.
+     */
+    void put(uint64_t log_idx, const std::shared_ptr<log_entry>& entry);
+
+    /**
+     * Discard the logs up to the given index (inclusive), as the log store does.
+     *
+     * @param last_log_idx Last log index to be discarded.
+     */
+    void compact(uint64_t last_log_idx);
+
+    /**
+     * Get the next log index of the log store.
+     *
+     * @return Last log index + 1.
+     */
+    uint64_t next_slot() const { return next_idx_; }
+
+    /**
+     * Get the log at the given index.
+     *
+     * @param log_idx Log index.
+     * @return Log entry, or `nullptr` if it is not cached.
+     */
+    std::shared_ptr<log_entry> get(uint64_t log_idx) const;
+
+    /**
+     * Get the term of the log at the given index, from the term runs.
+     *
+     * @param log_idx Log index.
+     * @param[out] term_out Term of the log.
+     * @return `true` if the term of the log is known.
+     */
+    bool get_term(uint64_t log_idx, uint64_t& term_out) const;
+
+    /**
+     * Get the terms of the logs in the given range, from the term runs.
+     *
+     * @param start Start log index (inclusive).
+     * @param end End log index (exclusive).
+     * @param[out] terms_out Terms of the logs.
+     * @return `true` if the terms of all logs in the range are known.
+     */
+    bool get_terms(uint64_t start, uint64_t end, std::vector<uint64_t>& terms_out) const;
+
+    /**
+     * Get the first log index of the term of the log at the given index,
+     * from the term runs.
+     *
+     * @param log_idx Log index.
+     * @param[out] first_idx_out First log index of the term.
+     * @return `true` if the whole term is known.
+     */
+    bool get_term_start(uint64_t log_idx, uint64_t& first_idx_out) const;
+
+    /**
+     * Get the last log index of the given term, up to the given index,
+     * from the term runs.
+     *
+     * @param term Term.
+     * @param max_idx Max log index to search.
+     * @param[out] last_idx_out Last log index of the term,
+     *                          or 0 if there is no log of the term.
+     * @return `true` if the result is known.
+     */
+    bool get_term_end(uint64_t term, uint64_t max_idx, uint64_t& last_idx_out) const;
+
+    /**
+     * Get the logs in the given range, the same as `log_store::log_entries_ext`.
+     *
+     * @param start Start log index (inclusive).
+     * @param end End log index (exclusive).
+     * @param batch_size_hint_in_bytes Max total size of the logs.
+     * @param[out] entries_out Logs.
+     * @return `true` if all logs in the range are cached.
+     */
+    bool get_range(uint64_t start,
+                   uint64_t end,
+                   int64_t batch_size_hint_in_bytes,
+                   std::vector<std::shared_ptr<log_entry>>& entries_out) const;
+
+private:
+    std::shared_ptr<log_entry>& slot(uint64_t log_idx) {
+        return entries_[log_idx & (entries_.size() - 1)];
+    }
+
+    const std::shared_ptr<log_entry>& slot(uint64_t log_idx) const {
+        return entries_[log_idx & (entries_.size() - 1)];
+    }
+
+    void clear(uint64_t from, uint64_t to);
+
+    void put_term(uint64_t log_idx, uint64_t term);
+
+    void truncate_terms(uint64_t log_idx);
+
+    void compact_terms(uint64_t last_log_idx);
+
+    bool terms_cover(uint64_t start, uint64_t end) const;
+
+    struct term_run {
+        /**
+         * The first log index of the term.
+         */
+        uint64_t first_idx_;
+
+        /**
+         * Term.
+         */
+        uint64_t term_;
+    };
+
+    /**
+     * Ring buffer of logs, whose size is a power of 2.
+     * Empty if caching logs is disabled.
+     */
+    std::vector<std::shared_ptr<log_entry>> entries_;
+
+    /**
+     * Max number of logs to keep.
+     */
+    size_t capacity_;
+
+    /**
+     * The index of the first cached log.
+     */
+    uint64_t start_idx_;
+
+    /**
+     * The next log index of the log store.
+     */
+    std::atomic<uint64_t> next_idx_;
+
+    /**
+     * Term runs of the logs in [`term_runs_.front().first_idx_`, `next_idx_`),
+     * in ascending order of index. The first one may have started earlier.
+     */
+    std::deque<term_run> term_runs_;
+
+    /**
+     * Lock for `entries_`, `start_idx_`, and `term_runs_`.
+     */
+    mutable std::shared_mutex lock_;
+};
+
+} // namespace nuraft
@@ -29,9 +29,9 @@ public:
 class mock_ssl_socket {
 public:
     using executor_type = int;
-    using lowest_layer_type = asio::ip::tcp::socket;
+    using lowest_layer_type = stream_socket;
 
-    mock_ssl_socket(asio::ip::tcp::socket& tcp_socket, mock_ssl_context& context)
+    mock_ssl_socket(stream_socket& tcp_socket, mock_ssl_context& context)
         : socket_(tcp_socket)
         , context_(context) {}
 
@@ -41,6 +41,6 @@ public:
 
     template <typename A, typename B> void async_write_some(A a, B b) {}
 
-    asio::ip::tcp::socket& socket_;
+    stream_socket& socket_;
     mock_ssl_context& context_;
 };
@@ -21,6 +21,7 @@ limitations under the License.
 #include "peer.hxx"
 
 #include "debugging_options.hxx"
+#include "striped_rpc_client.hxx"
 #include "tracer.hxx"
 
 #include <unordered_set>
@@ -185,6 +186,102 @@ void peer::handle_rpc_result(std::shared_ptr<peer> myself,
     }
 }
 
+bool peer::send_ctrl_req(std::shared_ptr<peer> myself,
+                         context& ctx,
+                         std::shared_ptr<req_msg>& req,
+                         rpc_handler& handler) {
+    if (abandoned_) {
+        p_er("peer %d has been shut down, cannot send request", config_->get_id());
+        return false;
+    }
+
+    bool f = false;
+    if (!ctrl_busy_flag_.compare_exchange_strong(f, true)) {
+        p_tr("control request to peer %d is already in flight", config_->get_id());
+        return false;
+    }
+
+    std::shared_ptr<rpc_client> rpc_local = nullptr;
+    {
+        std::lock_guard<std::mutex> l(rpc_protector_);
+        if (!ctrl_rpc_) {
+            std::shared_ptr<rpc_client_factory> factory = nullptr;
+            {
+                std::lock_guard<std::mutex> ll(ctx.ctx_lock_);
+                factory = ctx.rpc_cli_factory_;
+            }
+            if (factory) {
+                ctrl_rpc_ = factory->create_client(config_->get_endpoint());
+                p_tr("%p control connection to peer %d",
+                     (void*)ctrl_rpc_.get(),
+                     config_->get_id());
+            }
+        }
+        rpc_local = ctrl_rpc_;
+    }
+    if (!rpc_local) {
+        p_tr("control rpc local is null");
+        ctrl_busy_flag_ = false;
+        return false;
+    }
+
+    p_tr("send control req %d -> %d, type %s",
+         req->get_src(),
+         req->get_dst(),
+         msg_type_to_string(req->get_type()).c_str());
+
+    rpc_handler h = (rpc_handler)std::bind(&peer::handle_ctrl_rpc_result,
+                                           this,
+                                           myself,
+                                           rpc_local,
+                                           handler,
+                                           std::placeholders::_1,
+                                           std::placeholders::_2);
+    rpc_local->send(req, h);
+    return true;
+}
+
+void peer::handle_ctrl_rpc_result(std::shared_ptr<peer> myself,
+                                  std::shared_ptr<rpc_client> my_rpc_client,
+                                  rpc_handler& handler,
+                                  std::shared_ptr<resp_msg>& resp,
+                                  std::shared_ptr<rpc_exception>& err) {
+    if (abandoned_) {
+        p_in("peer %d has been shut down, ignore control response.", config_->get_id());
+        return;
+    }
+
+    if (err) {
+        // The same as data connection, we MUST NOT re-use existing socket.
+        // Next control request will create a new one.
+        std::lock_guard<std::mutex> l(rpc_protector_);
+        if (ctrl_rpc_ == my_rpc_client) {
+            ctrl_rpc_.reset();
+        }
+    } else {
+        resp->set_peer(myself);
+    }
+    ctrl_busy_flag_ = false;
+
+    handler(resp, err);
+}
+
+std::shared_ptr<rpc_client> peer::create_data_client(rpc_client_factory& factory,
+                                                     const std::string& endpoint,
+                                                     int32_t num_conns) {
+    if (num_conns <= 1) {
+        return factory.create_client(endpoint);
+    }
+
+    std::vector<std::shared_ptr<rpc_client>> clients;
+    for (int32_t ii = 0; ii < num_conns; ++ii) {
+        std::shared_ptr<rpc_client> cc = factory.create_client(endpoint);
+        if (!cc) return nullptr;
+        clients.push_back(cc);
+    }
+    return std::make_shared<striped_rpc_client>(clients);
+}
+
 bool peer::recreate_rpc(std::shared_ptr<srv_config>& config, context& ctx) {
     if (abandoned_) {
         p_tr("peer %d is abandoned", config->get_id());
@@ -220,9 +317,18 @@ bool peer::recreate_rpc(std::shared_ptr<srv_config>& config, context& ctx) {
         if (!new_duration_ms) new_duration_ms = 1;
         reconn_backoff_.set_duration_ms(new_duration_ms);
 
-        rpc_ = factory->create_client(config->get_endpoint());
+        rpc_ = create_data_client(*factory,
+                                  config->get_endpoint(),
+                                  ctx.get_params()->data_connections_per_peer_);
         p_tr("%p reconnect peer %d", (void*)rpc_.get(), config_->get_id());
 
+        {
+            // Responses to the requests sent through the previous
+            // client will be ignored.
+            auto guard = auto_lock(lock_);
+            clear_inflight_appends();
+        }
+
         // WARNING:
         //   A reconnection attempt should be treated as an activity,
         //   hence reset timer.
@@ -248,6 +354,7 @@ void peer::shutdown() {
         // (race between send_req()).
         std::lock_guard<std::mutex> l(rpc_protector_);
         rpc_.reset();
+        ctrl_rpc_.reset();
     }
     hb_task_.reset();
 }
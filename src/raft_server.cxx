@@ -28,6 +28,7 @@ limitations under the License.
 #include "handle_client_request.hxx"
 #include "handle_custom_notification.hxx"
 #include "internal_timer.hxx"
+#include "log_tail_cache.hxx"
 #include "peer.hxx"
 #include "snapshot.hxx"
 #include "snapshot_sync_ctx.hxx"
@@ -89,6 +90,8 @@ raft_server::raft_server(context* ctx, raft_server::init_options const& opt)
     , role_(srv_role::follower)
     , state_(ctx->state_mgr_->read_state())
     , log_store_(ctx->state_mgr_->load_log_store())
+    , log_tail_(new log_tail_cache(std::max(ctx->get_params()->log_tail_cache_size_, 0),
+                                   log_store_->next_slot()))
     , state_machine_(ctx->state_machine_)
     , receiving_snapshot_(false)
     , et_cnt_receiving_snapshot_(0)
@@ -101,7 +104,12 @@ raft_server::raft_server(context* ctx, raft_server::init_options const& opt)
     , srv_to_join_snp_retry_required_(false)
     , srv_to_leave_(nullptr)
     , srv_to_leave_target_idx_(0)
+    , voter_matched_dirty_(true)
     , conf_to_add_(nullptr)
+    , group_commit_bytes_(0)
+    , group_commit_active_(false)
+    , group_commit_callers_(0)
+    , commit_ret_elems_(new commit_ret_table())
     , resp_handler_((rpc_handler)std::bind(&raft_server::handle_peer_resp,
                                            this,
                                            std::placeholders::_1,
@@ -110,8 +118,11 @@ raft_server::raft_server(context* ctx, raft_server::init_options const& opt)
                                               this,
                                               std::placeholders::_1,
                                               std::placeholders::_2))
+    , ctrl_resp_handler_((rpc_handler)std::bind(&raft_server::handle_ctrl_peer_resp,
+                                                this,
+                                                std::placeholders::_1,
+                                                std::placeholders::_2))
     , last_snapshot_(ctx->state_machine_->last_snapshot())
-    , ea_follower_log_append_(new EventAwaiter())
     , test_mode_flag_(opt._test_mode_flag) {
 
     ctx->set_cb_func(opt._raft_callback);
@@ -474,6 +485,12 @@ void raft_server::shutdown() {
 
     p_in("all pending commit elements dropped.");
 
+    {
+        auto guard = recur_lock(lock_);
+        flush_pending_append_resps(true);
+        process_parked_append_reqs(true);
+    }
+
     // Clear shared_ptrs that the current server is holding.
     {
         std::lock_guard<std::mutex> l(ctx_->ctx_lock_);
@@ -560,8 +577,11 @@ int32_t raft_server::get_quorum_for_election() {
 }
 
 uint32_t raft_server::get_quorum_for_commit() {
+    return get_quorum_for_commit(get_num_voting_members());
+}
+
+uint32_t raft_server::get_quorum_for_commit(uint32_t num_voting_members) {
     std::shared_ptr<raft_params> params = ctx_->get_params();
-    auto num_voting_members = get_num_voting_members();
 
     if (params->exclude_snp_receiver_from_quorum_) {
         // If the option is on, exclude any peer who is
@@ -661,6 +681,10 @@ std::shared_ptr<resp_msg> raft_server::process_req(req_msg& req,
         // Client request doesn't need to go through below process.
         return handle_cli_req_prelock(req, ext_params);
     }
+    if (req.get_type() == msg_type::client_batch_request) {
+        // Client requests forwarded together by a follower.
+        return handle_cli_batch_req(req);
+    }
 
     auto guard = recur_lock(lock_);
     if (req.get_type() == msg_type::append_entries_request
@@ -716,6 +740,10 @@ std::shared_ptr<resp_msg> raft_server::process_req(req_msg& req,
         resp = handle_ext_msg(req, guard);
     }
 
+    // Parked requests may follow the logs appended just now,
+    // or may have become stale (e.g., by snapshot installation).
+    process_parked_append_reqs(false);
+
     if (resp) {
         p_db("Response back a %s message to %d with Accepted=%d, "
              "Term=%" PRIu64 ", NextIndex=%" PRIu64 "",
@@ -969,10 +997,10 @@ bool raft_server::reconnect_client(peer& p) {
 void raft_server::become_leader() {
     stop_election_timer();
 
-    {
-        auto guard = auto_lock(commit_ret_elems_lock_);
-        p_in("number of pending commit elements: %zu", commit_ret_elems_.size());
-    }
+    // Parked requests from the previous leader will never be processed.
+    process_parked_append_reqs(true);
+
+    p_in("number of pending commit elements: %zu", commit_ret_elems_->size());
 
     std::shared_ptr<raft_params> params = ctx_->get_params();
     {
@@ -989,6 +1017,7 @@ void raft_server::become_leader() {
              sm_commit_index_.load(),
              precommit_index_.load(),
              log_store_->next_slot() - 1);
+        invalidate_voter_matched_idxs();
         std::shared_ptr<snapshot> nil_snp;
         for (peer_itor it = peers_.begin(); it != peers_.end(); ++it) {
             std::shared_ptr<peer> pp = it->second;
@@ -998,6 +1027,10 @@ void raft_server::become_leader() {
             //       during pre-vote phase.
             // reconnect_client(*pp);
 
+            {
+                auto guard = auto_lock(pp->get_lock());
+                pp->clear_inflight_appends();
+            }
             pp->set_next_log_idx(log_store_->next_slot());
             enable_hb_for_peer(*pp);
         }
@@ -1513,6 +1546,11 @@ uint64_t raft_server::term_for_log(uint64_t log_idx) {
         return 0L;
     }
 
+    uint64_t term = 0;
+    if (log_tail_->get_term(log_idx, term)) {
+        return term;
+    }
+
     if (log_idx >= log_store_->start_index()) {
         return log_store_->term_at(log_idx);
     }
@@ -1541,6 +1579,83 @@ uint64_t raft_server::term_for_log(uint64_t log_idx) {
     return last_snapshot->get_last_log_term();
 }
 
+uint64_t raft_server::cached_term_at(uint64_t log_idx) {
+    uint64_t term = 0;
+    if (log_tail_->get_term(log_idx, term)) {
+        return term;
+    }
+    return log_store_->term_at(log_idx);
+}
+
+void raft_server::cached_terms_in_range(uint64_t start,
+                                        uint64_t end,
+                                        std::vector<uint64_t>& terms_out) {
+    if (log_tail_->get_terms(start, end, terms_out)) return;
+    if (log_store_->terms_in_range(start, end, terms_out)) return;
+
+    // Out of the range of the log store, follow `term_at`.
+    terms_out.clear();
+    for (uint64_t ii = start; ii < end; ++ii) {
+        terms_out.push_back(log_store_->term_at(ii));
+    }
+}
+
+uint64_t raft_server::first_log_idx_of_term(uint64_t log_idx) {
+    uint64_t first_idx = 0;
+    if (log_tail_->get_term_start(log_idx, first_idx)) return first_idx;
+
+    // Terms never decrease along the log, binary search the start of the term.
+    uint64_t term = cached_term_at(log_idx);
+    uint64_t lo = log_store_->start_index();
+    uint64_t hi = std::max(lo, log_idx);
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (cached_term_at(mid) < term) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+uint64_t raft_server::last_log_idx_of_term(uint64_t term, uint64_t max_idx) {
+    uint64_t last_idx = 0;
+    if (log_tail_->get_term_end(term, max_idx, last_idx)) return last_idx;
+
+    // Binary search the last log whose term is not greater than the given one.
+    uint64_t lo = log_store_->start_index();
+    uint64_t hi = std::min(max_idx, log_tail_->next_slot() - 1);
+    if (hi < lo || cached_term_at(lo) > term) return 0;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo + 1) / 2;
+        if (cached_term_at(mid) <= term) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return cached_term_at(lo) == term ? lo : 0;
+}
+
+std::shared_ptr<log_entry> raft_server::cached_entry_at(uint64_t log_idx) {
+    std::shared_ptr<log_entry> entry = log_tail_->get(log_idx);
+    if (entry) {
+        return entry;
+    }
+    return log_store_->entry_at(log_idx);
+}
+
+std::shared_ptr<std::vector<std::shared_ptr<log_entry>>> raft_server::cached_log_entries(
+    uint64_t start, uint64_t end, int64_t batch_size_hint_in_bytes) {
+    std::shared_ptr<std::vector<std::shared_ptr<log_entry>>> entries =
+        std::make_shared<std::vector<std::shared_ptr<log_entry>>>();
+    if (log_tail_->get_range(start, end, batch_size_hint_in_bytes, *entries)) {
+        return entries;
+    }
+    return log_store_->log_entries_ext(start, end, batch_size_hint_in_bytes);
+}
+
 void raft_server::set_user_ctx(const std::string& ctx) {
     // Clone current cluster config.
     std::shared_ptr<cluster_config> c_conf = get_config();
@@ -1655,8 +1770,11 @@ uint64_t raft_server::store_log_entry(std::shared_ptr<log_entry>& entry, uint64_
     if (index == 0) {
         log_index = log_store_->append(entry);
     } else {
+        // Cached logs to be overwritten should not be read in the meantime.
+        log_tail_->truncate(log_index);
         log_store_->write_at(log_index, entry);
     }
+    log_tail_->put(log_index, entry);
 
     if (entry->get_val_type() == log_val_type::conf) {
         // Force persistence of config_change logs to guarantee the durability of
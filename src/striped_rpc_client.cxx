@@ -0,0 +1,97 @@
+/************************************************************************
+Copyright 2017-2019 eBay Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+
+#include "striped_rpc_client.hxx"
+
+#include "msg_type.hxx"
+
+namespace nuraft {
+
+struct striped_rpc_client::resp_slot {
+    resp_slot(rpc_handler& when_done)
+        : when_done_(when_done)
+        , ready_(false) {}
+    rpc_handler when_done_;
+    bool ready_;
+    std::shared_ptr<resp_msg> resp_;
+    std::shared_ptr<rpc_exception> err_;
+};
+
+striped_rpc_client::striped_rpc_client(
+    const std::vector<std::shared_ptr<rpc_client>>& clients)
+    : clients_(clients)
+    , next_client_(0)
+    , delivering_(false) {}
+
+void striped_rpc_client::send(std::shared_ptr<req_msg>& req,
+                              rpc_handler& when_done,
+                              uint64_t send_timeout_ms) {
+    if (req->get_type() != msg_type::append_entries_request) {
+        // Only the order of append entries responses matters,
+        // the others are returned as soon as they arrive.
+        clients_[0]->send(req, when_done, send_timeout_ms);
+        return;
+    }
+
+    std::shared_ptr<striped_rpc_client> self = this->shared_from_this();
+    std::shared_ptr<resp_slot> slot = std::make_shared<resp_slot>(when_done);
+    {
+        std::lock_guard<std::mutex> l(lock_);
+        pending_.push_back(slot);
+    }
+
+    size_t idx = next_client_.fetch_add(1) % clients_.size();
+
+    rpc_handler h = [self, slot](std::shared_ptr<resp_msg>& resp,
+                                 std::shared_ptr<rpc_exception>& err) {
+        self->response_ready(slot, resp, err);
+    };
+    clients_[idx]->send(req, h, send_timeout_ms);
+}
+
+uint64_t striped_rpc_client::get_id() const { return clients_[0]->get_id(); }
+
+bool striped_rpc_client::is_abandoned() const {
+    for (const std::shared_ptr<rpc_client>& cc: clients_) {
+        if (cc->is_abandoned()) return true;
+    }
+    return false;
+}
+
+void striped_rpc_client::response_ready(std::shared_ptr<resp_slot> slot,
+                                        std::shared_ptr<resp_msg>& resp,
+                                        std::shared_ptr<rpc_exception>& err) {
+    std::unique_lock<std::mutex> l(lock_);
+    slot->resp_ = resp;
+    slot->err_ = err;
+    slot->ready_ = true;
+    if (delivering_) {
+        // The other thread will deliver it.
+        return;
+    }
+    delivering_ = true;
+    while (!pending_.empty() && pending_.front()->ready_) {
+        std::shared_ptr<resp_slot> cur = pending_.front();
+        pending_.pop_front();
+        l.unlock();
+        cur->when_done_(cur->resp_, cur->err_);
+        l.lock();
+    }
+    delivering_ = false;
+}
+
+} // namespace nuraft
@@ -0,0 +1,88 @@
+/************************************************************************
+Copyright 2017-2019 eBay Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+
+#pragma once
+
+#include "pp_util.hxx"
+#include "rpc_cli.hxx"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nuraft {
+
+/**
+ * RPC client that stripes append entries requests across multiple
+ * connections to the same server, while returning their responses in
+ * the order of requests, the same as a single connection. Other types
+ * of requests always go through the first connection, and their
+ * responses are returned as soon as they arrive.
+ */
+class striped_rpc_client : public rpc_client,
+                           public std::enable_shared_from_this<striped_rpc_client> {
+public:
+    striped_rpc_client(const std::vector<std::shared_ptr<rpc_client>>& clients);
+
+    __nocopy__(striped_rpc_client);
+
+public:
+    void send(std::shared_ptr<req_msg>& req,
+              rpc_handler& when_done,
+              uint64_t send_timeout_ms = 0) override;
+
+    uint64_t get_id() const override;
+
+    bool is_abandoned() const override;
+
+private:
+    struct resp_slot;
+
+    void response_ready(std::shared_ptr<resp_slot> slot,
+                        std::shared_ptr<resp_msg>& resp,
+                        std::shared_ptr<rpc_exception>& err);
+
+    /**
+     * Underlying clients, the same endpoint.
+     */
+    std::vector<std::shared_ptr<rpc_client>> clients_;
+
+    /**
+     * Index of the client for the next append entries request.
+     */
+    std::atomic<size_t> next_client_;
+
+    /**
+     * Append entries requests whose responses are not delivered yet,
+     * in the order of requests.
+     */
+    std::deque<std::shared_ptr<resp_slot>> pending_;
+
+    /**
+     * `true` if a thread is delivering responses in `pending_`.
+     */
+    bool delivering_;
+
+    /**
+     * Guard of `pending_` and `delivering_`.
+     */
+    std::mutex lock_;
+};
+
+} // namespace nuraft
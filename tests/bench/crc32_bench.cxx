@@ -0,0 +1,80 @@
+/************************************************************************
+Copyright 2017-2019 eBay Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include "crc32.hxx"
+#include "crc32c.hxx"
+
+#include "test_common.h"
+
+#include <random>
+#include <vector>
+
+namespace crc32_bench {
+
+typedef uint32_t (*crc_func)(const void*, size_t, uint32_t);
+
+// Returns throughput in MB/s.
+double run_crc(crc_func func, const std::vector<uint8_t>& data, size_t total_bytes) {
+    size_t num_iters = std::max(total_bytes / data.size(), (size_t)1);
+    volatile uint32_t sink = 0;
+
+    TestSuite::Timer timer;
+    uint32_t crc = 0;
+    for (size_t ii = 0; ii < num_iters; ++ii) {
+        crc = func(data.data(), data.size(), crc);
+    }
+    sink = crc;
+    (void)sink;
+
+    uint64_t elapsed_us = std::max(timer.getTimeUs(), (uint64_t)1);
+    return (double)num_iters * data.size() / elapsed_us;
+}
+
+int crc_bench(size_t size) {
+    const size_t TOTAL_BYTES = 512 * 1024 * 1024;
+
+    std::mt19937 engine(0);
+    std::vector<uint8_t> data(size);
+    for (uint8_t& cc: data) cc = (uint8_t)engine();
+
+    double crc32_8_mbps = run_crc(crc32_8, data, TOTAL_BYTES);
+    double crc32c_sw_mbps = run_crc(crc32c_sw, data, TOTAL_BYTES);
+    double crc32c_mbps = run_crc(crc32c, data, TOTAL_BYTES);
+
+    TestSuite::_msg("%8zu bytes: crc32_8 %8.1f MB/s, crc32c_sw %8.1f MB/s, "
+                    "crc32c (%s) %8.1f MB/s\n",
+                    size,
+                    crc32_8_mbps,
+                    crc32c_sw_mbps,
+                    crc32c_impl_name(),
+                    crc32c_mbps);
+    return 0;
+}
+
+} // namespace crc32_bench
+using namespace crc32_bench;
+
+int main(int argc, char** argv) {
+    TestSuite ts(argc, argv);
+
+    ts.options.printTestMessage = true;
+
+    ts.doTest("crc32 bench",
+              crc_bench,
+              TestRange<size_t>({64, 1024, 16 * 1024, 1024 * 1024}));
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+/************************************************************************
+Copyright 2017-2019 eBay Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include "file_log_store.hxx"
+#include "in_memory_log_store.hxx"
+
+#include "test_common.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+using namespace nuraft;
+
+namespace log_store_bench {
+
+const size_t BATCH_SIZE = 100;
+
+std::string ops_str(size_t num, size_t size, uint64_t elapsed_us) {
+    elapsed_us = std::max(elapsed_us, (uint64_t)1);
+    return TestSuite::throughputStr(num, elapsed_us) + " ops/s, "
+           + TestSuite::sizeThroughputStr(num * size, elapsed_us) + "/s";
+}
+
+// Append logs in batches of `BATCH_SIZE`, as Raft does.
+void append_logs(log_store& store, size_t num, size_t size, const char* desc) {
+    std::shared_ptr<buffer> payload = buffer::alloc(size);
+    memset(payload->data_begin(), 'x', size);
+
+    TestSuite::Timer timer;
+    for (size_t ii = 0; ii < num; ii += BATCH_SIZE) {
+        uint64_t start = store.next_slot();
+        size_t cnt = std::min(BATCH_SIZE, num - ii);
+        for (size_t jj = 0; jj < cnt; ++jj) {
+            std::shared_ptr<log_entry> entry = std::make_shared<log_entry>(1, payload);
+            store.append(entry);
+        }
+        store.end_of_append_batch(start, cnt);
+    }
+    TestSuite::_msg("%-24s %s\n", desc, ops_str(num, size, timer.getTimeUs()).c_str());
+}
+
+// Read logs in batches of `BATCH_SIZE`, as Raft does for replication.
+void read_logs(log_store& store, size_t size, const char* desc) {
+    uint64_t start = store.start_index();
+    uint64_t end = store.next_slot();
+
+    TestSuite::Timer timer;
+    for (uint64_t ii = start; ii < end; ii += BATCH_SIZE) {
+        store.log_entries(ii, std::min(ii + BATCH_SIZE, end));
+    }
+    TestSuite::_msg(
+        "%-24s %s\n", desc, ops_str(end - start, size, timer.getTimeUs()).c_str());
+}
+
+int append_read_bench(size_t size) {
+    std::string path;
+    TEST_SUITE_PREPARE_PATH(path);
+
+    const size_t TOTAL_BYTES = 64 * 1024 * 1024;
+    size_t num = std::min(TOTAL_BYTES / size, (size_t)100000);
+    TestSuite::_msg("%zu logs, %zu bytes each\n", num, size);
+
+    {
+        inmem_log_store store;
+        append_logs(store, num, size, "in-memory append");
+        read_logs(store, size, "in-memory read");
+    }
+
+    {
+        file_log_store_options opt;
+        opt.sync_on_append_batch_ = false;
+        file_log_store store(path + "_nosync", opt);
+        append_logs(store, num, size, "file append (no sync)");
+        read_logs(store, size, "file read");
+    }
+
+    {
+        // Fewer logs, as it is bounded by the disk latency.
+        file_log_store store(path + "_sync");
+        append_logs(store, std::max(num / 10, BATCH_SIZE), size, "file append (sync)");
+    }
+
+    TEST_SUITE_CLEANUP_PATH();
+    return 0;
+}
+
+} // namespace log_store_bench
+using namespace log_store_bench;
+
+int main(int argc, char** argv) {
+    TestSuite ts(argc, argv);
+
+    ts.options.printTestMessage = true;
+
+    ts.doTest("log store bench",
+              append_read_bench,
+              TestRange<size_t>({64, 1024, 16 * 1024}));
+
+    return 0;
+}
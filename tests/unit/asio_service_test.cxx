@@ -831,6 +831,78 @@ int async_append_handler_test() {
     return 0;
 }
 
+int pipelined_append_test() {
+    reset_log_files();
+
+    std::string s1_addr = "tcp://127.0.0.1:20010";
+    std::string s2_addr = "tcp://127.0.0.1:20020";
+    std::string s3_addr = "tcp://127.0.0.1:20030";
+
+    RaftAsioPkg s1(1, s1_addr);
+    RaftAsioPkg s2(2, s2_addr);
+    RaftAsioPkg s3(3, s3_addr);
+    std::vector<RaftAsioPkg*> pkgs = {&s1, &s2, &s3};
+
+    _msg("launching asio-raft servers\n");
+    CHK_Z(launch_servers(pkgs, false));
+
+    _msg("organizing raft group\n");
+    CHK_Z(make_group(pkgs));
+
+    // Set async and pipelined replication,
+    // one log per request to make multiple requests in flight.
+    for (auto& entry: pkgs) {
+        RaftAsioPkg* pp = entry;
+        raft_params param = pp->raftServer->get_current_params();
+        param.return_method_ = raft_params::async_handler;
+        param.max_append_size_ = 1;
+        param.with_append_pipelining(8, 1024 * 1024);
+        pp->raftServer->update_params(param);
+    }
+
+    // Append messages asynchronously.
+    const size_t NUM = 100;
+    std::list<std::shared_ptr<cmd_result<std::shared_ptr<buffer>>>> handlers;
+    std::list<uint64_t> idx_list;
+    std::mutex idx_list_lock;
+    for (size_t ii = 0; ii < NUM; ++ii) {
+        std::string test_msg = "test" + std::to_string(ii);
+        std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+        msg->put(test_msg);
+        std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> ret =
+            s1.raftServer->append_entries({msg});
+
+        cmd_result<std::shared_ptr<buffer>>::handler_type my_handler =
+            std::bind(async_handler,
+                      &idx_list,
+                      &idx_list_lock,
+                      std::placeholders::_1,
+                      std::placeholders::_2);
+        ret->when_ready(my_handler);
+
+        handlers.push_back(ret);
+    }
+    TestSuite::sleep_sec(1, "replication");
+
+    // Now all async handlers should have result.
+    {
+        std::lock_guard<std::mutex> l(idx_list_lock);
+        CHK_EQ(NUM, idx_list.size());
+    }
+
+    // State machine should be identical.
+    CHK_OK(s2.getTestSm()->isSame(*s1.getTestSm()));
+    CHK_OK(s3.getTestSm()->isSame(*s1.getTestSm()));
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+    TestSuite::sleep_sec(1, "shutting down");
+
+    SimpleLogger::shutdown();
+    return 0;
+}
+
 int async_append_handler_with_order_inversion_test() {
     reset_log_files();
 
@@ -1489,6 +1561,201 @@ int auto_forwarding_test(bool async) {
     return 0;
 }
 
+int auto_forwarding_batch_test(bool async) {
+    reset_log_files();
+
+    std::string s1_addr = "tcp://127.0.0.1:20010";
+    std::string s2_addr = "tcp://127.0.0.1:20020";
+    std::string s3_addr = "tcp://127.0.0.1:20030";
+
+    RaftAsioPkg s1(1, s1_addr);
+    RaftAsioPkg s2(2, s2_addr);
+    RaftAsioPkg s3(3, s3_addr);
+    std::vector<RaftAsioPkg*> pkgs = {&s1, &s2, &s3};
+
+    _msg("launching asio-raft servers\n");
+    CHK_Z(launch_servers(pkgs, false));
+
+    _msg("organizing raft group\n");
+    CHK_Z(make_group(pkgs));
+
+    // Enable batching, with a single batch in flight
+    // so that the requests are gathered.
+    for (auto& entry: pkgs) {
+        RaftAsioPkg* pp = entry;
+        raft_params param = pp->raftServer->get_current_params();
+        param.auto_forwarding_ = true;
+        param.with_auto_forwarding_batching(8, 1);
+        if (async) {
+            param.return_method_ = raft_params::async_handler;
+        }
+        pp->raftServer->update_params(param);
+    }
+
+    // Append messages in parallel into S2 (follower),
+    // odd-numbered threads append two logs at once.
+    struct MsgArgs : TestSuite::ThreadArgs {
+        size_t ii;
+        std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> ret;
+    };
+
+    auto send_msg = [&](TestSuite::ThreadArgs* t_args) -> int {
+        MsgArgs* args = (MsgArgs*)t_args;
+        std::vector<std::shared_ptr<buffer>> logs;
+        std::string test_msg = "test" + std::to_string(args->ii);
+        logs.push_back(buffer::alloc(test_msg.size() + 1));
+        logs.back()->put(test_msg);
+        if (args->ii % 2) {
+            std::string test_msg2 = test_msg + "_2";
+            logs.push_back(buffer::alloc(test_msg2.size() + 1));
+            logs.back()->put(test_msg2);
+        }
+        args->ret = s2.raftServer->append_entries(logs);
+        return 0;
+    };
+
+    const size_t NUM_PARALLEL_MSGS = 50;
+    std::vector<TestSuite::ThreadHolder> th(NUM_PARALLEL_MSGS);
+    std::vector<MsgArgs> m_args(NUM_PARALLEL_MSGS);
+    for (size_t ii = 0; ii < NUM_PARALLEL_MSGS; ++ii) {
+        m_args[ii].ii = ii;
+        th[ii].spawn(&m_args[ii], send_msg, nullptr);
+    }
+    TestSuite::sleep_sec(1, "replication");
+    for (size_t ii = 0; ii < NUM_PARALLEL_MSGS; ++ii) {
+        th[ii].join();
+        CHK_Z(th[ii].getResult());
+    }
+
+    // Each handler should have the result of its own last log.
+    for (size_t ii = 0; ii < NUM_PARALLEL_MSGS; ++ii) {
+        std::string test_msg = "test" + std::to_string(ii);
+        if (ii % 2) test_msg += "_2";
+        uint64_t log_idx = s1.getTestSm()->isCommitted(test_msg);
+        CHK_GT(log_idx, 0);
+
+        std::shared_ptr<cmd_result<std::shared_ptr<buffer>>>& handler = m_args[ii].ret;
+        CHK_NONNULL(handler);
+        std::shared_ptr<buffer> h_result = handler->get();
+        CHK_TRUE(handler->get_accepted());
+        CHK_EQ(cmd_result_code::OK, handler->get_result_code());
+        CHK_NONNULL(h_result);
+        CHK_EQ(8, h_result->size());
+        buffer_serializer bs(h_result);
+        CHK_EQ(log_idx, bs.get_u64());
+    }
+
+    // State machine should be identical.
+    CHK_OK(s2.getTestSm()->isSame(*s1.getTestSm()));
+    CHK_OK(s3.getTestSm()->isSame(*s1.getTestSm()));
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+    TestSuite::sleep_sec(1, "shutting down");
+
+    SimpleLogger::shutdown();
+    return 0;
+}
+
+int auto_forwarding_batch_empty_req_test(bool async) {
+    reset_log_files();
+
+    std::string s1_addr = "tcp://127.0.0.1:20010";
+    std::string s2_addr = "tcp://127.0.0.1:20020";
+    std::string s3_addr = "tcp://127.0.0.1:20030";
+
+    RaftAsioPkg s1(1, s1_addr);
+    RaftAsioPkg s2(2, s2_addr);
+    RaftAsioPkg s3(3, s3_addr);
+    std::vector<RaftAsioPkg*> pkgs = {&s1, &s2, &s3};
+
+    _msg("launching asio-raft servers\n");
+    CHK_Z(launch_servers(pkgs, false));
+
+    _msg("organizing raft group\n");
+    CHK_Z(make_group(pkgs));
+
+    if (async) {
+        for (auto& entry: pkgs) {
+            RaftAsioPkg* pp = entry;
+            raft_params param = pp->raftServer->get_current_params();
+            param.return_method_ = raft_params::async_handler;
+            pp->raftServer->update_params(param);
+        }
+    }
+
+    // Batch of 3 requests from S2 to the leader, the second one is empty.
+    const std::vector<uint32_t> counts = {1, 0, 2};
+    std::shared_ptr<buffer> header =
+        buffer::alloc(sizeof(uint8_t) + sizeof(uint32_t) * (counts.size() + 1));
+    buffer_serializer bs_header(header);
+    bs_header.put_u8(0);
+    bs_header.put_u32(counts.size());
+    std::shared_ptr<req_msg> req = std::make_shared<req_msg>(
+        0, msg_type::client_batch_request, 2, 1, 0, 0, 0);
+    req->log_entries().push_back(
+        std::make_shared<log_entry>(0, header, log_val_type::custom));
+    std::vector<std::string> test_msgs;
+    for (uint32_t cnt: counts) {
+        bs_header.put_u32(cnt);
+        for (uint32_t ii = 0; ii < cnt; ++ii) {
+            test_msgs.push_back("test" + std::to_string(test_msgs.size()));
+            std::shared_ptr<buffer> msg = buffer::alloc(test_msgs.back().size() + 1);
+            msg->put(test_msgs.back());
+            msg->pos(0);
+            req->log_entries().push_back(
+                std::make_shared<log_entry>(0, msg, log_val_type::app_log));
+        }
+    }
+
+    std::shared_ptr<rpc_client> cli = s2.asioSvc->create_client(s1_addr);
+    EventAwaiter ea;
+    std::shared_ptr<resp_msg> b_resp;
+    rpc_handler handler = [&](std::shared_ptr<resp_msg>& resp,
+                              std::shared_ptr<rpc_exception>& err) {
+        if (!err) b_resp = resp;
+        ea.invoke();
+    };
+    cli->send(req, handler);
+    ea.wait_ms(5000);
+
+    // Leader should return one result for each request.
+    CHK_NONNULL(b_resp.get());
+    std::shared_ptr<buffer> ctx = b_resp->get_ctx();
+    CHK_NONNULL(ctx.get());
+    ctx->pos(0);
+    buffer_serializer bs(ctx);
+    bs.get_u8();
+    CHK_EQ(counts.size(), bs.get_u32());
+    for (uint32_t cnt: counts) {
+        bool accepted = (bs.get_u8() != 0);
+        cmd_result_code code = static_cast<cmd_result_code>(bs.get_i32());
+        size_t len = 0;
+        bs.get_bytes(len);
+        if (cnt) {
+            CHK_TRUE(accepted);
+            CHK_TRUE(code == cmd_result_code::OK);
+        } else {
+            CHK_FALSE(accepted);
+            CHK_TRUE(code == cmd_result_code::BAD_REQUEST);
+        }
+    }
+
+    // Logs of the other requests should be committed.
+    for (const std::string& test_msg: test_msgs) {
+        CHK_GT(s1.getTestSm()->isCommitted(test_msg), 0);
+    }
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+    TestSuite::sleep_sec(1, "shutting down");
+
+    SimpleLogger::shutdown();
+    return 0;
+}
+
 int enforced_state_machine_catchup_test() {
     reset_log_files();
 
@@ -2454,74 +2721,66 @@ int parallel_log_append_test() {
     return 0;
 }
 
-int custom_resolver_test() {
+int parallel_log_append_deferred_resp_test() {
     reset_log_files();
 
-    std::string s1_addr = "S1:1234";
-    std::string s2_addr = "S2:1234";
-    std::string s3_addr = "S3:1234";
+    std::string s1_addr = "tcp://127.0.0.1:20010";
+    std::string s2_addr = "tcp://127.0.0.1:20020";
+    std::string s3_addr = "tcp://127.0.0.1:20030";
 
     RaftAsioPkg s1(1, s1_addr);
     RaftAsioPkg s2(2, s2_addr);
     RaftAsioPkg s3(3, s3_addr);
     std::vector<RaftAsioPkg*> pkgs = {&s1, &s2, &s3};
 
-    // Enable custom resolver.
-    s1.useCustomResolver = s2.useCustomResolver = s3.useCustomResolver = true;
-
     _msg("launching asio-raft servers\n");
     CHK_Z(launch_servers(pkgs, false));
 
     _msg("organizing raft group\n");
     CHK_Z(make_group(pkgs));
 
-    // Set async mode.
+    // Set disk delay (10ms for S1, 1s for S2 and S3).
+    s1.getTestMgr()->set_disk_delay(s1.raftServer.get(), 10);
+    s2.getTestMgr()->set_disk_delay(s2.raftServer.get(), 1000);
+    s3.getTestMgr()->set_disk_delay(s3.raftServer.get(), 1000);
+
     for (auto& entry: pkgs) {
         RaftAsioPkg* pp = entry;
         raft_params param = pp->raftServer->get_current_params();
         param.return_method_ = raft_params::async_handler;
+        param.parallel_log_appending_ = true;
+        // Disk is slower than the election timeout.
+        param.with_election_timeout_lower(RaftAsioPkg::HEARTBEAT_MS * 30);
+        param.with_election_timeout_upper(RaftAsioPkg::HEARTBEAT_MS * 40);
         pp->raftServer->update_params(param);
     }
 
-    // Append messages asynchronously.
-    const size_t NUM = 10;
-    std::list<std::shared_ptr<cmd_result<std::shared_ptr<buffer>>>> handlers;
-    std::list<uint64_t> idx_list;
-    std::mutex idx_list_lock;
-    auto do_async_append = [&]() {
-        handlers.clear();
-        idx_list.clear();
-        for (size_t ii = 0; ii < NUM; ++ii) {
-            std::string test_msg = "test" + std::to_string(ii);
-            std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
-            msg->put(test_msg);
-            std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> ret =
-                s1.raftServer->append_entries({msg});
+    std::string test_msg = "test";
+    std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+    msg->put(test_msg);
+    std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> ret =
+        s1.raftServer->append_entries({msg});
+    CHK_TRUE(ret->get_accepted());
 
-            cmd_result<std::shared_ptr<buffer>>::handler_type my_handler =
-                std::bind(async_handler,
-                          &idx_list,
-                          &idx_list_lock,
-                          std::placeholders::_1,
-                          std::placeholders::_2);
-            ret->when_ready(my_handler);
+    TestSuite::sleep_ms(200, "wait for replication");
 
-            handlers.push_back(ret);
-        }
-    };
-    do_async_append();
+    // Logs are not durable in followers yet.
+    uint64_t last_idx = s1.getTestMgr()->load_log_store()->next_slot() - 1;
+    CHK_EQ(last_idx, s2.getTestMgr()->load_log_store()->next_slot() - 1);
+    CHK_SM(s2.getTestMgr()->load_log_store()->last_durable_index(), last_idx);
+    CHK_SM(s1.raftServer->get_committed_log_idx(), last_idx);
 
-    TestSuite::sleep_sec(1, "wait for replication");
+    // Follower should not hold the lock while waiting for the durability.
+    TestSuite::Timer timer;
+    s2.raftServer->get_peer_info_all();
+    CHK_SM(timer.getTimeMs(), 100);
 
-    // Now all async handlers should have result.
-    {
-        std::lock_guard<std::mutex> l(idx_list_lock);
-        CHK_EQ(NUM, idx_list.size());
-    }
+    TestSuite::sleep_ms(1500, "wait for disk delay");
 
-    // State machine should be identical.
-    CHK_OK(s2.getTestSm()->isSame(*s1.getTestSm()));
-    CHK_OK(s3.getTestSm()->isSame(*s1.getTestSm()));
+    // Deferred responses should have been sent.
+    CHK_EQ(last_idx, s2.getTestMgr()->load_log_store()->last_durable_index());
+    CHK_EQ(last_idx, s1.raftServer->get_committed_log_idx());
+    CHK_EQ(cmd_result_code::OK, ret->get_result_code());
 
     s1.raftServer->shutdown();
     s2.raftServer->shutdown();
@@ -2532,7 +2791,7 @@ int custom_resolver_test() {
     return 0;
 }
 
-int log_timestamp_test() {
+int parallel_log_append_durable_commit_test() {
     reset_log_files();
 
     std::string s1_addr = "tcp://127.0.0.1:20010";
@@ -2544,41 +2803,493 @@ int log_timestamp_test() {
     RaftAsioPkg s3(3, s3_addr);
     std::vector<RaftAsioPkg*> pkgs = {&s1, &s2, &s3};
 
-    // Enable log entry timestamp replication.
-    s1.useLogTimestamp = s2.useLogTimestamp = s3.useLogTimestamp = true;
-
     _msg("launching asio-raft servers\n");
     CHK_Z(launch_servers(pkgs, false));
 
     _msg("organizing raft group\n");
     CHK_Z(make_group(pkgs));
 
-    // Set async mode.
+    // Set disk delay (10ms for all).
+    s1.getTestMgr()->set_disk_delay(s1.raftServer.get(), 10);
+    s2.getTestMgr()->set_disk_delay(s2.raftServer.get(), 10);
+    s3.getTestMgr()->set_disk_delay(s3.raftServer.get(), 10);
+
     for (auto& entry: pkgs) {
         RaftAsioPkg* pp = entry;
         raft_params param = pp->raftServer->get_current_params();
         param.return_method_ = raft_params::async_handler;
-        param.reserved_log_items_ = 100;
+        param.parallel_log_appending_ = true;
+        // Disk is slower than the election timeout.
+        param.with_election_timeout_lower(RaftAsioPkg::HEARTBEAT_MS * 30);
+        param.with_election_timeout_upper(RaftAsioPkg::HEARTBEAT_MS * 40);
+        // To send the new commit index to S2 while its responses are deferred.
+        param.with_append_pipelining(4);
         pp->raftServer->update_params(param);
     }
 
-    // Append messages asynchronously.
-    const size_t NUM = 5;
-    std::list<std::shared_ptr<cmd_result<std::shared_ptr<buffer>>>> handlers;
-    std::list<uint64_t> idx_list;
-    std::mutex idx_list_lock;
-    auto do_async_append = [&](RaftAsioPkg& target_srv) {
-        handlers.clear();
-        idx_list.clear();
-        for (size_t ii = 0; ii < NUM; ++ii) {
-            std::string test_msg = "test" + std::to_string(ii);
-            std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
-            msg->put(test_msg);
-            std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> ret =
-                target_srv.raftServer->append_entries({msg});
-
-            cmd_result<std::shared_ptr<buffer>>::handler_type my_handler =
-                std::bind(async_handler,
+    std::string test_msg = "test";
+    std::vector<std::shared_ptr<cmd_result<std::shared_ptr<buffer>>>> rets;
+    auto append_msg = [&]() {
+        std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+        msg->put(test_msg);
+        rets.push_back(s1.raftServer->append_entries({msg}));
+    };
+
+    // Pipelining starts after the first accepted response.
+    append_msg();
+    CHK_TRUE(rets.back()->get_accepted());
+    TestSuite::sleep_ms(200, "wait for replication");
+
+    // Make S2's disk slow (2s), so that the leader commits
+    // long before S2's logs are durable.
+    s2.getTestMgr()->set_disk_delay(s2.raftServer.get(), 2000);
+
+    for (size_t ii = 0; ii < 3; ++ii) {
+        append_msg();
+        CHK_TRUE(rets.back()->get_accepted());
+        TestSuite::sleep_ms(200, "wait for commit");
+    }
+
+    // Leader committed all logs, but they are not durable in S2 yet.
+    uint64_t last_idx = s1.getTestMgr()->load_log_store()->next_slot() - 1;
+    CHK_EQ(last_idx, s1.raftServer->get_committed_log_idx());
+    CHK_EQ(last_idx, s2.getTestMgr()->load_log_store()->next_slot() - 1);
+
+    // S2 should not commit the logs that are not durable,
+    // even though it knows the leader's commit index.
+    uint64_t s2_commit_idx = s2.raftServer->get_committed_log_idx();
+    uint64_t s2_durable_idx = s2.getTestMgr()->load_log_store()->last_durable_index();
+    CHK_SM(s2_durable_idx, last_idx);
+    CHK_GT(s2.raftServer->get_leader_committed_log_idx(), s2_durable_idx);
+    CHK_SM(s2_commit_idx, s2_durable_idx + 1);
+
+    TestSuite::sleep_ms(3000, "wait for disk delay");
+
+    // All logs should be durable and committed in S2.
+    CHK_EQ(last_idx, s2.getTestMgr()->load_log_store()->last_durable_index());
+    CHK_EQ(last_idx, s2.raftServer->get_committed_log_idx());
+    for (auto& ret: rets) {
+        CHK_EQ(cmd_result_code::OK, ret->get_result_code());
+    }
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+    TestSuite::sleep_sec(1, "shutting down");
+
+    SimpleLogger::shutdown();
+    return 0;
+}
+
+int control_connection_test() {
+    reset_log_files();
+
+    std::string s1_addr = "tcp://127.0.0.1:20010";
+    std::string s2_addr = "tcp://127.0.0.1:20020";
+    std::string s3_addr = "tcp://127.0.0.1:20030";
+
+    RaftAsioPkg s1(1, s1_addr);
+    RaftAsioPkg s2(2, s2_addr);
+    RaftAsioPkg s3(3, s3_addr);
+    std::vector<RaftAsioPkg*> pkgs = {&s1, &s2, &s3};
+
+    _msg("launching asio-raft servers\n");
+    CHK_Z(launch_servers(pkgs, false));
+
+    _msg("organizing raft group\n");
+    CHK_Z(make_group(pkgs));
+
+    for (auto& entry: pkgs) {
+        RaftAsioPkg* pp = entry;
+        raft_params param = pp->raftServer->get_current_params();
+        param.return_method_ = raft_params::async_handler;
+        param.parallel_log_appending_ = true;
+        param.use_control_connection_ = true;
+        pp->raftServer->update_params(param);
+    }
+
+    // Followers hold the responses of append entries much longer than
+    // election timeout, so that data connections are busy.
+    s1.getTestMgr()->set_disk_delay(s1.raftServer.get(), 10);
+    s2.getTestMgr()->set_disk_delay(s2.raftServer.get(), 2000);
+    s3.getTestMgr()->set_disk_delay(s3.raftServer.get(), 2000);
+
+    uint64_t term = s1.raftServer->get_term();
+    std::string test_msg = "test";
+    std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+    msg->put(test_msg);
+    std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> ret =
+        s1.raftServer->append_entries({msg});
+    CHK_TRUE(ret->get_accepted());
+
+    TestSuite::sleep_ms(1000, "data connections are busy");
+
+    // Not committed yet, but heartbeats through control connection
+    // should prevent followers from starting election.
+    uint64_t last_idx = s1.getTestMgr()->load_log_store()->next_slot() - 1;
+    CHK_SM(s1.raftServer->get_committed_log_idx(), last_idx);
+    CHK_TRUE(s1.raftServer->is_leader());
+    CHK_EQ(term, s1.raftServer->get_term());
+    CHK_EQ(term, s2.raftServer->get_term());
+    CHK_EQ(term, s3.raftServer->get_term());
+    CHK_EQ(1, s2.raftServer->get_leader());
+    CHK_EQ(1, s3.raftServer->get_leader());
+
+    TestSuite::sleep_ms(1500, "wait for disk delay");
+    CHK_EQ(last_idx, s1.raftServer->get_committed_log_idx());
+    CHK_EQ(cmd_result_code::OK, ret->get_result_code());
+    CHK_TRUE(s1.raftServer->is_leader());
+    CHK_EQ(term, s1.raftServer->get_term());
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+    TestSuite::sleep_sec(1, "shutting down");
+
+    SimpleLogger::shutdown();
+    return 0;
+}
+
+int striped_replication_test(bool enable_ssl) {
+    reset_log_files();
+
+    std::string s1_addr = "tcp://127.0.0.1:20010";
+    std::string s2_addr = "tcp://127.0.0.1:20020";
+    std::string s3_addr = "tcp://127.0.0.1:20030";
+
+    RaftAsioPkg s1(1, s1_addr);
+    RaftAsioPkg s2(2, s2_addr);
+    RaftAsioPkg s3(3, s3_addr);
+    std::vector<RaftAsioPkg*> pkgs = {&s1, &s2, &s3};
+
+    _msg("launching asio-raft servers\n");
+    CHK_Z(launch_servers(pkgs, enable_ssl));
+
+    // Should be set before creating peers.
+    for (auto& entry: pkgs) {
+        RaftAsioPkg* pp = entry;
+        raft_params param = pp->raftServer->get_current_params();
+        param.return_method_ = raft_params::async_handler;
+        // One log per request, to make multiple requests in flight.
+        param.max_append_size_ = 1;
+        param.with_append_pipelining(8);
+        param.data_connections_per_peer_ = 4;
+        pp->raftServer->update_params(param);
+    }
+
+    _msg("organizing raft group\n");
+    CHK_Z(make_group(pkgs));
+
+    const size_t NUM = 200;
+    std::list<std::shared_ptr<cmd_result<std::shared_ptr<buffer>>>> handlers;
+    for (size_t ii = 0; ii < NUM; ++ii) {
+        std::string test_msg = "test" + std::to_string(ii);
+        std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+        msg->put(test_msg);
+        handlers.push_back(s1.raftServer->append_entries({msg}));
+    }
+    TestSuite::sleep_sec(2, "replication");
+
+    for (auto& handler: handlers) {
+        CHK_TRUE(handler->has_result());
+        CHK_EQ(cmd_result_code::OK, handler->get_result_code());
+    }
+
+    // All logs should be in the same order.
+    uint64_t last_idx = s1.getTestMgr()->load_log_store()->next_slot() - 1;
+    CHK_EQ(last_idx, s1.raftServer->get_committed_log_idx());
+    CHK_EQ(last_idx, s2.raftServer->get_committed_log_idx());
+    CHK_EQ(last_idx, s3.raftServer->get_committed_log_idx());
+    CHK_OK(s2.getTestSm()->isSame(*s1.getTestSm()));
+    CHK_OK(s3.getTestSm()->isSame(*s1.getTestSm()));
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+    TestSuite::sleep_sec(1, "shutting down");
+
+    SimpleLogger::shutdown();
+    return 0;
+}
+
+int coalesced_io_test(bool enable_ssl) {
+    reset_log_files();
+
+    std::string s1_addr = "tcp://127.0.0.1:20010";
+    std::string s2_addr = "tcp://127.0.0.1:20020";
+    std::string s3_addr = "tcp://127.0.0.1:20030";
+
+    RaftAsioPkg s1(1, s1_addr);
+    RaftAsioPkg s2(2, s2_addr);
+    RaftAsioPkg s3(3, s3_addr);
+    std::vector<RaftAsioPkg*> pkgs = {&s1, &s2, &s3};
+
+    for (auto& entry: pkgs) {
+        RaftAsioPkg* pp = entry;
+        pp->useMultiplexedRpc = true;
+        // Smallest read buffer, so that messages are split across reads,
+        // and large payloads bypass the buffer.
+        pp->readBufferSize = 1;
+        pp->maxCoalescedMsgs = 16;
+    }
+
+    _msg("launching asio-raft servers\n");
+    CHK_Z(launch_servers(pkgs, enable_ssl));
+
+    for (auto& entry: pkgs) {
+        RaftAsioPkg* pp = entry;
+        raft_params param = pp->raftServer->get_current_params();
+        param.return_method_ = raft_params::async_handler;
+        param.max_append_size_ = 4;
+        param.with_append_pipelining(8);
+        // Keep all logs, so that followers catch up by replication,
+        // not by snapshot.
+        param.reserved_log_items_ = 1000;
+        pp->raftServer->update_params(param);
+    }
+
+    _msg("organizing raft group\n");
+    CHK_Z(make_group(pkgs));
+
+    // Mix of small and large (greater than the read buffer) logs.
+    const size_t NUM = 300;
+    std::list<std::shared_ptr<cmd_result<std::shared_ptr<buffer>>>> handlers;
+    for (size_t ii = 0; ii < NUM; ++ii) {
+        std::string test_msg = "test" + std::to_string(ii);
+        test_msg += std::string((ii * 37) % 3000, 'x');
+        std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+        msg->put(test_msg);
+        handlers.push_back(s1.raftServer->append_entries({msg}));
+    }
+    TestSuite::sleep_sec(2, "replication");
+
+    for (auto& handler: handlers) {
+        CHK_TRUE(handler->has_result());
+        CHK_EQ(cmd_result_code::OK, handler->get_result_code());
+    }
+
+    uint64_t last_idx = s1.getTestMgr()->load_log_store()->next_slot() - 1;
+    CHK_EQ(last_idx, s1.raftServer->get_committed_log_idx());
+    CHK_EQ(last_idx, s2.raftServer->get_committed_log_idx());
+    CHK_EQ(last_idx, s3.raftServer->get_committed_log_idx());
+    CHK_OK(s2.getTestSm()->isSame(*s1.getTestSm()));
+    CHK_OK(s3.getTestSm()->isSame(*s1.getTestSm()));
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+    TestSuite::sleep_sec(1, "shutting down");
+
+    SimpleLogger::shutdown();
+    return 0;
+}
+
+int resolver_cache_test() {
+    // Slow custom resolver: "bad" fails, the others go to a port
+    // that nobody listens to.
+    const size_t RESOLVE_DELAY_MS = 200;
+    std::mutex calls_lock;
+    std::map<std::string, size_t> num_calls;
+    asio_service::options opt;
+    opt.thread_pool_size_ = 2;
+    opt.resolver_cache_ttl_ms_ = 60 * 1000;
+    opt.resolver_negative_ttl_ms_ = 500;
+    opt.custom_resolver_ = [&](const std::string& host,
+                               const std::string& port,
+                               asio_service_custom_resolver_response when_done) {
+        {
+            std::lock_guard<std::mutex> l(calls_lock);
+            num_calls[host]++;
+        }
+        TestSuite::sleep_ms(RESOLVE_DELAY_MS);
+        if (host == "bad") {
+            when_done("", "", std::make_error_code(std::errc::host_unreachable));
+        } else {
+            when_done("127.0.0.1", "20090", std::error_code());
+        }
+    };
+    auto get_calls = [&](const std::string& host) -> size_t {
+        std::lock_guard<std::mutex> l(calls_lock);
+        return num_calls[host];
+    };
+
+    std::shared_ptr<asio_service> asio_svc = std::make_shared<asio_service>(opt, nullptr);
+
+    // Send a request by a new client, and return the time until it fails.
+    auto send_req = [&](const std::string& endpoint) -> uint64_t {
+        std::shared_ptr<rpc_client> cli = asio_svc->create_client(endpoint);
+        std::shared_ptr<req_msg> req = std::make_shared<req_msg>(
+            1, msg_type::append_entries_request, 1, 2, 0, 0, 0);
+        EventAwaiter ea;
+        std::atomic<bool> got_error(false);
+        rpc_handler handler = [&](std::shared_ptr<resp_msg>& resp,
+                                  std::shared_ptr<rpc_exception>& err) {
+            got_error = (!resp && err);
+            ea.invoke();
+        };
+        TestSuite::Timer timer;
+        cli->send(req, handler);
+        ea.wait_ms(5000);
+        uint64_t elapsed_ms = timer.getTimeMs();
+        return got_error ? elapsed_ms : 5000;
+    };
+
+    // First connection waits for the resolver.
+    CHK_GTEQ(send_req("good:1234"), RESOLVE_DELAY_MS);
+    CHK_EQ(1, get_calls("good"));
+
+    // The next ones use the cached address immediately, while the address
+    // is refreshed in background due to the connection failure.
+    CHK_SM(send_req("good:1234"), RESOLVE_DELAY_MS);
+    CHK_SM(send_req("good:1234"), RESOLVE_DELAY_MS);
+    TestSuite::sleep_ms(RESOLVE_DELAY_MS * 2, "refresh");
+    CHK_GT(get_calls("good"), 1);
+    CHK_SM(get_calls("good"), 4);
+
+    // Failure is cached as well.
+    CHK_GTEQ(send_req("bad:1234"), RESOLVE_DELAY_MS);
+    CHK_SM(send_req("bad:1234"), RESOLVE_DELAY_MS);
+    CHK_EQ(1, get_calls("bad"));
+
+    // Once the negative cache expires, resolve again.
+    TestSuite::sleep_ms(600, "negative cache expiry");
+    CHK_GTEQ(send_req("bad:1234"), RESOLVE_DELAY_MS);
+    CHK_EQ(2, get_calls("bad"));
+
+    asio_svc->stop();
+    size_t count = 0;
+    while (asio_svc->get_active_workers() && count < 500) {
+        TestSuite::sleep_ms(10);
+        count++;
+    }
+    return 0;
+}
+
+int custom_resolver_test() {
+    reset_log_files();
+
+    std::string s1_addr = "S1:1234";
+    std::string s2_addr = "S2:1234";
+    std::string s3_addr = "S3:1234";
+
+    RaftAsioPkg s1(1, s1_addr);
+    RaftAsioPkg s2(2, s2_addr);
+    RaftAsioPkg s3(3, s3_addr);
+    std::vector<RaftAsioPkg*> pkgs = {&s1, &s2, &s3};
+
+    // Enable custom resolver.
+    s1.useCustomResolver = s2.useCustomResolver = s3.useCustomResolver = true;
+
+    _msg("launching asio-raft servers\n");
+    CHK_Z(launch_servers(pkgs, false));
+
+    _msg("organizing raft group\n");
+    CHK_Z(make_group(pkgs));
+
+    // Set async mode.
+    for (auto& entry: pkgs) {
+        RaftAsioPkg* pp = entry;
+        raft_params param = pp->raftServer->get_current_params();
+        param.return_method_ = raft_params::async_handler;
+        pp->raftServer->update_params(param);
+    }
+
+    // Append messages asynchronously.
+    const size_t NUM = 10;
+    std::list<std::shared_ptr<cmd_result<std::shared_ptr<buffer>>>> handlers;
+    std::list<uint64_t> idx_list;
+    std::mutex idx_list_lock;
+    auto do_async_append = [&]() {
+        handlers.clear();
+        idx_list.clear();
+        for (size_t ii = 0; ii < NUM; ++ii) {
+            std::string test_msg = "test" + std::to_string(ii);
+            std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+            msg->put(test_msg);
+            std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> ret =
+                s1.raftServer->append_entries({msg});
+
+            cmd_result<std::shared_ptr<buffer>>::handler_type my_handler =
+                std::bind(async_handler,
+                          &idx_list,
+                          &idx_list_lock,
+                          std::placeholders::_1,
+                          std::placeholders::_2);
+            ret->when_ready(my_handler);
+
+            handlers.push_back(ret);
+        }
+    };
+    do_async_append();
+
+    TestSuite::sleep_sec(1, "wait for replication");
+
+    // Now all async handlers should have result.
+    {
+        std::lock_guard<std::mutex> l(idx_list_lock);
+        CHK_EQ(NUM, idx_list.size());
+    }
+
+    // State machine should be identical.
+    CHK_OK(s2.getTestSm()->isSame(*s1.getTestSm()));
+    CHK_OK(s3.getTestSm()->isSame(*s1.getTestSm()));
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+    TestSuite::sleep_sec(1, "shutting down");
+
+    SimpleLogger::shutdown();
+    return 0;
+}
+
+int log_timestamp_test() {
+    reset_log_files();
+
+    std::string s1_addr = "tcp://127.0.0.1:20010";
+    std::string s2_addr = "tcp://127.0.0.1:20020";
+    std::string s3_addr = "tcp://127.0.0.1:20030";
+
+    RaftAsioPkg s1(1, s1_addr);
+    RaftAsioPkg s2(2, s2_addr);
+    RaftAsioPkg s3(3, s3_addr);
+    std::vector<RaftAsioPkg*> pkgs = {&s1, &s2, &s3};
+
+    // Enable log entry timestamp replication.
+    s1.useLogTimestamp = s2.useLogTimestamp = s3.useLogTimestamp = true;
+
+    _msg("launching asio-raft servers\n");
+    CHK_Z(launch_servers(pkgs, false));
+
+    _msg("organizing raft group\n");
+    CHK_Z(make_group(pkgs));
+
+    // Set async mode.
+    for (auto& entry: pkgs) {
+        RaftAsioPkg* pp = entry;
+        raft_params param = pp->raftServer->get_current_params();
+        param.return_method_ = raft_params::async_handler;
+        param.reserved_log_items_ = 100;
+        pp->raftServer->update_params(param);
+    }
+
+    // Append messages asynchronously.
+    const size_t NUM = 5;
+    std::list<std::shared_ptr<cmd_result<std::shared_ptr<buffer>>>> handlers;
+    std::list<uint64_t> idx_list;
+    std::mutex idx_list_lock;
+    auto do_async_append = [&](RaftAsioPkg& target_srv) {
+        handlers.clear();
+        idx_list.clear();
+        for (size_t ii = 0; ii < NUM; ++ii) {
+            std::string test_msg = "test" + std::to_string(ii);
+            std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+            msg->put(test_msg);
+            std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> ret =
+                target_srv.raftServer->append_entries({msg});
+
+            cmd_result<std::shared_ptr<buffer>>::handler_type my_handler =
+                std::bind(async_handler,
                           &idx_list,
                           &idx_list_lock,
                           std::placeholders::_1,
@@ -2688,6 +3399,309 @@ int log_timestamp_test() {
 } // namespace asio_service_test
 using namespace asio_service_test;
 
+int multiplexed_rpc_test(bool with_meta) {
+    reset_log_files();
+
+    std::string s1_addr = "tcp://127.0.0.1:20010";
+    std::string s2_addr = "tcp://127.0.0.1:20020";
+    std::string s3_addr = "tcp://127.0.0.1:20030";
+
+    RaftAsioPkg s1(1, s1_addr);
+    RaftAsioPkg s2(2, s2_addr);
+    RaftAsioPkg s3(3, s3_addr);
+    std::vector<RaftAsioPkg*> pkgs = {&s1, &s2, &s3};
+
+    std::atomic<size_t> num_resp_meta(0);
+    for (auto& entry: pkgs) {
+        RaftAsioPkg* pp = entry;
+        pp->useMultiplexedRpc = true;
+        if (with_meta) {
+            pp->setMetaCallback(
+                nullptr,
+                nullptr,
+                [&](const asio_service::meta_cb_params& params,
+                    const std::string& meta) -> bool {
+                    // Should be matched with the original request.
+                    if (meta != std::to_string(params.msg_type_)) return false;
+                    num_resp_meta++;
+                    return true;
+                },
+                [](const asio_service::meta_cb_params& params) -> std::string {
+                    return std::to_string(params.msg_type_);
+                },
+                false);
+        }
+    }
+
+    _msg("launching asio-raft servers\n");
+    CHK_Z(launch_servers(pkgs, false));
+
+    _msg("organizing raft group\n");
+    CHK_Z(make_group(pkgs));
+
+    // Auto-forwarding in async mode, so that the responses of forwarded
+    // requests are returned out of order.
+    for (auto& entry: pkgs) {
+        RaftAsioPkg* pp = entry;
+        raft_params param = pp->raftServer->get_current_params();
+        param.auto_forwarding_ = true;
+        param.auto_forwarding_max_connections_ = 1;
+        param.return_method_ = raft_params::async_handler;
+        pp->raftServer->update_params(param);
+    }
+
+    // Append messages into both leader and follower.
+    const size_t NUM = 20;
+    std::list<std::shared_ptr<cmd_result<std::shared_ptr<buffer>>>> handlers;
+    for (size_t ii = 0; ii < NUM; ++ii) {
+        std::string test_msg = "test" + std::to_string(ii);
+        std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+        msg->put(test_msg);
+        RaftAsioPkg& target = (ii % 2) ? s1 : s2;
+        handlers.push_back(target.raftServer->append_entries({msg}));
+    }
+    TestSuite::sleep_sec(1, "replication");
+
+    // All messages should have been committed in the state machine.
+    for (size_t ii = 0; ii < NUM; ++ii) {
+        std::string test_msg = "test" + std::to_string(ii);
+        CHK_GT(s1.getTestSm()->isCommitted(test_msg), 0);
+    }
+
+    // All handlers should have the result.
+    std::set<uint64_t> commit_results;
+    for (auto& handler: handlers) {
+        CHK_TRUE(handler->has_result());
+        CHK_EQ(cmd_result_code::OK, handler->get_result_code());
+        std::shared_ptr<buffer> h_result = handler->get();
+        CHK_NONNULL(h_result);
+        CHK_EQ(8, h_result->size());
+        buffer_serializer bs(h_result);
+        commit_results.insert(bs.get_u64());
+    }
+    CHK_EQ(NUM, commit_results.size());
+    if (with_meta) {
+        CHK_GT(num_resp_meta.load(), 0);
+    }
+
+    // State machine should be identical.
+    CHK_OK(s2.getTestSm()->isSame(*s1.getTestSm()));
+    CHK_OK(s3.getTestSm()->isSame(*s1.getTestSm()));
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+    TestSuite::sleep_sec(1, "shutting down");
+
+    SimpleLogger::shutdown();
+    return 0;
+}
+
+int sharded_io_context_test() {
+    reset_log_files();
+
+    std::string s1_addr = "tcp://127.0.0.1:20010";
+    std::string s2_addr = "tcp://127.0.0.1:20020";
+    std::string s3_addr = "tcp://127.0.0.1:20030";
+
+    RaftAsioPkg s1(1, s1_addr);
+    RaftAsioPkg s2(2, s2_addr);
+    RaftAsioPkg s3(3, s3_addr);
+    std::vector<RaftAsioPkg*> pkgs = {&s1, &s2, &s3};
+    for (auto& entry: pkgs) {
+        entry->useShardedIo = true;
+    }
+
+    _msg("launching asio-raft servers\n");
+    CHK_Z(launch_servers(pkgs, false));
+
+    _msg("organizing raft group\n");
+    CHK_Z(make_group(pkgs));
+
+    // Append messages into leader, and then follower (auto-forwarding).
+    for (auto& entry: pkgs) {
+        RaftAsioPkg* pp = entry;
+        raft_params param = pp->raftServer->get_current_params();
+        param.auto_forwarding_ = true;
+        pp->raftServer->update_params(param);
+    }
+    const size_t NUM = 10;
+    for (size_t ii = 0; ii < NUM; ++ii) {
+        std::string test_msg = "test" + std::to_string(ii);
+        std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+        msg->put(test_msg);
+        RaftAsioPkg& target = (ii < NUM / 2) ? s1 : s3;
+        auto ret = target.raftServer->append_entries({msg});
+        CHK_TRUE(ret->get_accepted());
+        CHK_EQ(cmd_result_code::OK, ret->get_result_code());
+    }
+
+    // All messages should have been committed in the state machine.
+    for (size_t ii = 0; ii < NUM; ++ii) {
+        std::string test_msg = "test" + std::to_string(ii);
+        CHK_GT(s1.getTestSm()->isCommitted(test_msg), 0);
+    }
+    TestSuite::sleep_ms(RaftAsioPkg::HEARTBEAT_MS * 5, "wait for commit");
+
+    // Leader election should work as well.
+    s2.raftServer->request_leadership();
+    TestSuite::sleep_sec(1, "make S2 leader");
+    CHK_TRUE(s2.raftServer->is_leader());
+
+    // State machine should be identical.
+    CHK_OK(s2.getTestSm()->isSame(*s1.getTestSm()));
+    CHK_OK(s3.getTestSm()->isSame(*s1.getTestSm()));
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+    TestSuite::sleep_sec(1, "shutting down");
+
+    SimpleLogger::shutdown();
+    return 0;
+}
+
+int unix_socket_test(bool abstract_ns) {
+    reset_log_files();
+
+    std::string prefix = abstract_ns ? "unix://@nuraft_test_" : "unix://./nuraft_test_";
+    std::string s1_addr = prefix + "s1.sock";
+    std::string s2_addr = prefix + "s2.sock";
+    std::string s3_addr = prefix + "s3.sock";
+
+    RaftAsioPkg s1(1, s1_addr);
+    RaftAsioPkg s2(2, s2_addr);
+    RaftAsioPkg s3(3, s3_addr);
+    std::vector<RaftAsioPkg*> pkgs = {&s1, &s2, &s3};
+
+    _msg("launching asio-raft servers\n");
+    CHK_Z(launch_servers(pkgs, false));
+
+    _msg("organizing raft group\n");
+    CHK_Z(make_group(pkgs));
+
+    // Append messages into leader, and then follower (auto-forwarding).
+    for (auto& entry: pkgs) {
+        RaftAsioPkg* pp = entry;
+        raft_params param = pp->raftServer->get_current_params();
+        param.auto_forwarding_ = true;
+        pp->raftServer->update_params(param);
+    }
+    const size_t NUM = 10;
+    for (size_t ii = 0; ii < NUM; ++ii) {
+        std::string test_msg = "test" + std::to_string(ii);
+        std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+        msg->put(test_msg);
+        RaftAsioPkg& target = (ii < NUM / 2) ? s1 : s2;
+        auto ret = target.raftServer->append_entries({msg});
+        CHK_TRUE(ret->get_accepted());
+        CHK_EQ(cmd_result_code::OK, ret->get_result_code());
+    }
+    TestSuite::sleep_ms(RaftAsioPkg::HEARTBEAT_MS * 5, "wait for commit");
+
+    // State machine should be identical.
+    CHK_OK(s2.getTestSm()->isSame(*s1.getTestSm()));
+    CHK_OK(s3.getTestSm()->isSame(*s1.getTestSm()));
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+    TestSuite::sleep_sec(1, "shutting down");
+
+    SimpleLogger::shutdown();
+    return 0;
+}
+
+int inproc_rpc_test() {
+    reset_log_files();
+
+    std::string s1_addr = "inproc://s1";
+    std::string s2_addr = "inproc://s2";
+    std::string s3_addr = "inproc://s3";
+
+    RaftAsioPkg s1(1, s1_addr);
+    RaftAsioPkg s2(2, s2_addr);
+    RaftAsioPkg s3(3, s3_addr);
+    std::vector<RaftAsioPkg*> pkgs = {&s1, &s2, &s3};
+
+    std::shared_ptr<inproc_service> inproc_svc = std::make_shared<inproc_service>(2);
+    for (auto& entry: pkgs) {
+        entry->inprocSvc = inproc_svc;
+    }
+
+    _msg("launching raft servers\n");
+    CHK_Z(launch_servers(pkgs, false));
+
+    _msg("organizing raft group\n");
+    CHK_Z(make_group(pkgs));
+
+    // Auto-forwarding in async mode.
+    for (auto& entry: pkgs) {
+        RaftAsioPkg* pp = entry;
+        raft_params param = pp->raftServer->get_current_params();
+        param.auto_forwarding_ = true;
+        param.return_method_ = raft_params::async_handler;
+        pp->raftServer->update_params(param);
+    }
+
+    // Append messages into both leader and follower.
+    const size_t NUM = 20;
+    std::list<std::shared_ptr<cmd_result<std::shared_ptr<buffer>>>> handlers;
+    for (size_t ii = 0; ii < NUM; ++ii) {
+        std::string test_msg = "test" + std::to_string(ii);
+        std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+        msg->put(test_msg);
+        RaftAsioPkg& target = (ii % 2) ? s1 : s2;
+        handlers.push_back(target.raftServer->append_entries({msg}));
+    }
+    TestSuite::sleep_sec(1, "replication");
+
+    // All handlers should have the result.
+    std::set<uint64_t> commit_results;
+    for (auto& handler: handlers) {
+        CHK_TRUE(handler->has_result());
+        CHK_EQ(cmd_result_code::OK, handler->get_result_code());
+        std::shared_ptr<buffer> h_result = handler->get();
+        CHK_NONNULL(h_result);
+        CHK_EQ(8, h_result->size());
+        buffer_serializer bs(h_result);
+        commit_results.insert(bs.get_u64());
+    }
+    CHK_EQ(NUM, commit_results.size());
+
+    // Make S2 leader.
+    s2.raftServer->request_leadership();
+    TestSuite::sleep_sec(1, "make S2 leader");
+    CHK_TRUE(s2.raftServer->is_leader());
+
+    // State machine should be identical.
+    CHK_OK(s2.getTestSm()->isSame(*s1.getTestSm()));
+    CHK_OK(s3.getTestSm()->isSame(*s1.getTestSm()));
+
+    // Stop S3's listener, requests to S3 should fail.
+    s3.asioListener->stop();
+    std::shared_ptr<rpc_client> cli = inproc_svc->create_client(s3_addr);
+    CHK_NONNULL(cli);
+    std::shared_ptr<req_msg> req = std::make_shared<req_msg>(
+        1, msg_type::append_entries_request, 2, 3, 0, 0, 0);
+    std::atomic<bool> got_error(false);
+    rpc_handler handler = [&](std::shared_ptr<resp_msg>& resp,
+                              std::shared_ptr<rpc_exception>& err) {
+        got_error = (!resp && err);
+    };
+    cli->send(req, handler);
+    CHK_TRUE(got_error.load());
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+    TestSuite::sleep_sec(1, "shutting down");
+    inproc_svc->stop();
+
+    SimpleLogger::shutdown();
+    return 0;
+}
+
 int main(int argc, char** argv) {
     TestSuite ts(argc, argv);
 
@@ -2711,6 +3725,8 @@ int main(int argc, char** argv) {
 
     ts.doTest("async append handler test", async_append_handler_test);
 
+    ts.doTest("pipelined append test", pipelined_append_test);
+
     ts.doTest("async append handler with order inversion test",
               async_append_handler_with_order_inversion_test);
 
@@ -2729,6 +3745,14 @@ int main(int argc, char** argv) {
     ts.doTest(
         "auto forwarding test", auto_forwarding_test, TestRange<bool>({false, true}));
 
+    ts.doTest("auto forwarding batch test",
+              auto_forwarding_batch_test,
+              TestRange<bool>({false, true}));
+
+    ts.doTest("auto forwarding batch empty request test",
+              auto_forwarding_batch_empty_req_test,
+              TestRange<bool>({false, true}));
+
     ts.doTest("enforced state machine catch-up test",
               enforced_state_machine_catchup_test);
 
@@ -2767,10 +3791,34 @@ int main(int argc, char** argv) {
 
     ts.doTest("parallel log append test", parallel_log_append_test);
 
+    ts.doTest("parallel log append deferred response test",
+              parallel_log_append_deferred_resp_test);
+
+    ts.doTest("parallel log append durable commit test",
+              parallel_log_append_durable_commit_test);
+
     ts.doTest("custom resolver test", custom_resolver_test);
 
     ts.doTest("log timestamp test", log_timestamp_test);
 
+    ts.doTest("multiplexed rpc test", multiplexed_rpc_test, TestRange<bool>({false, true}));
+
+    ts.doTest("sharded io context test", sharded_io_context_test);
+
+    ts.doTest("unix socket test", unix_socket_test, TestRange<bool>({false, true}));
+
+    ts.doTest("inproc rpc test", inproc_rpc_test);
+
+    ts.doTest("control connection test", control_connection_test);
+
+    ts.doTest("striped replication test",
+              striped_replication_test,
+              TestRange<bool>({false, true}));
+
+    ts.doTest("coalesced io test", coalesced_io_test, TestRange<bool>({false, true}));
+
+    ts.doTest("resolver cache test", resolver_cache_test);
+
 #ifdef ENABLE_RAFT_STATS
     _msg("raft stats: ENABLED\n");
 #else
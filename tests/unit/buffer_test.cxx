@@ -25,6 +25,8 @@ limitations under the License.
 #include <cstring>
 #include <random>
 #include <string>
+#include <thread>
+#include <vector>
 
 using namespace nuraft;
 
@@ -254,6 +256,132 @@ int buffer_serializer_test(bool little_endian) {
     return 0;
 }
 
+int buffer_slice_test(size_t slice_size) {
+    // Header + payload, repeated, similar to the log data in RPC message.
+    const size_t HDR_SIZE = 13;
+    const size_t NUM = 3;
+    std::shared_ptr<buffer> src = buffer::alloc((HDR_SIZE + slice_size) * NUM);
+    for (size_t ii = 0; ii < NUM; ++ii) {
+        byte* ptr = src->data_begin() + (HDR_SIZE + slice_size) * ii;
+        std::memset(ptr, 0xff, HDR_SIZE);
+        std::memset(ptr + HDR_SIZE, (int)ii, slice_size);
+    }
+    CHK_GTEQ(HDR_SIZE, buffer::slice_meta_size(slice_size));
+
+    std::vector<std::shared_ptr<buffer>> slices;
+    for (size_t ii = 0; ii < NUM; ++ii) {
+        size_t offset = (HDR_SIZE + slice_size) * ii + HDR_SIZE;
+        slices.push_back(buffer::slice(src, offset, slice_size));
+    }
+    // Slices share the ownership of the source buffer.
+    CHK_EQ(NUM + 1, (size_t)src.use_count());
+    src.reset();
+
+    for (size_t ii = 0; ii < NUM; ++ii) {
+        std::shared_ptr<buffer>& cur = slices[ii];
+        CHK_EQ(slice_size, cur->size());
+        CHK_Z(cur->pos());
+        for (size_t jj = 0; jj < slice_size; ++jj) {
+            CHK_EQ(ii, std::to_integer<size_t>(cur->data_begin()[jj]));
+        }
+
+        // Each slice has its own position.
+        cur->pos(slice_size / 2);
+        CHK_EQ(slice_size / 2, cur->pos());
+    }
+
+    // Out of range.
+    std::shared_ptr<buffer> small = buffer::alloc(16);
+    bool thrown = false;
+    try {
+        buffer::slice(small, 0, 8);
+    } catch (std::out_of_range&) {
+        thrown = true;
+    }
+    CHK_TRUE(thrown);
+    return 0;
+}
+
+int buffer_pool_test(bool pool_enabled) {
+    buffer_pool_options opt = buffer::get_pool_options();
+    buffer_pool_options new_opt = opt;
+    new_opt.enabled_ = pool_enabled;
+    buffer::set_pool_options(new_opt);
+    buffer::purge_pool_cache();
+
+    // Released buffer should be reused by the next allocation
+    // in the same size class.
+    std::shared_ptr<buffer> buf = buffer::alloc(120);
+    std::memset(buf->data_begin(), 0xab, buf->size());
+    buf->pos(60);
+    void* addr = buf.get();
+    buf.reset();
+
+    buf = buffer::alloc(100);
+    CHK_EQ(100, buf->size());
+    CHK_Z(buf->pos());
+    if (pool_enabled) {
+        CHK_EQ(addr, (void*)buf.get());
+    }
+    buf.reset();
+
+    // Big blocks within the pooled range, and beyond.
+    for (size_t size: {0x8000, 0x10000, 0x100000}) {
+        std::shared_ptr<buffer> big = buffer::alloc(size);
+        CHK_EQ(size, big->size());
+        CHK_Z(big->pos());
+        big->put((int32_t)size);
+        big->pos(0);
+        CHK_EQ((int32_t)size, big->get_int());
+    }
+
+    // Nothing should be cached if the limit is zero.
+    new_opt.max_cached_bytes_per_thread_ = 0;
+    buffer::set_pool_options(new_opt);
+    buf = buffer::alloc(100);
+    buf.reset();
+    new_opt.max_cached_bytes_per_thread_ = opt.max_cached_bytes_per_thread_;
+    buffer::set_pool_options(new_opt);
+
+    // Buffers allocated and released by different threads.
+    const size_t NUM_THREADS = 4;
+    const size_t NUM = 10000;
+    std::vector<std::vector<std::shared_ptr<buffer>>> bufs(NUM_THREADS);
+    std::vector<std::thread> threads;
+    for (size_t ii = 0; ii < NUM_THREADS; ++ii) {
+        threads.emplace_back([ii, &bufs]() {
+            for (size_t jj = 0; jj < NUM; ++jj) {
+                std::shared_ptr<buffer> cur = buffer::alloc(jj % 1024 + 8);
+                cur->put((uint64_t)jj);
+                if (jj % 2) bufs[ii].push_back(cur);
+            }
+        });
+    }
+    for (std::thread& tt: threads) tt.join();
+    threads.clear();
+
+    for (size_t ii = 0; ii < NUM_THREADS; ++ii) {
+        threads.emplace_back([ii, &bufs]() {
+            std::vector<std::shared_ptr<buffer>>& list = bufs[(ii + 1) % NUM_THREADS];
+            for (size_t jj = 0; jj < list.size(); ++jj) {
+                list[jj]->pos(0);
+                size_t idx = jj * 2 + 1;
+                if (list[jj]->size() != idx % 1024 + 8) return;
+                if (list[jj]->get_uint64() != idx) return;
+            }
+            list.clear();
+        });
+    }
+    for (std::thread& tt: threads) tt.join();
+    for (size_t ii = 0; ii < NUM_THREADS; ++ii) {
+        CHK_Z(bufs[ii].size());
+    }
+
+    buffer::purge_pool_cache();
+    buffer::set_pool_options(opt);
+    return 0;
+}
+
 } // namespace buffer_test
 using namespace buffer_test;
 
@@ -266,8 +394,14 @@ int main(int argc, char** argv) {
               buffer_basic_test,
               TestRange<size_t>({1024, 0x8000, 0x10000}));
 
+    ts.doTest("buffer slice test",
+              buffer_slice_test,
+              TestRange<size_t>({0, 100, 0x8000, 0x10000}));
+
     ts.doTest(
         "buffer serializer test", buffer_serializer_test, TestRange<bool>({true, false}));
 
+    ts.doTest("buffer pool test", buffer_pool_test, TestRange<bool>({true, false}));
+
     return 0;
 }
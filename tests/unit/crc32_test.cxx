@@ -0,0 +1,96 @@
+/************************************************************************
+Copyright 2017-2019 eBay Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include "crc32.hxx"
+#include "crc32c.hxx"
+
+#include "test_common.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace crc32_test {
+
+int crc32_known_value_test() {
+    std::string str = "123456789";
+    CHK_EQ(0xcbf43926, crc32_8(str.data(), str.size(), 0));
+    CHK_EQ(0xcbf43926, crc32_1(str.data(), str.size(), 0));
+
+    CHK_EQ(0xe3069283, crc32c(str.data(), str.size(), 0));
+    CHK_EQ(0xe3069283, crc32c_sw(str.data(), str.size(), 0));
+
+    // 32 bytes of zeros, from RFC 3720.
+    std::vector<uint8_t> zeros(32, 0x0);
+    CHK_EQ(0x8a9136aa, crc32c(zeros.data(), zeros.size(), 0));
+    CHK_EQ(0x8a9136aa, crc32c_sw(zeros.data(), zeros.size(), 0));
+
+    CHK_EQ((uint32_t)0, crc32c(nullptr, 0, 0));
+    TestSuite::_msg("crc32c implementation: %s\n", crc32c_impl_name());
+    return 0;
+}
+
+int crc32c_hw_sw_test() {
+    std::mt19937 engine(0);
+    std::vector<uint8_t> data(8192 + 16);
+    for (uint8_t& cc: data) cc = (uint8_t)engine();
+
+    // Different lengths and alignments.
+    for (size_t offset = 0; offset < 8; ++offset) {
+        for (size_t len = 0; len < 2400; len += (len < 64 ? 1 : 37)) {
+            uint32_t prev = (uint32_t)engine();
+            CHK_EQ(crc32c_sw(data.data() + offset, len, prev),
+                   crc32c(data.data() + offset, len, prev));
+        }
+    }
+    CHK_EQ(crc32c_sw(data.data(), 8192, 0), crc32c(data.data(), 8192, 0));
+    return 0;
+}
+
+int crc32c_streaming_test() {
+    std::mt19937 engine(1);
+    std::vector<uint8_t> data(10000);
+    for (uint8_t& cc: data) cc = (uint8_t)engine();
+    uint32_t expected = crc32c(data.data(), data.size(), 0);
+
+    for (size_t chunk: {1, 7, 64, 1000, 3333}) {
+        uint32_t crc = 0;
+        uint32_t crc_sw = 0;
+        for (size_t pos = 0; pos < data.size(); pos += chunk) {
+            size_t len = std::min(chunk, data.size() - pos);
+            crc = crc32c(data.data() + pos, len, crc);
+            crc_sw = crc32c_sw(data.data() + pos, len, crc_sw);
+        }
+        CHK_EQ(expected, crc);
+        CHK_EQ(expected, crc_sw);
+    }
+    return 0;
+}
+
+} // namespace crc32_test
+using namespace crc32_test;
+
+int main(int argc, char** argv) {
+    TestSuite ts(argc, argv);
+
+    ts.options.printTestMessage = false;
+
+    ts.doTest("crc32 known value test", crc32_known_value_test);
+    ts.doTest("crc32c hw sw test", crc32c_hw_sw_test);
+    ts.doTest("crc32c streaming test", crc32c_streaming_test);
+
+    return 0;
+}
@@ -29,7 +29,7 @@ using namespace raft_functional_common;
 
 namespace failure_test {
 
-int simple_conflict_test() {
+int simple_conflict_test(size_t log_tail_cache_size) {
     reset_log_files();
     std::shared_ptr<FakeNetworkBase> f_base = std::make_shared<FakeNetworkBase>();
 
@@ -47,6 +47,7 @@ int simple_conflict_test() {
     custom_params.election_timeout_upper_bound_ = 1000;
     custom_params.heart_beat_interval_ = 500;
     custom_params.snapshot_distance_ = 100;
+    custom_params.log_tail_cache_size_ = log_tail_cache_size;
     CHK_Z(launch_servers(pkgs, &custom_params));
     CHK_Z(make_group(pkgs));
 
@@ -185,6 +186,133 @@ int simple_conflict_test() {
     return 0;
 }
 
+int conflict_term_backtracking_test() {
+    reset_log_files();
+    std::shared_ptr<FakeNetworkBase> f_base = std::make_shared<FakeNetworkBase>();
+
+    std::string s1_addr = "S1";
+    std::string s2_addr = "S2";
+    std::string s3_addr = "S3";
+
+    RaftPkg s1(f_base, 1, s1_addr);
+    RaftPkg s2(f_base, 2, s2_addr);
+    RaftPkg s3(f_base, 3, s3_addr);
+    std::vector<RaftPkg*> pkgs = {&s1, &s2, &s3};
+
+    raft_params custom_params;
+    custom_params.election_timeout_lower_bound_ = 0;
+    custom_params.election_timeout_upper_bound_ = 1000;
+    custom_params.heart_beat_interval_ = 500;
+    custom_params.snapshot_distance_ = 0;
+    CHK_Z(launch_servers(pkgs, &custom_params));
+    CHK_Z(make_group(pkgs));
+
+    for (auto& entry: pkgs) {
+        RaftPkg* pp = entry;
+        raft_params param = pp->raftServer->get_current_params();
+        param.return_method_ = raft_params::async_handler;
+        pp->raftServer->update_params(param);
+    }
+
+    auto append_msgs = [](RaftPkg& pkg, const std::string& prefix, size_t num) {
+        for (size_t ii = 0; ii < num; ++ii) {
+            std::string test_msg = prefix + std::to_string(ii);
+            std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+            msg->put(test_msg);
+            pkg.raftServer->append_entries({msg});
+        }
+    };
+
+    const size_t NUM = 10;
+    append_msgs(s1, "test", NUM);
+    for (size_t ii = 0; ii < NUM; ++ii) {
+        s1.fNet->execReqResp();
+    }
+    CHK_Z(wait_for_sm_exec(pkgs, COMMIT_TIMEOUT_SEC));
+    uint64_t idx_before_div = s1.getTestMgr()->load_log_store()->next_slot() - 1;
+
+    // Long divergent suffix of the old term on S1, without replication.
+    const size_t MORE1 = 100;
+    append_msgs(s1, "stale", MORE1);
+
+    s2.dbgLog(" --- S2 will start leader election ---");
+    s2.fTimer->invoke(timer_task_type::election_timer);
+    s3.fTimer->invoke(timer_task_type::election_timer);
+    s2.fNet->execReqResp(s3_addr);
+    s2.fNet->execReqResp(s3_addr);
+    s2.fNet->execReqResp(s3_addr);
+    s2.fNet->execReqResp(s3_addr);
+    CHK_Z(wait_for_sm_exec(pkgs, COMMIT_TIMEOUT_SEC));
+    CHK_TRUE(s2.raftServer->is_leader());
+
+    // S1 is isolated from now on, until S2 is re-elected.
+    auto isolate_s1 = [&]() {
+        s2.fNet->makeReqFailAll(s1_addr);
+        s3.fNet->makeReqFailAll(s1_addr);
+    };
+    isolate_s1();
+    s3.fNet->makeReqFailAll(s2_addr);
+
+    // Logs of the new term on S2, replicated to S3 only.
+    const size_t MORE2 = 150;
+    append_msgs(s2, "new", MORE2);
+    for (size_t ii = 0; ii < 5; ++ii) {
+        s2.fNet->execReqResp(s3_addr);
+        isolate_s1();
+    }
+    CHK_Z(wait_for_sm_exec(pkgs, COMMIT_TIMEOUT_SEC));
+
+    // S2 resigns and becomes the leader again, so that it starts
+    // replication to S1 from its last log, far beyond the divergence.
+    s2.dbgLog(" --- S2 will be re-elected ---");
+    s2.raftServer->yield_leadership(true);
+    CHK_FALSE(s2.raftServer->is_leader());
+    s2.fTimer->invoke(timer_task_type::election_timer);
+    s3.fTimer->invoke(timer_task_type::election_timer);
+    for (size_t ii = 0; ii < 4; ++ii) {
+        s2.fNet->execReqResp(s3_addr);
+        isolate_s1();
+    }
+    CHK_Z(wait_for_sm_exec(pkgs, COMMIT_TIMEOUT_SEC));
+    CHK_TRUE(s2.raftServer->is_leader());
+
+    uint64_t s2_last_idx = s2.getTestMgr()->load_log_store()->next_slot() - 1;
+    uint64_t s1_last_idx = s1.getTestMgr()->load_log_store()->next_slot() - 1;
+    CHK_GT(s2_last_idx, s1_last_idx);
+    CHK_EQ(idx_before_div + MORE1, s1_last_idx);
+
+    // S1's stale requests should be rejected.
+    s1.fNet->execReqResp();
+
+    // S1's rejection carries the conflicting term, so that S2 can skip
+    // all of S1's stale logs at once, instead of one by one.
+    s2.dbgLog(" --- S2 starts to replicate to S1 ---");
+    s2.fTimer->invoke(timer_task_type::heartbeat_timer);
+    const size_t NUM_ROUNDS = 10;
+    for (size_t ii = 0; ii < NUM_ROUNDS; ++ii) {
+        s2.fNet->execReqResp();
+    }
+    CHK_Z(wait_for_sm_exec(pkgs, COMMIT_TIMEOUT_SEC));
+
+    CHK_EQ(s2_last_idx + 1, s1.getTestMgr()->load_log_store()->next_slot());
+    for (size_t ii = 0; ii < MORE2; ++ii) {
+        std::string test_msg = "new" + std::to_string(ii);
+        CHK_GT(s1.getTestSm()->isCommitted(test_msg), 0);
+    }
+    CHK_OK(s1.getTestSm()->isSame(*s2.getTestSm()));
+    CHK_OK(s3.getTestSm()->isSame(*s2.getTestSm()));
+
+    print_stats(pkgs);
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+
+    f_base->destroy();
+
+    return 0;
+}
+
 int rmv_not_resp_srv_wq_test(bool explicit_failure) {
     // * Remove server that is not responding.
     // * Can reach quorum.
@@ -605,7 +733,11 @@ int main(int argc, char** argv) {
     // Disable reconnection timer for deterministic test.
     debugging_options::get_instance().disable_reconn_backoff_ = true;
 
-    ts.doTest("simple conflict test", simple_conflict_test);
+    ts.doTest("simple conflict test",
+              simple_conflict_test,
+              TestRange<size_t>({0, 4}));
+
+    ts.doTest("conflict term backtracking test", conflict_term_backtracking_test);
 
     ts.doTest("remove not responding server with quorum test",
               rmv_not_resp_srv_wq_test,
@@ -0,0 +1,333 @@
+/************************************************************************
+Copyright 2017-2019 eBay Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include "file_log_store.hxx"
+
+#include "test_common.h"
+
+#include <cstring>
+#include <string>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace nuraft;
+
+namespace file_log_store_test {
+
+std::shared_ptr<log_entry> make_entry(uint64_t term, uint64_t idx) {
+    // Payload of various sizes, depending on the index.
+    std::string payload = "log" + std::to_string(idx) + std::string(idx % 37, 'x');
+    std::shared_ptr<buffer> buf = buffer::alloc(payload.size());
+    memcpy(buf->data_begin(), payload.data(), payload.size());
+    return std::make_shared<log_entry>(term, buf);
+}
+
+int check_entry(std::shared_ptr<log_entry> entry, uint64_t term, uint64_t idx) {
+    CHK_NONNULL(entry.get());
+    std::shared_ptr<log_entry> expected = make_entry(term, idx);
+    CHK_EQ(term, entry->get_term());
+    CHK_TRUE(entry->get_val_type() == log_val_type::app_log);
+    CHK_EQ(expected->get_buf().size(), entry->get_buf().size());
+    CHK_Z(memcmp(expected->get_buf().data_begin(),
+                 entry->get_buf().data_begin(),
+                 entry->get_buf().size()));
+    return 0;
+}
+
+// Small segments to test multiple segments.
+file_log_store_options small_segments() {
+    file_log_store_options opt;
+    opt.segment_size_ = 1024;
+    opt.max_entries_per_segment_ = 8;
+    return opt;
+}
+
+int check_logs(file_log_store& store, uint64_t start, uint64_t end, uint64_t term) {
+    for (uint64_t ii = start; ii < end; ++ii) {
+        CHK_EQ(term, store.term_at(ii));
+        CHK_Z(check_entry(store.entry_at(ii), term, ii));
+    }
+    auto entries = store.log_entries(start, end);
+    CHK_NONNULL(entries.get());
+    CHK_EQ(end - start, entries->size());
+    for (uint64_t ii = start; ii < end; ++ii) {
+        CHK_Z(check_entry(entries->at(ii - start), term, ii));
+    }
+    std::vector<uint64_t> terms;
+    CHK_TRUE(store.terms_in_range(start, end, terms));
+    CHK_EQ(end - start, terms.size());
+    for (uint64_t ii = start; ii < end; ++ii) {
+        CHK_EQ(term, terms[ii - start]);
+    }
+    return 0;
+}
+
+int check_range(file_log_store& store, uint64_t start, uint64_t end, uint64_t term) {
+    CHK_EQ(start, store.start_index());
+    CHK_EQ(end, store.next_slot());
+    if (start == end) return 0;
+
+    CHK_Z(check_logs(store, start, end, term));
+    CHK_Z(check_entry(store.last_entry(), term, end - 1));
+    return 0;
+}
+
+int basic_test() {
+    std::string path;
+    TEST_SUITE_PREPARE_PATH(path);
+
+    const size_t NUM = 100;
+    {
+        file_log_store store(path, small_segments());
+        CHK_EQ(1, store.start_index());
+        CHK_EQ(1, store.next_slot());
+        CHK_EQ(0, store.last_entry()->get_term());
+        CHK_NULL(store.entry_at(1).get());
+
+        for (size_t ii = 1; ii <= NUM; ++ii) {
+            std::shared_ptr<log_entry> entry = make_entry(1, ii);
+            CHK_EQ(ii, store.append(entry));
+        }
+        store.end_of_append_batch(1, NUM);
+        CHK_EQ(NUM, store.last_durable_index());
+        CHK_Z(check_range(store, 1, NUM + 1, 1));
+        CHK_GTEQ(store.num_segments(), NUM / 8);
+
+        // Out of range.
+        CHK_NULL(store.log_entries(1, NUM + 2).get());
+        CHK_EQ(0, store.term_at(NUM + 1));
+        std::vector<uint64_t> terms;
+        CHK_FALSE(store.terms_in_range(1, NUM + 2, terms));
+
+        // Size hint.
+        auto entries = store.log_entries_ext(1, NUM + 1, 100);
+        CHK_NONNULL(entries.get());
+        CHK_GT(entries->size(), 0);
+        CHK_SMEQ(entries->size(), 20);
+    }
+
+    {
+        // Reopen.
+        file_log_store store(path, small_segments());
+        CHK_Z(check_range(store, 1, NUM + 1, 1));
+
+        std::shared_ptr<log_entry> entry = make_entry(1, NUM + 1);
+        CHK_EQ(NUM + 1, store.append(entry));
+        CHK_Z(check_range(store, 1, NUM + 2, 1));
+    }
+
+    TEST_SUITE_CLEANUP_PATH();
+    return 0;
+}
+
+int torn_write_test() {
+    std::string path;
+    TEST_SUITE_PREPARE_PATH(path);
+
+    file_log_store_options opt;
+    opt.preallocate_ = false;
+
+    const size_t NUM = 20;
+    {
+        file_log_store store(path, opt);
+        for (size_t ii = 1; ii <= NUM; ++ii) {
+            std::shared_ptr<log_entry> entry = make_entry(1, ii);
+            store.append(entry);
+        }
+        store.flush();
+    }
+
+    // Cut the last log in the middle.
+    std::string data_file = path + "/00000000000000000001.log";
+    struct stat st;
+    CHK_Z(stat(data_file.c_str(), &st));
+    CHK_Z(truncate(data_file.c_str(), st.st_size - 3));
+
+    {
+        file_log_store store(path, opt);
+        CHK_Z(check_range(store, 1, NUM, 1));
+
+        std::shared_ptr<log_entry> entry = make_entry(1, NUM);
+        CHK_EQ(NUM, store.append(entry));
+        store.flush();
+    }
+
+    // Corrupt the last log.
+    {
+        FILE* fp = fopen(data_file.c_str(), "r+");
+        CHK_NONNULL(fp);
+        CHK_Z(fseek(fp, -2, SEEK_END));
+        fputc('?', fp);
+        fclose(fp);
+    }
+
+    {
+        file_log_store store(path, opt);
+        CHK_Z(check_range(store, 1, NUM, 1));
+    }
+
+    TEST_SUITE_CLEANUP_PATH();
+    return 0;
+}
+
+int write_at_test() {
+    std::string path;
+    TEST_SUITE_PREPARE_PATH(path);
+
+    const size_t NUM = 50;
+    {
+        file_log_store store(path, small_segments());
+        for (size_t ii = 1; ii <= NUM; ++ii) {
+            std::shared_ptr<log_entry> entry = make_entry(1, ii);
+            store.append(entry);
+        }
+        size_t num_segments = store.num_segments();
+
+        // Overwrite the log in the middle of an old segment.
+        std::shared_ptr<log_entry> entry = make_entry(2, 20);
+        store.write_at(20, entry);
+        CHK_EQ(21, store.next_slot());
+        CHK_Z(check_logs(store, 1, 20, 1));
+        CHK_Z(check_entry(store.entry_at(20), 2, 20));
+        CHK_Z(check_entry(store.last_entry(), 2, 20));
+        CHK_NULL(store.entry_at(21).get());
+        CHK_SM(store.num_segments(), num_segments);
+
+        for (size_t ii = 21; ii <= 30; ++ii) {
+            entry = make_entry(2, ii);
+            CHK_EQ(ii, store.append(entry));
+        }
+        store.flush();
+    }
+
+    {
+        file_log_store store(path, small_segments());
+        CHK_EQ(31, store.next_slot());
+        CHK_Z(check_logs(store, 1, 20, 1));
+        CHK_Z(check_logs(store, 20, 31, 2));
+
+        // Across segments and terms.
+        std::vector<uint64_t> terms;
+        CHK_TRUE(store.terms_in_range(15, 25, terms));
+        CHK_EQ(10, terms.size());
+        for (uint64_t ii = 15; ii < 25; ++ii) {
+            CHK_EQ(ii < 20 ? 1 : 2, terms[ii - 15]);
+        }
+
+        // Overwrite the very first log.
+        std::shared_ptr<log_entry> entry = make_entry(3, 1);
+        store.write_at(1, entry);
+        CHK_EQ(2, store.next_slot());
+        CHK_EQ(1, store.num_segments());
+        CHK_Z(check_range(store, 1, 2, 3));
+    }
+
+    TEST_SUITE_CLEANUP_PATH();
+    return 0;
+}
+
+int compact_test() {
+    std::string path;
+    TEST_SUITE_PREPARE_PATH(path);
+
+    const size_t NUM = 50;
+    {
+        file_log_store store(path, small_segments());
+        for (size_t ii = 1; ii <= NUM; ++ii) {
+            std::shared_ptr<log_entry> entry = make_entry(1, ii);
+            store.append(entry);
+        }
+        size_t num_segments = store.num_segments();
+
+        CHK_TRUE(store.compact(30));
+        CHK_Z(check_range(store, 31, NUM + 1, 1));
+        CHK_NULL(store.entry_at(30).get());
+        CHK_EQ(0, store.term_at(30));
+        CHK_SM(store.num_segments(), num_segments);
+        store.flush();
+    }
+
+    {
+        // Start index should be kept, even though
+        // the first segment still has compacted logs.
+        file_log_store store(path, small_segments());
+        CHK_Z(check_range(store, 31, NUM + 1, 1));
+
+        // Compact all.
+        CHK_TRUE(store.compact(NUM + 10));
+        CHK_EQ(NUM + 11, store.start_index());
+        CHK_EQ(NUM + 11, store.next_slot());
+        CHK_EQ(0, store.num_segments());
+
+        std::shared_ptr<log_entry> entry = make_entry(1, NUM + 11);
+        CHK_EQ(NUM + 11, store.append(entry));
+        store.flush();
+    }
+
+    {
+        file_log_store store(path, small_segments());
+        CHK_Z(check_range(store, NUM + 11, NUM + 12, 1));
+    }
+
+    TEST_SUITE_CLEANUP_PATH();
+    return 0;
+}
+
+int pack_test() {
+    std::string path;
+    TEST_SUITE_PREPARE_PATH(path);
+
+    const size_t NUM = 30;
+    file_log_store src(path + "_src", small_segments());
+    for (size_t ii = 1; ii <= NUM; ++ii) {
+        std::shared_ptr<log_entry> entry = make_entry(1, ii);
+        src.append(entry);
+    }
+
+    std::shared_ptr<buffer> pack = src.pack(11, 10);
+    CHK_NONNULL(pack.get());
+
+    // Empty store, should start from the given index.
+    file_log_store dst(path + "_dst", small_segments());
+    dst.apply_pack(11, *pack);
+    CHK_Z(check_range(dst, 11, 21, 1));
+
+    // Overwrite existing logs.
+    pack = src.pack(15, 16);
+    dst.apply_pack(15, *pack);
+    CHK_Z(check_range(dst, 11, 31, 1));
+
+    TEST_SUITE_CLEANUP_PATH();
+    return 0;
+}
+
+} // namespace file_log_store_test
+using namespace file_log_store_test;
+
+int main(int argc, char** argv) {
+    TestSuite ts(argc, argv);
+
+    ts.options.printTestMessage = false;
+
+    ts.doTest("basic test", basic_test);
+    ts.doTest("torn write test", torn_write_test);
+    ts.doTest("write at test", write_at_test);
+    ts.doTest("compact test", compact_test);
+    ts.doTest("pack test", pack_test);
+
+    return 0;
+}
@@ -42,6 +42,7 @@ class TestSm : public state_machine {
 public:
     TestSm(SimpleLogger* logger = nullptr)
         : customBatchSize(0)
+        , numBatchCommits(0)
         , lastCommittedConfigIdx(0)
         , targetSnpReadFailures(0)
         , snpDelayMs(0)
@@ -61,6 +62,15 @@ public:
         return ret;
     }
 
+    void commit_batch_ext(uint64_t start_log_idx,
+                          std::vector<std::shared_ptr<buffer>>& data_list,
+                          std::vector<std::shared_ptr<buffer>>& ret_values) {
+        numBatchCommits++;
+        state_machine::commit_batch_ext(start_log_idx, data_list, ret_values);
+    }
+
+    uint64_t getNumBatchCommits() const { return numBatchCommits; }
+
     void commit_config(const uint64_t log_idx,
                        std::shared_ptr<cluster_config>& new_conf) {
         lastCommittedConfigIdx = log_idx;
@@ -250,7 +260,8 @@ public:
     uint64_t adjust_commit_index(const adjust_commit_index_params& params) {
         std::lock_guard<std::mutex> l(serversForCommitLock);
         if (serversForCommit.empty()) {
-            return params.expected_commit_index_;
+            // Fall back to the default, it should not stop further calls.
+            return state_machine::adjust_commit_index(params);
         }
 
         uint64_t min_index = std::numeric_limits<uint64_t>::max();
@@ -365,6 +376,8 @@ private:
 
     std::atomic<uint64_t> customBatchSize;
 
+    std::atomic<uint64_t> numBatchCommits;
+
     std::atomic<uint64_t> lastCommittedConfigIdx;
 
     std::atomic<int> targetSnpReadFailures;
@@ -51,6 +51,10 @@ public:
         , alwaysInvokeCb(true)
         , useCustomResolver(false)
         , useLogTimestamp(false)
+        , useMultiplexedRpc(false)
+        , useShardedIo(false)
+        , readBufferSize(0)
+        , maxCoalescedMsgs(0)
         , myLogWrapper(nullptr)
         , myLog(nullptr) {}
 
@@ -113,6 +117,10 @@ public:
         }
 
         asio_opt.replicate_log_timestamp_ = useLogTimestamp;
+        asio_opt.multiplexed_rpc_ = useMultiplexedRpc;
+        asio_opt.sharded_io_context_ = useShardedIo;
+        if (readBufferSize) asio_opt.read_buffer_size_ = readBufferSize;
+        if (maxCoalescedMsgs) asio_opt.max_coalesced_msgs_ = maxCoalescedMsgs;
 
         if (readReqMeta) asio_opt.read_req_meta_ = readReqMeta;
         if (writeReqMeta) asio_opt.write_req_meta_ = writeReqMeta;
@@ -128,9 +136,13 @@ public:
 
         int raft_port = 20000 + myId * 10;
         std::shared_ptr<rpc_listener> listener(
-            asioSvc->create_rpc_listener(raft_port, myLog));
+            inprocSvc ? inprocSvc->create_rpc_listener(myEndpoint)
+            : myEndpoint.compare(0, 7, "unix://") == 0
+                ? asioSvc->create_unix_rpc_listener(myEndpoint, myLog)
+                : asioSvc->create_rpc_listener(raft_port, myLog));
         std::shared_ptr<delayed_task_scheduler> scheduler = asioSvc;
         std::shared_ptr<rpc_client_factory> rpc_cli_factory = asioSvc;
+        if (inprocSvc) rpc_cli_factory = inprocSvc;
 
         raft_params params;
         params.with_hb_interval(HEARTBEAT_MS);
@@ -172,9 +184,13 @@ public:
 
         int raft_port = 20000 + myId * 10;
         std::shared_ptr<rpc_listener> listener(
-            asioSvc->create_rpc_listener(raft_port, myLog));
+            inprocSvc ? inprocSvc->create_rpc_listener(myEndpoint)
+            : myEndpoint.compare(0, 7, "unix://") == 0
+                ? asioSvc->create_unix_rpc_listener(myEndpoint, myLog)
+                : asioSvc->create_rpc_listener(raft_port, myLog));
         std::shared_ptr<delayed_task_scheduler> scheduler = asioSvc;
         std::shared_ptr<rpc_client_factory> rpc_cli_factory = asioSvc;
+        if (inprocSvc) rpc_cli_factory = inprocSvc;
 
         raft_params params;
         if (custom_params) {
@@ -245,6 +261,18 @@ public:
 
     bool useLogTimestamp;
 
+    bool useMultiplexedRpc;
+
+    bool useShardedIo;
+
+    // If non-zero, override the default of Asio options.
+    size_t readBufferSize;
+    size_t maxCoalescedMsgs;
+
+    // If given, use in-process RPC instead of Asio (Asio is still used
+    // for timers).
+    std::shared_ptr<inproc_service> inprocSvc;
+
     std::shared_ptr<logger_wrapper> myLogWrapper;
     std::shared_ptr<logger> myLog;
 };
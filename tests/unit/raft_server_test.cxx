@@ -2331,6 +2331,215 @@ int async_append_handler_test() {
     return 0;
 }
 
+int batched_commit_test() {
+    reset_log_files();
+    std::shared_ptr<FakeNetworkBase> f_base = std::make_shared<FakeNetworkBase>();
+
+    std::string s1_addr = "S1";
+    std::string s2_addr = "S2";
+    std::string s3_addr = "S3";
+
+    RaftPkg s1(f_base, 1, s1_addr);
+    RaftPkg s2(f_base, 2, s2_addr);
+    RaftPkg s3(f_base, 3, s3_addr);
+    std::vector<RaftPkg*> pkgs = {&s1, &s2, &s3};
+
+    CHK_Z(launch_servers(pkgs));
+    CHK_Z(make_group(pkgs));
+
+    for (auto& entry: pkgs) {
+        RaftPkg* pp = entry;
+        raft_params param = pp->raftServer->get_current_params();
+        param.return_method_ = raft_params::async_handler;
+        param.with_commit_batch_size(100);
+        pp->raftServer->update_params(param);
+    }
+
+    const size_t NUM = 10;
+
+    // Append messages asynchronously.
+    std::list<std::shared_ptr<cmd_result<std::shared_ptr<buffer>>>> handlers;
+    for (size_t ii = 0; ii < NUM; ++ii) {
+        std::string test_msg = "test" + std::to_string(ii);
+        std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+        msg->put(test_msg);
+        std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> ret =
+            s1.raftServer->append_entries({msg});
+
+        CHK_TRUE(ret->get_accepted());
+
+        handlers.push_back(ret);
+    }
+
+    // Packet for pre-commit.
+    s1.fNet->execReqResp();
+    // Packet for commit.
+    s1.fNet->execReqResp();
+    // Wait for bg commit.
+    CHK_Z(wait_for_sm_exec(pkgs, COMMIT_TIMEOUT_SEC));
+
+    // One more time to make sure.
+    s1.fNet->execReqResp();
+    s1.fNet->execReqResp();
+    CHK_Z(wait_for_sm_exec(pkgs, COMMIT_TIMEOUT_SEC));
+
+    // Now all async handlers should have result.
+    std::list<uint64_t> idx_list;
+    for (auto& entry: handlers) {
+        std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> result = entry;
+        cmd_result<std::shared_ptr<buffer>>::handler_type my_handler =
+            std::bind(async_handler,
+                      &idx_list,
+                      result,
+                      cmd_result_code::OK,
+                      std::placeholders::_1,
+                      std::placeholders::_2);
+        result->when_ready(my_handler);
+    }
+    CHK_EQ(NUM, idx_list.size());
+
+    // Logs should have been committed in batch.
+    for (auto& entry: pkgs) {
+        CHK_GT(entry->getTestSm()->getNumBatchCommits(), 0);
+    }
+
+    // Check if all messages are committed.
+    for (size_t ii = 0; ii < NUM; ++ii) {
+        std::string test_msg = "test" + std::to_string(ii);
+        uint64_t idx = s1.getTestSm()->isCommitted(test_msg);
+        CHK_GT(idx, 0);
+    }
+
+    // State machine should be identical.
+    CHK_OK(s2.getTestSm()->isSame(*s1.getTestSm()));
+    CHK_OK(s3.getTestSm()->isSame(*s1.getTestSm()));
+
+    print_stats(pkgs);
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+
+    f_base->destroy();
+
+    return 0;
+}
+
+int group_commit_test(size_t max_bytes) {
+    reset_log_files();
+    std::shared_ptr<FakeNetworkBase> f_base = std::make_shared<FakeNetworkBase>();
+
+    std::string s1_addr = "S1";
+    std::string s2_addr = "S2";
+    std::string s3_addr = "S3";
+
+    RaftPkg s1(f_base, 1, s1_addr);
+    RaftPkg s2(f_base, 2, s2_addr);
+    RaftPkg s3(f_base, 3, s3_addr);
+    std::vector<RaftPkg*> pkgs = {&s1, &s2, &s3};
+
+    CHK_Z(launch_servers(pkgs));
+    CHK_Z(make_group(pkgs));
+
+    for (auto& entry: pkgs) {
+        RaftPkg* pp = entry;
+        raft_params param = pp->raftServer->get_current_params();
+        param.return_method_ = raft_params::async_handler;
+        if (max_bytes) {
+            // Long window, the group should be handled by size.
+            param.with_group_commit(10 * 1000 * 1000, max_bytes);
+        } else {
+            param.with_group_commit(50 * 1000);
+        }
+        pp->raftServer->update_params(param);
+    }
+
+    // A lone request should not wait for the window.
+    TestSuite::Timer timer;
+    std::string lone_msg = "lone";
+    std::shared_ptr<buffer> msg = buffer::alloc(lone_msg.size() + 1);
+    msg->put(lone_msg);
+    CHK_TRUE(s1.raftServer->append_entries({msg})->get_accepted());
+    if (!max_bytes) {
+        CHK_SM(timer.getTimeMs(), 50);
+    }
+
+    const size_t NUM = 10;
+
+    // Append messages from multiple threads at the same time.
+    timer.reset();
+    std::vector<std::shared_ptr<cmd_result<std::shared_ptr<buffer>>>> handlers(NUM);
+    std::vector<std::thread> threads;
+    for (size_t ii = 0; ii < NUM; ++ii) {
+        threads.push_back(std::thread([&, ii]() {
+            std::string test_msg = "test" + std::to_string(ii);
+            std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+            msg->put(test_msg);
+            handlers[ii] = s1.raftServer->append_entries({msg});
+        }));
+    }
+    for (auto& entry: threads) {
+        entry.join();
+    }
+    CHK_SM(timer.getTimeSec(), 5);
+
+    for (auto& entry: handlers) {
+        CHK_TRUE(entry->get_accepted());
+    }
+
+    // Packet for pre-commit.
+    s1.fNet->execReqResp();
+    // Packet for commit.
+    s1.fNet->execReqResp();
+    // Wait for bg commit.
+    CHK_Z(wait_for_sm_exec(pkgs, COMMIT_TIMEOUT_SEC));
+
+    // One more time to make sure.
+    s1.fNet->execReqResp();
+    s1.fNet->execReqResp();
+    CHK_Z(wait_for_sm_exec(pkgs, COMMIT_TIMEOUT_SEC));
+
+    // Now all async handlers should have result,
+    // and each request has its own log index.
+    std::list<uint64_t> idx_list;
+    for (auto& entry: handlers) {
+        std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> result = entry;
+        cmd_result<std::shared_ptr<buffer>>::handler_type my_handler =
+            std::bind(async_handler,
+                      &idx_list,
+                      result,
+                      cmd_result_code::OK,
+                      std::placeholders::_1,
+                      std::placeholders::_2);
+        result->when_ready(my_handler);
+    }
+    CHK_EQ(NUM, idx_list.size());
+    idx_list.sort();
+    idx_list.unique();
+    CHK_EQ(NUM, idx_list.size());
+
+    // Check if all messages are committed.
+    for (size_t ii = 0; ii < NUM; ++ii) {
+        std::string test_msg = "test" + std::to_string(ii);
+        uint64_t idx = s1.getTestSm()->isCommitted(test_msg);
+        CHK_GT(idx, 0);
+    }
+
+    // State machine should be identical.
+    CHK_OK(s2.getTestSm()->isSame(*s1.getTestSm()));
+    CHK_OK(s3.getTestSm()->isSame(*s1.getTestSm()));
+
+    print_stats(pkgs);
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+
+    f_base->destroy();
+
+    return 0;
+}
+
 int async_append_handler_cancel_test() {
     reset_log_files();
     std::shared_ptr<FakeNetworkBase> f_base = std::make_shared<FakeNetworkBase>();
@@ -2957,6 +3166,104 @@ int full_consensus_synth_test() {
     return 0;
 }
 
+int quorum_commit_index_test() {
+    reset_log_files();
+    std::shared_ptr<FakeNetworkBase> f_base = std::make_shared<FakeNetworkBase>();
+
+    std::string s1_addr = "S1";
+    std::string s2_addr = "S2";
+    std::string s3_addr = "S3";
+    std::string s4_addr = "S4";
+    std::string s5_addr = "S5";
+
+    RaftPkg s1(f_base, 1, s1_addr);
+    RaftPkg s2(f_base, 2, s2_addr);
+    RaftPkg s3(f_base, 3, s3_addr);
+    RaftPkg s4(f_base, 4, s4_addr);
+    RaftPkg s5(f_base, 5, s5_addr);
+    std::vector<RaftPkg*> pkgs = {&s1, &s2, &s3, &s4, &s5};
+
+    CHK_Z(launch_servers(pkgs));
+    CHK_Z(make_group(pkgs));
+
+    for (auto& entry: pkgs) {
+        RaftPkg* pp = entry;
+        raft_params param = pp->raftServer->get_current_params();
+        param.return_method_ = raft_params::async_handler;
+        // Lagging peers should catch up with logs, not snapshot.
+        param.snapshot_distance_ = 0;
+        pp->raftServer->update_params(param);
+    }
+
+    const size_t NUM = 10;
+
+    // Append messages asynchronously.
+    auto append_msg = [&]() {
+        for (size_t ii = 0; ii < NUM; ++ii) {
+            std::string test_msg = "test" + std::to_string(ii);
+            std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+            msg->put(test_msg);
+            std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> ret =
+                s1.raftServer->append_entries({msg});
+            CHK_TRUE(ret->get_accepted());
+        }
+        return 0;
+    };
+    auto send_to = [&](const std::vector<std::string>& addrs) {
+        for (size_t ii = 0; ii < NUM; ++ii) {
+            // Heartbeat to wake up lagging peers.
+            s1.fTimer->invoke(timer_task_type::heartbeat_timer);
+            for (auto& addr: addrs) {
+                s1.fNet->execReqResp(addr);
+            }
+        }
+    };
+
+    // S1 and S2 only: not committed.
+    CHK_Z(append_msg());
+    send_to({s2_addr});
+    CHK_GT(s1.raftServer->get_last_log_idx(),
+           s1.raftServer->get_target_committed_log_idx());
+
+    // S1, S2, and S3: committed.
+    send_to({s3_addr});
+    CHK_EQ(s1.raftServer->get_last_log_idx(),
+           s1.raftServer->get_target_committed_log_idx());
+
+    // S1, S4, and S5, while S2 and S3 are lagging behind: committed.
+    CHK_Z(append_msg());
+    send_to({s4_addr, s5_addr});
+    CHK_EQ(s1.raftServer->get_last_log_idx(),
+           s1.raftServer->get_target_committed_log_idx());
+
+    // Require all members.
+    {
+        raft_params param = s1.raftServer->get_current_params();
+        param.custom_commit_quorum_size_ = 5;
+        s1.raftServer->update_params(param);
+    }
+    CHK_Z(append_msg());
+    send_to({s2_addr, s3_addr, s4_addr});
+    CHK_GT(s1.raftServer->get_last_log_idx(),
+           s1.raftServer->get_target_committed_log_idx());
+
+    send_to({s5_addr});
+    CHK_EQ(s1.raftServer->get_last_log_idx(),
+           s1.raftServer->get_target_committed_log_idx());
+
+    print_stats(pkgs);
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+    s4.raftServer->shutdown();
+    s5.raftServer->shutdown();
+
+    f_base->destroy();
+
+    return 0;
+}
+
 int extended_append_entries_api_test() {
     reset_log_files();
     std::shared_ptr<FakeNetworkBase> f_base = std::make_shared<FakeNetworkBase>();
@@ -3051,9 +3358,176 @@ int extended_append_entries_api_test() {
     return 0;
 }
 
+int pipelined_append_entries_test() {
+    reset_log_files();
+    std::shared_ptr<FakeNetworkBase> f_base = std::make_shared<FakeNetworkBase>();
+
+    std::string s1_addr = "S1";
+    std::string s2_addr = "S2";
+    std::string s3_addr = "S3";
+
+    RaftPkg s1(f_base, 1, s1_addr);
+    RaftPkg s2(f_base, 2, s2_addr);
+    RaftPkg s3(f_base, 3, s3_addr);
+    std::vector<RaftPkg*> pkgs = {&s1, &s2, &s3};
+
+    CHK_Z(launch_servers(pkgs));
+    CHK_Z(make_group(pkgs));
+
+    const int32_t WINDOW = 4;
+    for (auto& entry: pkgs) {
+        RaftPkg* pp = entry;
+        raft_params param = pp->raftServer->get_current_params();
+        param.return_method_ = raft_params::async_handler;
+        // One log per request, to make multiple requests in flight.
+        param.max_append_size_ = 1;
+        param.with_append_pipelining(WINDOW);
+        pp->raftServer->update_params(param);
+    }
+
+    auto append_msgs = [&](size_t from, size_t num) {
+        for (size_t ii = from; ii < from + num; ++ii) {
+            std::string test_msg = "test" + std::to_string(ii);
+            std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+            msg->put(test_msg);
+            std::shared_ptr<cmd_result<std::shared_ptr<buffer>>> ret =
+                s1.raftServer->append_entries({msg});
+            CHK_TRUE(ret->get_accepted());
+        }
+        return 0;
+    };
+
+    auto exec_all = [&]() {
+        for (size_t ii = 0; ii < 100; ++ii) {
+            if (!s1.fNet->getNumPendingReqs(s2_addr)
+                && !s1.fNet->getNumPendingReqs(s3_addr)) {
+                break;
+            }
+            s1.fNet->execReqResp();
+        }
+    };
+
+    // The first request after enabling pipelining is not pipelined,
+    // its response will open the window.
+    CHK_Z(append_msgs(0, 1));
+    exec_all();
+    CHK_Z(wait_for_sm_exec(pkgs, COMMIT_TIMEOUT_SEC));
+
+    // Now the leader doesn't wait for the response of the previous request,
+    // but no more than the window size.
+    const size_t NUM = 10;
+    CHK_Z(append_msgs(1, NUM));
+    CHK_GT(s1.fNet->getNumPendingReqs(s2_addr), 1);
+    CHK_GT(s1.fNet->getNumPendingReqs(s3_addr), 1);
+    CHK_SM(s1.fNet->getNumPendingReqs(s2_addr), (size_t)WINDOW + 1);
+    CHK_SM(s1.fNet->getNumPendingReqs(s3_addr), (size_t)WINDOW + 1);
+
+    exec_all();
+    CHK_Z(wait_for_sm_exec(pkgs, COMMIT_TIMEOUT_SEC));
+    // One more time for commit index.
+    s1.fTimer->invoke(timer_task_type::heartbeat_timer);
+    exec_all();
+    CHK_Z(wait_for_sm_exec(pkgs, COMMIT_TIMEOUT_SEC));
+
+    for (size_t ii = 0; ii < NUM + 1; ++ii) {
+        std::string test_msg = "test" + std::to_string(ii);
+        CHK_GT(s1.getTestSm()->isCommitted(test_msg), 0);
+    }
+    CHK_OK(s2.getTestSm()->isSame(*s1.getTestSm()));
+    CHK_OK(s3.getTestSm()->isSame(*s1.getTestSm()));
+
+    // S3 goes offline, and misses some logs.
+    s3.fNet->goesOffline();
+    CHK_Z(append_msgs(NUM + 1, NUM));
+    exec_all();
+    CHK_Z(wait_for_sm_exec({&s1, &s2}, COMMIT_TIMEOUT_SEC));
+
+    // S3 comes back, the leader should rewind its log index
+    // and then catch up in pipelined mode.
+    s3.fNet->goesOnline();
+    for (size_t ii = 0; ii < 10; ++ii) {
+        s1.fTimer->invoke(timer_task_type::heartbeat_timer);
+        exec_all();
+    }
+    CHK_Z(wait_for_sm_exec(pkgs, COMMIT_TIMEOUT_SEC));
+
+    CHK_EQ(s1.raftServer->get_committed_log_idx(),
+           s3.raftServer->get_committed_log_idx());
+    CHK_OK(s2.getTestSm()->isSame(*s1.getTestSm()));
+    CHK_OK(s3.getTestSm()->isSame(*s1.getTestSm()));
+
+    print_stats(pkgs);
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+
+    f_base->destroy();
+
+    return 0;
+}
+
 } // namespace raft_server_test
 using namespace raft_server_test;
 
+int deferred_append_resp_election_test() {
+    reset_log_files();
+    std::shared_ptr<FakeNetworkBase> f_base = std::make_shared<FakeNetworkBase>();
+
+    std::string s1_addr = "S1";
+    std::string s2_addr = "S2";
+    std::string s3_addr = "S3";
+
+    RaftPkg s1(f_base, 1, s1_addr);
+    RaftPkg s2(f_base, 2, s2_addr);
+    RaftPkg s3(f_base, 3, s3_addr);
+    std::vector<RaftPkg*> pkgs = {&s1, &s2, &s3};
+
+    CHK_Z(launch_servers(pkgs));
+    CHK_Z(make_group(pkgs));
+
+    const int32_t ELECTION_TIMEOUT_MS = 200;
+    for (auto& entry: pkgs) {
+        RaftPkg* pp = entry;
+        raft_params param = pp->raftServer->get_current_params();
+        param.return_method_ = raft_params::async_handler;
+        param.parallel_log_appending_ = true;
+        param.with_election_timeout_upper(ELECTION_TIMEOUT_MS);
+        pp->raftServer->update_params(param);
+    }
+
+    // S2's log store never makes the logs durable.
+    s2.getTestMgr()->set_disk_delay(s2.raftServer.get(), 3600 * 1000);
+
+    std::string test_msg = "test";
+    std::shared_ptr<buffer> msg = buffer::alloc(test_msg.size() + 1);
+    msg->put(test_msg);
+    s1.raftServer->append_entries({msg});
+    s1.fNet->execReqResp();
+
+    // S2 is waiting for the durability, election timeout is ignored.
+    s2.fTimer->invoke(timer_task_type::election_timer);
+    CHK_Z(s2.fNet->getNumPendingReqs(s1_addr));
+    CHK_Z(s2.fNet->getNumPendingReqs(s3_addr));
+
+    // But not forever.
+    TestSuite::sleep_ms(ELECTION_TIMEOUT_MS * 2, "wait for election timeout");
+    s2.fTimer->invoke(timer_task_type::election_timer);
+    CHK_GT(s2.fNet->getNumPendingReqs(s1_addr), 0);
+    CHK_GT(s2.fNet->getNumPendingReqs(s3_addr), 0);
+
+    s2.fNet->makeReqFailAll(s1_addr);
+    s2.fNet->makeReqFailAll(s3_addr);
+
+    s1.raftServer->shutdown();
+    s2.raftServer->shutdown();
+    s3.raftServer->shutdown();
+
+    f_base->destroy();
+
+    return 0;
+}
+
 int main(int argc, char** argv) {
     TestSuite ts(argc, argv);
 
@@ -3115,6 +3589,8 @@ int main(int argc, char** argv) {
     ts.doTest("join empty node test", join_empty_node_test);
 
     ts.doTest("async append handler test", async_append_handler_test);
+    ts.doTest("batched commit test", batched_commit_test);
+    ts.doTest("group commit test", group_commit_test, TestRange<size_t>({0, 1}));
 
     ts.doTest("async append handler cancel test", async_append_handler_cancel_test);
 
@@ -3125,9 +3601,15 @@ int main(int argc, char** argv) {
     ts.doTest("config log replay test", config_log_replay_test);
 
     ts.doTest("full consensus test", full_consensus_synth_test);
+    ts.doTest("quorum commit index test", quorum_commit_index_test);
 
     ts.doTest("extended append_entries API test", extended_append_entries_api_test);
 
+    ts.doTest("pipelined append_entries test", pipelined_append_entries_test);
+
+    ts.doTest("deferred append response election test",
+              deferred_append_resp_election_test);
+
 #ifdef ENABLE_RAFT_STATS
     _msg("raft stats: ENABLED\n");
 #else